@@ -36,6 +36,7 @@
 
 #include <fc/smart_ref_impl.hpp>
 #include <fc/uint128.hpp>
+#include <fc/scoped_exit.hpp>
 
 #include <fc/container/deque.hpp>
 
@@ -927,6 +928,63 @@ void database::push_transaction( const signed_transaction& trx, uint32_t skip )
    FC_CAPTURE_AND_RETHROW( (trx) )
 }
 
+void database::prepare_transaction( prepared_transaction& ptrx )const
+{
+   try
+   {
+      ptrx.trx.validate();
+      ptrx.packed_size = fc::raw::pack_size( ptrx.trx );
+      // The canonical form required depends on the active hardforks, so it is checked once the lock is held
+      ptrx.signature_keys = ptrx.trx.get_signature_keys( get_chain_id(), fc::ecc::non_canonical );
+   }
+   FC_CAPTURE_AND_RETHROW( (ptrx.trx) )
+}
+
+void database::push_transactions( const vector< prepared_transaction* >& trxs, vector< optional< fc::exception > >& results, uint32_t skip )
+{
+   results.clear();
+   results.resize( trxs.size() );
+
+   // Transactions were validated by prepare_transaction
+   skip |= skip_validate;
+
+   set_producing( true );
+   set_pending_tx( true );
+   detail::with_skip_flags( *this, skip,
+      [&]()
+      {
+         for( size_t i = 0; i < trxs.size(); ++i )
+         {
+            const prepared_transaction& ptrx = *trxs[i];
+
+            try
+            {
+               try
+               {
+                  FC_ASSERT( ptrx.packed_size <= (get_dynamic_global_properties().maximum_block_size - 256) );
+                  _current_trx_signature_keys = &ptrx.signature_keys;
+                  _push_transaction( ptrx.trx );
+                  _current_trx_signature_keys = nullptr;
+               }
+               FC_CAPTURE_AND_RETHROW( (ptrx.trx) )
+            }
+            catch( fc::exception& e )
+            {
+               _current_trx_signature_keys = nullptr;
+               results[i] = e;
+            }
+            catch( ... )
+            {
+               _current_trx_signature_keys = nullptr;
+               results[i] = fc::unhandled_exception( FC_LOG_MESSAGE( warn, "Unexpected exception while pushing transaction." ),
+                                                     std::current_exception() );
+            }
+         }
+      });
+   set_producing( false );
+   set_pending_tx( false );
+}
+
 void database::_push_transaction( const signed_transaction& trx )
 {
    // If this is the first transaction pushed after applying a block, start a new undo session.
@@ -940,6 +998,29 @@ void database::_push_transaction( const signed_transaction& trx )
    // apply the changes.
 
    auto temp_session = start_undo_session();
+
+   // Recover the signature keys once and keep them, the transaction is re-applied after every block until included
+   auto prior_signature_keys = _current_trx_signature_keys;
+   auto restore_signature_keys = fc::make_scoped_exit( [&]() { _current_trx_signature_keys = prior_signature_keys; } );
+
+   if( !( get_node_properties().skip_flags & ( skip_transaction_signatures | skip_authority_check ) ) )
+   {
+      auto& cached = _pending_tx_signature_keys[ trx.id() ];
+
+      if( _current_trx_signature_keys != nullptr )
+      {
+         cached.keys = *_current_trx_signature_keys;
+         cached.signatures = trx.signatures;
+      }
+      else if( cached.signatures.empty() || cached.signatures != trx.signatures )
+      {
+         cached.keys = trx.get_signature_keys( get_chain_id(), fc::ecc::non_canonical );
+         cached.signatures = trx.signatures;
+      }
+
+      _current_trx_signature_keys = &cached.keys;
+   }
+
    _apply_transaction( trx );
    _pending_tx.push_back( trx );
 
@@ -3373,10 +3454,24 @@ void database::_apply_transaction(const signed_transaction& trx)
 
       try
       {
-         trx.verify_authority( chain_id, get_active, get_owner, get_posting, STEEM_MAX_SIG_CHECK_DEPTH,
-            has_hardfork( STEEM_HARDFORK_0_20 ) || is_producing() ? STEEM_MAX_AUTHORITY_MEMBERSHIP : 0,
-            has_hardfork( STEEM_HARDFORK_0_20 ) || is_producing() ? STEEM_MAX_SIG_CHECK_ACCOUNTS : 0,
-            has_hardfork( STEEM_HARDFORK_0_20__1944 ) ? fc::ecc::bip_0062 : fc::ecc::fc_canonical );
+         auto canon_type = has_hardfork( STEEM_HARDFORK_0_20__1944 ) ? fc::ecc::bip_0062 : fc::ecc::fc_canonical;
+
+         if( _current_trx_signature_keys != nullptr )
+         {
+            for( const auto& sig : trx.signatures )
+               FC_ASSERT( fc::ecc::public_key::is_canonical( sig, canon_type ), "signature is not canonical" );
+
+            trx.verify_authority( *_current_trx_signature_keys, get_active, get_owner, get_posting, STEEM_MAX_SIG_CHECK_DEPTH,
+               has_hardfork( STEEM_HARDFORK_0_20 ) || is_producing() ? STEEM_MAX_AUTHORITY_MEMBERSHIP : 0,
+               has_hardfork( STEEM_HARDFORK_0_20 ) || is_producing() ? STEEM_MAX_SIG_CHECK_ACCOUNTS : 0 );
+         }
+         else
+         {
+            trx.verify_authority( chain_id, get_active, get_owner, get_posting, STEEM_MAX_SIG_CHECK_DEPTH,
+               has_hardfork( STEEM_HARDFORK_0_20 ) || is_producing() ? STEEM_MAX_AUTHORITY_MEMBERSHIP : 0,
+               has_hardfork( STEEM_HARDFORK_0_20 ) || is_producing() ? STEEM_MAX_SIG_CHECK_ACCOUNTS : 0,
+               canon_type );
+         }
       }
       catch( protocol::tx_missing_active_auth& e )
       {
@@ -3441,10 +3536,14 @@ void database::apply_operation(const operation& op)
    if( _benchmark_dumper.is_enabled() )
       _benchmark_dumper.begin();
 
+   fc::time_point start = fc::time_point::now();
+
    _my->_evaluator_registry.get_evaluator( op ).apply( op );
 
+   _apply_latency.operation( op.which() ).histogram.record( ( fc::time_point::now() - start ).count() );
+
    if( _benchmark_dumper.is_enabled() )
-      _benchmark_dumper.end< true/*APPLY_CONTEXT*/ >( _my->_evaluator_registry.get_evaluator( op ).get_name( op ) );
+      _benchmark_dumper.end< true/*APPLY_CONTEXT*/ >( _apply_latency.operation_type_name( op.which() ) );
 
    notify_post_apply_operation( note );
 }
@@ -3595,10 +3694,11 @@ struct fcall<TResult(TArgs...)>
 
    fcall() = default;
    fcall(const TNotification& func, util::advanced_benchmark_dumper& dumper,
-         const abstract_plugin& plugin, const std::string& item_name)
+         util::apply_latency_tracker& latency, const abstract_plugin& plugin, const std::string& item_name)
          : _func(func), _benchmark_dumper(dumper)
       {
          _name = plugin.get_name() + item_name;
+         _latency = &latency.register_handler(_name);
       }
 
    void operator () (TArgs&&... args)
@@ -3606,16 +3706,21 @@ struct fcall<TResult(TArgs...)>
       if (_benchmark_dumper.is_enabled())
          _benchmark_dumper.begin();
 
+      fc::time_point start = fc::time_point::now();
+
       _func(std::forward<TArgs>(args)...);
 
+      _latency->histogram.record((fc::time_point::now() - start).count());
+
       if (_benchmark_dumper.is_enabled())
          _benchmark_dumper.end(_name);
    }
 
 private:
-   TNotification                    _func;
-   util::advanced_benchmark_dumper& _benchmark_dumper;
-   std::string                      _name;
+   TNotification                        _func;
+   util::advanced_benchmark_dumper&     _benchmark_dumper;
+   util::apply_latency_tracker::entry*  _latency = nullptr;
+   std::string                          _name;
 };
 
 template <typename TResult, typename... TArgs>
@@ -3630,7 +3735,7 @@ template <typename TSignal, typename TNotification>
 boost::signals2::connection database::connect_impl( TSignal& signal, const TNotification& func,
    const abstract_plugin& plugin, int32_t group, const std::string& item_name )
 {
-   fcall<TNotification> fcall_wrapper(func,_benchmark_dumper,plugin,item_name);
+   fcall<TNotification> fcall_wrapper(func,_benchmark_dumper,_apply_latency,plugin,item_name);
 
    return signal.connect(group, fcall_wrapper);
 }
@@ -3639,22 +3744,28 @@ template< bool IS_PRE_OPERATION >
 boost::signals2::connection database::any_apply_operation_handler_impl( const apply_operation_handler_t& func,
    const abstract_plugin& plugin, int32_t group )
 {
-   auto complex_func = [this, func, &plugin]( const operation_notification& o )
+   auto* latency = &_apply_latency.register_handler( plugin.get_name() + ( IS_PRE_OPERATION ? "->operation" : "<-operation" ) );
+
+   auto complex_func = [this, func, &plugin, latency]( const operation_notification& o )
    {
       std::string name;
 
       if (_benchmark_dumper.is_enabled())
       {
          if( _my->_evaluator_registry.is_evaluator( o.op ) )
-            name = _benchmark_dumper.generate_desc< IS_PRE_OPERATION >( plugin.get_name(), _my->_evaluator_registry.get_evaluator( o.op ).get_name( o.op ) );
+            name = _benchmark_dumper.generate_desc< IS_PRE_OPERATION >( plugin.get_name(), _apply_latency.operation_type_name( o.op.which() ) );
          else
             name = util::advanced_benchmark_dumper::get_virtual_operation_name();
 
          _benchmark_dumper.begin();
       }
 
+      fc::time_point start = fc::time_point::now();
+
       func( o );
 
+      latency->histogram.record( ( fc::time_point::now() - start ).count() );
+
       if (_benchmark_dumper.is_enabled())
          _benchmark_dumper.end( name );
    };
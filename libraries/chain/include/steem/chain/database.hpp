@@ -10,6 +10,7 @@
 #include <steem/chain/notifications.hpp>
 
 #include <steem/chain/util/advanced_benchmark_dumper.hpp>
+#include <steem/chain/util/apply_latency_tracker.hpp>
 #include <steem/chain/util/signal.hpp>
 
 #include <steem/protocol/protocol.hpp>
@@ -70,6 +71,38 @@ namespace steem { namespace chain {
 
    struct generate_optional_actions_notification {};
 
+   /**
+    * A transaction with the checks that do not depend on chain state already done.
+    * Built by database::prepare_transaction outside of the write lock and consumed
+    * by database::push_transactions.
+    */
+   struct prepared_transaction
+   {
+      prepared_transaction( const signed_transaction& t ) : trx( t ) {}
+
+      const signed_transaction&                    trx;
+      flat_set< protocol::public_key_type >        signature_keys;   ///< Recovered without a canonical check
+      size_t                                       packed_size = 0;
+   };
+
+   /// Signature keys recovered for a pending transaction, valid only for these exact signatures
+   struct cached_signature_keys
+   {
+      vector< protocol::signature_type >           signatures;
+      flat_set< protocol::public_key_type >        keys;
+   };
+
+   /// What happened to the pending transactions the last time they were re-applied after a block
+   struct pending_reapply_stats
+   {
+      fc::microseconds     duration;
+      uint32_t             applied   = 0;
+      uint32_t             known     = 0;   ///< Included in a block since they were pushed
+      uint32_t             expired   = 0;
+      uint32_t             failed    = 0;
+      uint32_t             postponed = 0;
+   };
+
    /**
     *   @class database
     *   @brief tracks the blockchain state in an extensible manner
@@ -248,6 +281,19 @@ namespace steem { namespace chain {
 
          bool push_block( const signed_block& b, uint32_t skip = skip_nothing );
          void push_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
+
+         /**
+          * Validates the transaction and recovers its signature keys. Only reads immutable
+          * state, so it is safe to call without holding a lock.
+          */
+         void prepare_transaction( prepared_transaction& ptrx )const;
+
+         /**
+          * Pushes prepared transactions into the pending state in one pass. Each transaction is
+          * applied in its own undo session, so a failure discards only that transaction. The
+          * outcome of each is reported in the matching slot of results.
+          */
+         void push_transactions( const vector< prepared_transaction* >& trxs, vector< optional< fc::exception > >& results, uint32_t skip = skip_nothing );
          void _maybe_warn_multiple_production( uint32_t height )const;
          bool _push_block( const signed_block& b );
          void _push_transaction( const signed_transaction& trx );
@@ -469,6 +515,11 @@ namespace steem { namespace chain {
          std::deque< signed_transaction >       _popped_tx;
          vector< signed_transaction >           _pending_tx;
 
+         /** signature keys recovered when a transaction entered the pending state, reused to re-apply
+          * it after each block instead of running public key recovery again */
+         std::map< transaction_id_type, cached_signature_keys > _pending_tx_signature_keys;
+         pending_reapply_stats                  _last_pending_reapply_stats;
+
          bool apply_order( const limit_order_object& new_order_object );
          bool fill_order( const limit_order_object& order, const asset& pays, const asset& receives );
          void cancel_order( const limit_order_object& obj );
@@ -608,6 +659,11 @@ namespace steem { namespace chain {
             return _benchmark_dumper;
          }
 
+         util::apply_latency_tracker& get_apply_latency_tracker()
+         {
+            return _apply_latency;
+         }
+
          const hardfork_versions& get_hardfork_versions()
          {
             return _hardfork_versions;
@@ -632,6 +688,9 @@ namespace steem { namespace chain {
          uint16_t                      _current_op_in_trx    = 0;
          uint16_t                      _current_virtual_op   = 0;
 
+         /// Signature keys recovered by prepare_transaction for the transaction being pushed, if any
+         const flat_set< protocol::public_key_type >* _current_trx_signature_keys = nullptr;
+
          flat_map<uint32_t,block_id_type>  _checkpoints;
 
          node_property_object              _node_property_object;
@@ -649,6 +708,7 @@ namespace steem { namespace chain {
          std::string                   _json_schema;
 
          util::advanced_benchmark_dumper  _benchmark_dumper;
+         util::apply_latency_tracker      _apply_latency;
          index_delegate_map            _index_delegate_map;
 
          fc::signal<void(const required_action_notification&)> _pre_apply_required_action_signal;
@@ -55,74 +55,89 @@ struct pending_transactions_restorer
    {
       auto start = fc::time_point::now();
       bool apply_trxs = true;
-      uint32_t applied_txs = 0;
-      uint32_t postponed_txs = 0;
+      pending_reapply_stats stats;
+      std::map< transaction_id_type, cached_signature_keys > kept_signature_keys;
 
-      for( const auto& tx : _db._popped_tx )
+      fc::time_point_sec now = _db.head_block_time();
+      bool strict_expiration = _db.has_hardfork( STEEM_HARDFORK_0_9 );
+
+      // Transactions that are already in the chain or can no longer be included are dropped
+      // without opening an undo session for them. Everything else reuses the signature keys
+      // recovered when it was first pushed.
+      auto reapply = [&]( const signed_transaction& tx, bool log_failure )
       {
          if( apply_trxs && fc::time_point::now() - start > STEEM_PENDING_TRANSACTION_EXECUTION_LIMIT ) apply_trxs = false;
 
-         if( apply_trxs )
+         auto id = tx.id();
+         auto keep_keys = [&]()
          {
-            try {
-               if( !_db.is_known_transaction( tx.id() ) ) {
-                  // since push_transaction() takes a signed_transaction,
-                  // the operation_results field will be ignored.
-                  _db._push_transaction( tx );
-                  applied_txs++;
-               }
-            } catch ( const fc::exception&  ) {}
-         }
-         else
+            auto cached = _db._pending_tx_signature_keys.find( id );
+            if( cached != _db._pending_tx_signature_keys.end() )
+               kept_signature_keys[ id ] = std::move( cached->second );
+         };
+
+         if( !apply_trxs )
          {
             _db._pending_tx.push_back( tx );
-            postponed_txs++;
+            keep_keys();
+            stats.postponed++;
+            return;
+         }
+
+         if( strict_expiration ? tx.expiration <= now : tx.expiration < now )
+         {
+            stats.expired++;
+            return;
          }
-      }
-      _db._popped_tx.clear();
-      for( const signed_transaction& tx : _pending_transactions )
-      {
-         if( apply_trxs && fc::time_point::now() - start > STEEM_PENDING_TRANSACTION_EXECUTION_LIMIT ) apply_trxs = false;
 
-         if( apply_trxs )
+         try
          {
-            try
+            if( _db.is_known_transaction( id ) )
             {
-               if( !_db.is_known_transaction( tx.id() ) ) {
-                  // since push_transaction() takes a signed_transaction,
-                  // the operation_results field will be ignored.
-                  _db._push_transaction( tx );
-                  applied_txs++;
-               }
+               stats.known++;
+               return;
             }
-            catch( const transaction_exception& e )
+
+            // since push_transaction() takes a signed_transaction,
+            // the operation_results field will be ignored.
+            _db._push_transaction( tx );
+            keep_keys();
+            stats.applied++;
+         }
+         catch( const transaction_exception& e )
+         {
+            stats.failed++;
+
+            if( log_failure )
             {
                dlog( "Pending transaction became invalid after switching to block ${b} ${n} ${t}",
                   ("b", _db.head_block_id())("n", _db.head_block_num())("t", _db.head_block_time()) );
                dlog( "The invalid transaction caused exception ${e}", ("e", e.to_detail_string()) );
                dlog( "${t}", ("t", tx) );
             }
-            catch( const fc::exception& e )
-            {
-
-               /*
-               dlog( "Pending transaction became invalid after switching to block ${b} ${n} ${t}",
-                  ("b", _db.head_block_id())("n", _db.head_block_num())("t", _db.head_block_time()) );
-               dlog( "The invalid pending transaction caused exception ${e}", ("e", e.to_detail_string() ) );
-               dlog( "${t}", ("t", tx) );
-               */
-            }
          }
-         else
+         catch( const fc::exception& )
          {
-            _db._pending_tx.push_back( tx );
-            postponed_txs++;
+            stats.failed++;
          }
-      }
+      };
+
+      for( const auto& tx : _db._popped_tx )
+         reapply( tx, false );
+      _db._popped_tx.clear();
+
+      for( const signed_transaction& tx : _pending_transactions )
+         reapply( tx, true );
+
+      // _push_transaction may have cached keys for transactions that since failed, only keep what is still pending
+      _db._pending_tx_signature_keys = std::move( kept_signature_keys );
+
+      stats.duration = fc::time_point::now() - start;
+      _db._last_pending_reapply_stats = stats;
 
-      if( postponed_txs++ )
+      if( stats.postponed )
       {
-         wlog( "Postponed ${p} pending transactions. ${a} were applied.", ("p", postponed_txs)("a", applied_txs) );
+         wlog( "Postponed ${p} pending transactions. ${a} were applied.", ("p", stats.postponed)("a", stats.applied) );
       }
    }
 
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <steem/chain/util/latency_histogram.hpp>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace steem { namespace chain { namespace util {
+
+/**
+ * Always-on latency histograms of evaluator runs per operation type and of every plugin handler connected through
+ * the database, so that it can be told in production which operations and plugins consume block time.
+ *
+ * Histograms are created up front (operations) or when a handler is connected, recording into them is lock-free.
+ */
+class apply_latency_tracker
+{
+   public:
+      struct entry
+      {
+         entry( const std::string& n ) : name( n ) {}
+
+         const std::string name;
+         latency_histogram histogram;
+         latency_snapshot  reported; ///< Owned by the single reporter (i.e. the statsd flush thread) calling summarize_since()
+      };
+
+      apply_latency_tracker();
+
+      entry& operation( int64_t op_type ) { return *_operations[ op_type ]; }
+
+      /// Fully qualified operation type name, as used by advanced_benchmark_dumper
+      const std::string& operation_type_name( int64_t op_type )const { return _operation_type_names[ op_type ]; }
+
+      /// Handlers of the same name share an entry. The returned entry lives as long as the tracker.
+      entry& register_handler( const std::string& name );
+
+      template< typename Lambda >
+      void for_each_operation( Lambda&& l )
+      {
+         for( auto& op : _operations )
+            l( *op );
+      }
+
+      template< typename Lambda >
+      void for_each_handler( Lambda&& l )
+      {
+         std::lock_guard< std::mutex > lock( _handlers_mutex );
+         for( auto& h : _handlers )
+            l( h );
+      }
+
+   private:
+      std::vector< std::unique_ptr< entry > > _operations;
+      std::vector< std::string >              _operation_type_names;
+
+      std::mutex                              _handlers_mutex;
+      std::deque< entry >                     _handlers;
+      std::map< std::string, entry* >         _handlers_by_name;
+};
+
+} } } // steem::chain::util
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <fc/reflect/reflect.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace steem { namespace chain { namespace util {
+
+struct latency_summary
+{
+   uint64_t count = 0;
+   uint64_t sum   = 0;
+   uint64_t p50   = 0;
+   uint64_t p90   = 0;
+   uint64_t p99   = 0;
+   uint64_t max   = 0;
+};
+
+/// Bucket counts taken by latency_histogram::summarize_since(), to report on the values recorded since then
+struct latency_snapshot
+{
+   uint64_t                sum = 0;
+   std::vector< uint64_t > buckets;
+};
+
+/**
+ * Lock-free log-linear histogram of latencies (in microseconds), in the spirit of HDR histograms.
+ *
+ * Values below 16 get their own buckets, above that every power of two is split into 16 buckets, so reported
+ * percentiles are within 6.25% of the recorded values. Recording is a few relaxed atomic increments, which
+ * makes it cheap enough to stay enabled on hot paths. Any thread may record while another one takes summaries.
+ */
+class latency_histogram
+{
+   public:
+      static const uint32_t SUB_BUCKET_BITS  = 4;
+      static const uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+      /// Values up to 2^MAX_EXPONENT us (about 12 days) are told apart, larger ones land in the last bucket
+      static const uint32_t MAX_EXPONENT     = 40;
+      static const uint32_t BUCKET_COUNT     = SUB_BUCKET_COUNT + ( MAX_EXPONENT - SUB_BUCKET_BITS + 1 ) * SUB_BUCKET_COUNT;
+
+      latency_histogram()
+      {
+         for( auto& b : _buckets )
+            b.store( 0, std::memory_order_relaxed );
+      }
+
+      void record( uint64_t us )
+      {
+         _buckets[ bucket_index( us ) ].fetch_add( 1, std::memory_order_relaxed );
+         _count.fetch_add( 1, std::memory_order_relaxed );
+         _sum.fetch_add( us, std::memory_order_relaxed );
+
+         uint64_t prev_max = _max.load( std::memory_order_relaxed );
+         while( us > prev_max && !_max.compare_exchange_weak( prev_max, us, std::memory_order_relaxed ) ) {}
+      }
+
+      /// Summarizes values recorded so far, optionally starting a new interval and copying out the bucket counts.
+      latency_summary summarize( bool reset = false, std::vector< uint64_t >* bucket_counts = nullptr )
+      {
+         uint64_t counts[ BUCKET_COUNT ];
+
+         for( uint32_t i = 0; i < BUCKET_COUNT; ++i )
+            counts[i] = reset ? _buckets[i].exchange( 0, std::memory_order_relaxed ) : _buckets[i].load( std::memory_order_relaxed );
+
+         uint64_t sum = reset ? _sum.exchange( 0, std::memory_order_relaxed ) : _sum.load( std::memory_order_relaxed );
+         uint64_t max = reset ? _max.exchange( 0, std::memory_order_relaxed ) : _max.load( std::memory_order_relaxed );
+         if( reset )
+            _count.store( 0, std::memory_order_relaxed );
+
+         if( bucket_counts != nullptr )
+            bucket_counts->assign( counts, counts + BUCKET_COUNT );
+
+         return summarize_counts( counts, sum, max );
+      }
+
+      /**
+       * Summarizes values recorded since the previous call with the same snapshot, without disturbing other readers.
+       * The exact maximum is only known for the whole histogram, so the interval maximum has bucket precision.
+       * Must not be mixed with summarize( true ), which resets the counts the snapshot refers to.
+       */
+      latency_summary summarize_since( latency_snapshot& last )const
+      {
+         uint64_t counts[ BUCKET_COUNT ];
+         uint64_t max = 0;
+
+         last.buckets.resize( BUCKET_COUNT, 0 );
+
+         for( uint32_t i = 0; i < BUCKET_COUNT; ++i )
+         {
+            uint64_t current = _buckets[i].load( std::memory_order_relaxed );
+            counts[i] = current - last.buckets[i];
+            last.buckets[i] = current;
+
+            if( counts[i] )
+               max = bucket_value( i );
+         }
+
+         uint64_t sum = _sum.load( std::memory_order_relaxed );
+         uint64_t sum_delta = sum - last.sum;
+         last.sum = sum;
+
+         return summarize_counts( counts, sum_delta, std::min( max, _max.load( std::memory_order_relaxed ) ) );
+      }
+
+      uint64_t count()const { return _count.load( std::memory_order_relaxed ); }
+
+      static uint32_t bucket_index( uint64_t value )
+      {
+         if( value < SUB_BUCKET_COUNT )
+            return value;
+
+         uint32_t exponent = 63 - __builtin_clzll( value );
+         if( exponent > MAX_EXPONENT )
+            return BUCKET_COUNT - 1;
+
+         uint32_t sub_bucket = ( value >> ( exponent - SUB_BUCKET_BITS ) ) & ( SUB_BUCKET_COUNT - 1 );
+         return SUB_BUCKET_COUNT + ( exponent - SUB_BUCKET_BITS ) * SUB_BUCKET_COUNT + sub_bucket;
+      }
+
+      /// Lowest value falling into given bucket
+      static uint64_t bucket_value( uint32_t index )
+      {
+         if( index < SUB_BUCKET_COUNT )
+            return index;
+
+         uint32_t exponent = ( index - SUB_BUCKET_COUNT ) / SUB_BUCKET_COUNT + SUB_BUCKET_BITS;
+         uint64_t sub_bucket = ( index - SUB_BUCKET_COUNT ) % SUB_BUCKET_COUNT;
+         return ( SUB_BUCKET_COUNT + sub_bucket ) << ( exponent - SUB_BUCKET_BITS );
+      }
+
+   private:
+      static latency_summary summarize_counts( const uint64_t* counts, uint64_t sum, uint64_t max )
+      {
+         latency_summary result;
+         result.sum = sum;
+         result.max = max;
+
+         for( uint32_t i = 0; i < BUCKET_COUNT; ++i )
+            result.count += counts[i];
+
+         if( result.count == 0 )
+            return result;
+
+         uint64_t p50_rank = ( result.count * 50 + 99 ) / 100;
+         uint64_t p90_rank = ( result.count * 90 + 99 ) / 100;
+         uint64_t p99_rank = ( result.count * 99 + 99 ) / 100;
+         uint64_t seen = 0;
+
+         for( uint32_t i = 0; i < BUCKET_COUNT; ++i )
+         {
+            if( counts[i] == 0 )
+               continue;
+
+            uint64_t prev = seen;
+            seen += counts[i];
+            uint64_t value = bucket_value( i );
+
+            if( prev < p50_rank && seen >= p50_rank ) result.p50 = value;
+            if( prev < p90_rank && seen >= p90_rank ) result.p90 = value;
+            if( prev < p99_rank && seen >= p99_rank ) result.p99 = value;
+         }
+
+         /// Buckets hold lower bounds, the exact maximum is known and caps the percentiles.
+         result.p50 = std::min( result.p50, result.max );
+         result.p90 = std::min( result.p90, result.max );
+         result.p99 = std::min( result.p99, result.max );
+
+         return result;
+      }
+
+      std::atomic< uint64_t > _buckets[ BUCKET_COUNT ];
+      std::atomic< uint64_t > _count = { 0 };
+      std::atomic< uint64_t > _sum = { 0 };
+      std::atomic< uint64_t > _max = { 0 };
+};
+
+} } } // steem::chain::util
+
+FC_REFLECT( steem::chain::util::latency_summary, (count)(sum)(p50)(p90)(p99)(max) )
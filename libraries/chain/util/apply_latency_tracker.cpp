@@ -0,0 +1,51 @@
+#include <steem/chain/util/apply_latency_tracker.hpp>
+
+#include <steem/protocol/operations.hpp>
+
+namespace steem { namespace chain { namespace util {
+
+namespace detail
+{
+   struct get_operation_type_name
+   {
+      std::string& name;
+      get_operation_type_name( std::string& n ) : name( n ) {}
+
+      typedef void result_type;
+
+      template< typename T > void operator()( const T& )const
+      {
+         name = fc::get_typename< T >::name();
+      }
+   };
+}
+
+apply_latency_tracker::apply_latency_tracker()
+{
+   for( int64_t i = 0; i < protocol::operation::count(); ++i )
+   {
+      protocol::operation op;
+      op.set_which( i );
+
+      std::string type_name;
+      op.visit( detail::get_operation_type_name( type_name ) );
+
+      _operations.emplace_back( new entry( fc::trim_typename_namespace( type_name ) ) );
+      _operation_type_names.push_back( std::move( type_name ) );
+   }
+}
+
+apply_latency_tracker::entry& apply_latency_tracker::register_handler( const std::string& name )
+{
+   std::lock_guard< std::mutex > lock( _handlers_mutex );
+
+   auto itr = _handlers_by_name.find( name );
+   if( itr != _handlers_by_name.end() )
+      return *itr->second;
+
+   _handlers.emplace_back( name );
+   _handlers_by_name[ name ] = &_handlers.back();
+   return _handlers.back();
+}
+
+} } } // steem::chain::util
@@ -24,6 +24,7 @@
 
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
@@ -883,9 +884,23 @@ namespace chainbase {
             return _current_lock;
          }
 
+         /** Set while a thread waits for a write lock, read_contexts give up their lock between reads then */
+         bool writer_waiting()const
+         {
+            return _waiting_writers.load( std::memory_order_relaxed ) > 0;
+         }
+
+         struct waiting_writer
+         {
+            waiting_writer( read_write_mutex_manager& m ) : manager( m ) { ++manager._waiting_writers; }
+            ~waiting_writer() { --manager._waiting_writers; }
+            read_write_mutex_manager& manager;
+         };
+
       private:
          std::array< read_write_mutex, CHAINBASE_NUM_RW_LOCKS >     _locks;
          std::atomic< uint32_t >                                    _current_lock;
+         std::atomic< uint32_t >                                    _waiting_writers = { 0 };
    };
 
    struct lock_exception : public std::exception
@@ -896,6 +911,65 @@ namespace chainbase {
       virtual const char* what() const noexcept { return "Unable to acquire database lock"; }
    };
 
+   class database;
+
+   /**
+    * A read lock scoped to a request rather than to a single call. While a read_context is alive on a
+    * thread, the first database::with_read_lock on that thread acquires the read lock and keeps it until
+    * the context is destroyed, so nested and subsequent read calls run under the same acquisition.
+    *
+    * The lock is given up when the thread takes a write lock, when release() is called and, as soon as no
+    * read is running on the thread, when another thread waits for the write lock or the writer has moved
+    * on to a new lock. Writers are favoured, so holding on would stall them and every other reader.
+    * A context created while another one is active on the same thread does nothing; the outer context
+    * keeps serving the reads.
+    */
+   class read_context
+   {
+      public:
+         read_context();
+         ~read_context();
+
+         read_context( const read_context& ) = delete;
+         read_context& operator=( const read_context& ) = delete;
+
+         /**
+          * Releases the held lock, if any. The next read on this thread acquires it again. Has no effect
+          * while a read is running on this thread, since that read still depends on the lock.
+          */
+         void release();
+
+         static read_context* current() { return _current; }
+
+         /** Releases the lock of the context active on this thread, if there is one. */
+         static void release_current()
+         {
+            if( _current != nullptr )
+               _current->release();
+         }
+
+         /** Releases the held lock when a writer is waiting for it, i.e. between elements of a batch. */
+         void yield();
+
+         uint64_t lock_wait_micros()const { return _lock_wait_micros; }
+         uint32_t acquisitions()const     { return _acquisitions; }
+         uint32_t reuses()const           { return _reuses; }
+
+      private:
+         friend class database;
+
+         read_lock                     _lock;
+         const database*               _db = nullptr;
+         uint32_t                      _lock_num = 0;
+         uint32_t                      _depth = 0;
+
+         uint64_t                      _lock_wait_micros = 0;
+         uint32_t                      _acquisitions = 0;
+         uint32_t                      _reuses = 0;
+
+         static thread_local read_context* _current;
+   };
+
    /**
     *  This class
     */
@@ -932,6 +1006,9 @@ namespace chainbase {
          void resize( size_t new_shared_file_size );
          void set_require_locking( bool enable_require_locking );
 
+         /** True while another thread waits for the write lock */
+         bool writer_waiting()const { return _rw_manager.writer_waiting(); }
+
 #ifdef CHAINBASE_CHECK_LOCKING
          void require_lock_fail( const char* method, const char* lock_type, const char* tname )const;
 
@@ -1205,6 +1282,31 @@ namespace chainbase {
          template< typename Lambda >
          auto with_read_lock( Lambda&& callback, uint64_t wait_micro = 1000000 ) -> decltype( (*(Lambda*)nullptr)() )
          {
+            read_context* ctx = read_context::current();
+
+            if( ctx != nullptr && ( ctx->_db == nullptr || ctx->_db == this ) )
+            {
+#ifdef CHAINBASE_CHECK_LOCKING
+               BOOST_ATTRIBUTE_UNUSED
+               int_incrementer ii( _read_lock_count );
+#endif
+
+               enter_read_context( *ctx, wait_micro );
+
+               struct depth_guard
+               {
+                  depth_guard( read_context& c ) : ctx( c ) { ++ctx._depth; }
+                  ~depth_guard()
+                  {
+                     if( --ctx._depth == 0 )
+                        ctx.yield();
+                  }
+                  read_context& ctx;
+               } guard( *ctx );
+
+               return callback();
+            }
+
 #ifndef ENABLE_MIRA
             read_lock lock( _rw_manager.current_lock(), bip::defer_lock_type() );
 #else
@@ -1232,26 +1334,36 @@ namespace chainbase {
          template< typename Lambda >
          auto with_write_lock( Lambda&& callback, uint64_t wait_micro = 1000000 ) -> decltype( (*(Lambda*)nullptr)() )
          {
+            // A read lock held by this thread's request would block the write lock below
+            read_context* ctx = read_context::current();
+            if( ctx != nullptr && ctx->_db == this )
+               ctx->release();
+
             write_lock lock( _rw_manager.current_lock(), boost::defer_lock_t() );
 #ifdef CHAINBASE_CHECK_LOCKING
             BOOST_ATTRIBUTE_UNUSED
             int_incrementer ii( _write_lock_count );
 #endif
 
-#if !defined ENABLE_MIRA || defined IS_TEST_NET
-            if( wait_micro )
             {
-               while( !lock.timed_lock( boost::posix_time::microsec_clock::universal_time() + boost::posix_time::microseconds( wait_micro ) ) )
+               // Tells read_contexts holding the lock between reads to let go of it
+               read_write_mutex_manager::waiting_writer waiting( _rw_manager );
+
+#if !defined ENABLE_MIRA || defined IS_TEST_NET
+               if( wait_micro )
                {
-                  _rw_manager.next_lock();
-                  std::cerr << "Lock timeout, moving to lock " << _rw_manager.current_lock_num() << std::endl;
-                  lock = write_lock( _rw_manager.current_lock(), boost::defer_lock_t() );
+                  while( !lock.timed_lock( boost::posix_time::microsec_clock::universal_time() + boost::posix_time::microseconds( wait_micro ) ) )
+                  {
+                     _rw_manager.next_lock();
+                     std::cerr << "Lock timeout, moving to lock " << _rw_manager.current_lock_num() << std::endl;
+                     lock = write_lock( _rw_manager.current_lock(), boost::defer_lock_t() );
+                  }
                }
-            }
-            else
+               else
 #endif
-            {
-               lock.lock();
+               {
+                  lock.lock();
+               }
             }
 
             return callback();
@@ -1337,6 +1449,9 @@ namespace chainbase {
 #endif
          }
 
+         /** Makes sure ctx holds a read lock that is current enough for the next read on this thread */
+         void enter_read_context( read_context& ctx, uint64_t wait_micro );
+
          read_write_mutex_manager                                    _rw_manager;
 #ifndef ENABLE_MIRA
          unique_ptr<bip::managed_mapped_file>                        _segment;
@@ -248,6 +248,76 @@ namespace chainbase {
    }
 #endif
 
+   thread_local read_context* read_context::_current = nullptr;
+
+   read_context::read_context()
+   {
+      if( _current == nullptr )
+         _current = this;
+   }
+
+   read_context::~read_context()
+   {
+      if( _current == this )
+      {
+         release();
+         _current = nullptr;
+      }
+   }
+
+   void read_context::release()
+   {
+      if( _lock && _depth == 0 )
+         _lock.unlock();
+   }
+
+   void read_context::yield()
+   {
+      if( _lock && _depth == 0 && _db->writer_waiting() )
+         _lock.unlock();
+   }
+
+   void database::enter_read_context( read_context& ctx, uint64_t wait_micro )
+   {
+      if( ctx._lock )
+      {
+         // A nested read must keep the lock its caller is iterating under, even if it is no longer current
+         // or a writer waits for it
+         if( ctx._depth > 0 || ( ctx._lock_num == _rw_manager.current_lock_num() && !_rw_manager.writer_waiting() ) )
+         {
+            ++ctx._reuses;
+            return;
+         }
+
+         ctx.release();
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      uint32_t lock_num = _rw_manager.current_lock_num();
+
+#ifndef ENABLE_MIRA
+      read_lock lock( _rw_manager.current_lock(), bip::defer_lock_type() );
+#else
+      read_lock lock( _rw_manager.current_lock(), boost::defer_lock_t() );
+#endif
+
+      if( !wait_micro )
+      {
+         lock.lock();
+      }
+      else
+      {
+         if( !lock.timed_lock( boost::posix_time::microsec_clock::universal_time() + boost::posix_time::microseconds( wait_micro ) ) )
+            BOOST_THROW_EXCEPTION( lock_exception() );
+      }
+
+      ctx._lock.swap( lock );
+      ctx._db = this;
+      ctx._lock_num = lock_num;
+      ctx._lock_wait_micros += std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now() - start ).count();
+      ++ctx._acquisitions;
+   }
+
    void database::undo()
    {
       for( auto& item : _index_list )
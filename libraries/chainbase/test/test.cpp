@@ -7,7 +7,9 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/member.hpp>
 
+#include <atomic>
 #include <iostream>
+#include <thread>
 
 using namespace chainbase;
 using namespace boost::multi_index;
@@ -138,5 +140,97 @@ BOOST_AUTO_TEST_CASE( open_and_create ) {
    }
 }
 
+BOOST_AUTO_TEST_CASE( read_context_reuses_lock ) {
+   boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+
+      {
+         chainbase::read_context ctx;
+         BOOST_REQUIRE( chainbase::read_context::current() == &ctx );
+
+         db.with_read_lock( [&]() {} );
+         db.with_read_lock( [&]()
+         {
+            db.with_read_lock( [&]() {} ); /// nested read keeps the same lock
+         });
+         BOOST_REQUIRE_EQUAL( ctx.acquisitions(), 1u );
+         BOOST_REQUIRE_EQUAL( ctx.reuses(), 2u );
+
+         {
+            chainbase::read_context inner; /// does not replace the active context
+            BOOST_REQUIRE( chainbase::read_context::current() == &ctx );
+            db.with_read_lock( [&]() {} );
+         }
+         BOOST_REQUIRE_EQUAL( ctx.reuses(), 3u );
+
+         db.with_write_lock( [&]() {} ); /// gives up the read lock instead of blocking on it
+         db.with_read_lock( [&]() {} );
+         BOOST_REQUIRE_EQUAL( ctx.acquisitions(), 2u );
+
+         ctx.release();
+         db.with_read_lock( [&]() {} );
+         BOOST_REQUIRE_EQUAL( ctx.acquisitions(), 3u );
+      }
+
+      BOOST_REQUIRE( chainbase::read_context::current() == nullptr );
+      db.with_write_lock( [&]() {} ); /// lock was released with the context
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( read_context_yields_to_writer ) {
+   boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+
+      chainbase::read_context ctx;
+      std::atomic< bool > written( false );
+      std::thread writer;
+
+      auto start_writer = [&]()
+      {
+         writer = std::thread( [&]()
+         {
+            db.with_write_lock( [&]() { written = true; }, 10000000 );
+         });
+
+         while( !db.writer_waiting() )
+            std::this_thread::yield();
+      };
+
+      db.with_read_lock( [&]()
+      {
+         start_writer();
+         db.with_read_lock( [&]() {} ); /// nested read keeps the lock while the writer waits
+         BOOST_REQUIRE( !written );
+      });
+
+      /// Lock was dropped when the top level read returned, the writer does not wait for the next read
+      writer.join();
+      BOOST_REQUIRE( written );
+      BOOST_REQUIRE_EQUAL( ctx.acquisitions(), 1u );
+
+      /// A lock still held from an earlier read is not reused once a writer waits for it
+      db.with_read_lock( [&]() {} );
+      written = false;
+      start_writer();
+      db.with_read_lock( [&]() { BOOST_REQUIRE( written ); } );
+      writer.join();
+      BOOST_REQUIRE_EQUAL( ctx.acquisitions(), 3u );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
 // BOOST_AUTO_TEST_SUITE_END()
 #endif
@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <limits>
 #include <string>
@@ -571,11 +572,11 @@ public:
    std::vector<bloom_type> salt_;
    std::vector<unsigned char>   bit_table_;
    unsigned int            salt_count_;
-   unsigned long long int  table_size_;
-   unsigned long long int  raw_table_size_;
-   unsigned long long int  projected_element_count_;
+   uint64_t                table_size_;
+   uint64_t                raw_table_size_;
+   uint64_t                projected_element_count_;
    unsigned int            inserted_element_count_;
-   unsigned long long int  random_seed_;
+   uint64_t                random_seed_;
    double                  desired_false_positive_probability_;
 };
 
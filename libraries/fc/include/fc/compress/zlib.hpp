@@ -7,4 +7,10 @@ namespace fc
 
   string zlib_compress(const string& in);
 
+  /** zlib stream (HTTP "deflate" content coding) at the given level, 0 (store) to 9 (smallest) */
+  string zlib_compress(const string& in, int level);
+
+  /** gzip member (HTTP "gzip" content coding) at the given level, 0 (store) to 9 (smallest) */
+  string gzip_compress(const string& in, int level = 6);
+
 } // namespace fc
@@ -1,4 +1,5 @@
 #include <fc/compress/zlib.hpp>
+#include <fc/exception/exception.hpp>
 
 #include "miniz.c"
 
@@ -12,4 +13,44 @@ namespace fc
     free(compressed_message);
     return result;
   }
+
+  namespace
+  {
+    string deflate_to_string(const string& in, int flags)
+    {
+      size_t compressed_message_length = 0;
+      char* compressed_message = (char*)tdefl_compress_mem_to_heap(in.c_str(), in.size(), &compressed_message_length, flags);
+      FC_ASSERT( compressed_message != nullptr, "deflate failed" );
+      string result(compressed_message, compressed_message_length);
+      free(compressed_message);
+      return result;
+    }
+
+    void append_le32(string& out, uint32_t v)
+    {
+      for( int i = 0; i < 4; ++i )
+        out.push_back( char( ( v >> ( 8 * i ) ) & 0xff ) );
+    }
+  }
+
+  string zlib_compress(const string& in, int level)
+  {
+    return deflate_to_string(in, tdefl_create_comp_flags_from_zip_params(level, MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+  }
+
+  string gzip_compress(const string& in, int level)
+  {
+    // RFC 1952: fixed header (deflate, no flags, no mtime, unix), raw deflate data, crc32 and size trailer
+    static const char header[] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, 3 };
+
+    string body = deflate_to_string(in, tdefl_create_comp_flags_from_zip_params(level, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+
+    string result;
+    result.reserve(sizeof(header) + body.size() + 8);
+    result.append(header, sizeof(header));
+    result.append(body);
+    append_le32(result, uint32_t(mz_crc32(MZ_CRC32_INIT, (const unsigned char*)in.data(), in.size())));
+    append_le32(result, uint32_t(in.size()));
+    return result;
+  }
 }
@@ -9,6 +9,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstring>
 
 #include <boost/filesystem/fstream.hpp>
 
@@ -29,6 +30,41 @@ namespace fc
     template<typename T> void to_stream( T& os, const variant_object& o, json::output_formatting format );
     template<typename T> void to_stream( T& os, const variant& v, json::output_formatting format );
     fc::string pretty_print( const fc::string& v, uint8_t indent );
+
+   /**
+    * Parser input over a contiguous buffer. Has the same peek()/get() contract as fc::stringstream,
+    * throwing eof_exception past the end, without a virtual stream call per character, and lets
+    * string contents be copied a run at a time.
+    */
+   class json_buffer_stream
+   {
+      public:
+         json_buffer_stream( const char* begin, const char* end ) : _pos( begin ), _end( end ) {}
+
+         char peek()const
+         {
+            if( _pos == _end )
+               FC_THROW_EXCEPTION( eof_exception, "json_buffer_stream" );
+            return *_pos;
+         }
+
+         char get()
+         {
+            if( _pos == _end )
+               FC_THROW_EXCEPTION( eof_exception, "json_buffer_stream" );
+            return *_pos++;
+         }
+
+         const char* pos()const { return _pos; }
+         const char* end()const { return _end; }
+         void        skip( size_t n ) { _pos += n; }
+
+      private:
+         const char* _pos;
+         const char* _end;
+   };
+
+   fc::string stringFromStream( json_buffer_stream& in, uint32_t depth = 0 );
 }
 
 #include <fc/io/json_relaxed.hpp>
@@ -122,6 +158,93 @@ namespace fc
        } FC_RETHROW_EXCEPTIONS( warn, "while parsing token '${token}'",
                                           ("token", token.str() ) );
    }
+   namespace detail
+   {
+      /*
+       * Word at a time scanning, 8 bytes per step. The classic "has zero byte" trick, applied after
+       * xor'ing with a repeated character, flags any byte equal to that character. Bytes below a
+       * small bound are flagged the same way without the xor.
+       */
+      const uint64_t repeated_ones = 0x0101010101010101ull;
+      const uint64_t high_bits     = 0x8080808080808080ull;
+
+      inline uint64_t has_zero_byte( uint64_t w ) { return ( w - repeated_ones ) & ~w & high_bits; }
+      inline uint64_t has_byte( uint64_t w, uint8_t c ) { return has_zero_byte( w ^ ( repeated_ones * c ) ); }
+      inline uint64_t has_byte_less_than( uint64_t w, uint8_t n ) { return ( w - repeated_ones * n ) & ~w & high_bits; }
+
+      inline uint64_t load_word( const char* p )
+      {
+         uint64_t w;
+         memcpy( &w, p, sizeof( w ) );
+         return w;
+      }
+
+      /// Length of the prefix that a JSON string can contain verbatim: no '"', '\\' or ^D (the legacy EOF marker)
+      inline size_t plain_string_run( const char* begin, const char* end )
+      {
+         const char* p = begin;
+         for( ; end - p >= 8; p += 8 )
+         {
+            uint64_t w = load_word( p );
+            if( has_byte( w, '"' ) | has_byte( w, '\\' ) | has_byte( w, 0x04 ) )
+               break;
+         }
+         while( p != end && *p != '"' && *p != '\\' && *p != 0x04 )
+            ++p;
+         return p - begin;
+      }
+
+      /// Length of the prefix that can be written without escaping: no control characters, '"' or '\\'
+      inline size_t unescaped_run( const char* begin, const char* end )
+      {
+         const char* p = begin;
+         for( ; end - p >= 8; p += 8 )
+         {
+            uint64_t w = load_word( p );
+            if( has_byte_less_than( w, 0x20 ) | has_byte( w, '"' ) | has_byte( w, '\\' ) )
+               break;
+         }
+         while( p != end && uint8_t( *p ) >= 0x20 && *p != '"' && *p != '\\' )
+            ++p;
+         return p - begin;
+      }
+   }
+
+   fc::string stringFromStream( json_buffer_stream& in, uint32_t depth )
+   {
+      fc::string token;
+      try
+      {
+         char c = in.peek();
+
+         if( c != '"' )
+            FC_THROW_EXCEPTION( parse_error_exception,
+                                            "Expected '\"' but read '${char}'",
+                                            ("char", string(&c, (&c) + 1) ) );
+         in.get();
+         while( true )
+         {
+            size_t run = detail::plain_string_run( in.pos(), in.end() );
+            token.append( in.pos(), run );
+            in.skip( run );
+
+            switch( in.peek() )
+            {
+               case '\\':
+                  token += parseEscape( in, depth );
+                  break;
+               case 0x04:
+                  FC_THROW_EXCEPTION( parse_error_exception, "EOF before closing '\"' in string '${token}'",
+                                                   ("token", token ) );
+               default: // '"'
+                  in.get();
+                  return token;
+            }
+         }
+       } FC_RETHROW_EXCEPTIONS( warn, "while parsing token '${token}'",
+                                          ("token", token ) );
+   }
+
    template<typename T>
    fc::string stringFromToken( T& in, uint32_t depth )
    {
@@ -471,18 +594,24 @@ namespace fc
       FC_ASSERT( depth <= JSON_MAX_RECURSION_DEPTH );
       check_string_depth( utf8_str );
 
-      fc::stringstream in( utf8_str );
+      json_buffer_stream buf( utf8_str.data(), utf8_str.data() + utf8_str.size() );
       //in.exceptions( std::ifstream::eofbit );
       switch( ptype )
       {
           case legacy_parser:
-              return variant_from_stream<fc::stringstream, legacy_parser>( in, depth );
+              return variant_from_stream<json_buffer_stream, legacy_parser>( buf, depth );
           case legacy_parser_with_string_doubles:
-              return variant_from_stream<fc::stringstream, legacy_parser_with_string_doubles>( in, depth );
+              return variant_from_stream<json_buffer_stream, legacy_parser_with_string_doubles>( buf, depth );
           case strict_parser:
+          {
+              fc::stringstream in( utf8_str );
               return json_relaxed::variant_from_stream<fc::stringstream, true>( in, depth );
+          }
           case relaxed_parser:
+          {
+              fc::stringstream in( utf8_str );
               return json_relaxed::variant_from_stream<fc::stringstream, false>( in, depth );
+          }
           default:
               FC_ASSERT( false, "Unknown JSON parser type {ptype}", ("ptype", ptype) );
       }
@@ -526,8 +655,19 @@ namespace fc
    void escape_string( const string& str, ostream& os, uint32_t )
    {
       os << '"';
-      for( auto itr = str.begin(); itr != str.end(); ++itr )
+      const char* end = str.data() + str.size();
+      for( const char* itr = str.data(); itr != end; ++itr )
       {
+         // Write everything up to the next character that needs escaping in one go
+         size_t run = detail::unescaped_run( itr, end );
+         if( run )
+         {
+            os.write( itr, run );
+            itr += run;
+            if( itr == end )
+               break;
+         }
+
          switch( *itr )
          {
             case '\b':        // \x08
@@ -86,4 +86,32 @@ BOOST_AUTO_TEST_CASE(zlib_test)
     BOOST_CHECK_EQUAL( decomp, line );
 }
 
+BOOST_AUTO_TEST_CASE(gzip_test)
+{
+    std::string line;
+    for( int i = 0; i < 1000; ++i )
+        line += "{\"jsonrpc\":\"2.0\",\"result\":" + std::to_string( i ) + "}";
+
+    for( int level : { 0, 1, 6, 9 } )
+    {
+        std::string compressed = fc::gzip_compress( line, level );
+        BOOST_REQUIRE_GT( compressed.size(), 18u );
+        BOOST_CHECK_EQUAL( (unsigned char)compressed[0], 0x1f );
+        BOOST_CHECK_EQUAL( (unsigned char)compressed[1], 0x8b );
+
+        // Trailer ends with the uncompressed size, little endian
+        uint32_t size = 0;
+        for( int i = 0; i < 4; ++i )
+            size |= uint32_t( (unsigned char)compressed[ compressed.size() - 4 + i ] ) << ( 8 * i );
+        BOOST_CHECK_EQUAL( size, line.size() );
+
+        size_t decomp_len;
+        char* decomp = tinfl_decompress_mem_to_heap( compressed.c_str() + 10, compressed.size() - 18, &decomp_len, 0 );
+        BOOST_CHECK_EQUAL( std::string( decomp, decomp_len ), line );
+        free( decomp );
+
+        BOOST_CHECK_EQUAL( zlib_decompress( fc::zlib_compress( line, level ) ), line );
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,58 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
+
+using namespace fc;
+
+BOOST_AUTO_TEST_SUITE(fc_json)
+
+BOOST_AUTO_TEST_CASE(escape_round_trip)
+{
+   // Long enough to cover both the word at a time and the byte at a time paths
+   std::string plain = "The quick brown fox jumps over the lazy dog, \xe2\x9c\x93 utf8 passes through";
+   BOOST_CHECK_EQUAL( json::to_string( variant( plain ) ), "\"" + plain + "\"" );
+
+   std::string special;
+   for( int c = 0; c < 0x20; ++c )
+      special += char( c );
+   special += "\"\\/abcdefghijklmnopqrstuvwxyz\"";
+
+   std::string json_str = json::to_string( variant( special ) );
+   BOOST_CHECK( json_str.find( "\\u0000" ) != std::string::npos );
+   BOOST_CHECK( json_str.find( "\\n" ) != std::string::npos );
+   BOOST_CHECK( json_str.find( "\\\"abc" ) != std::string::npos );
+
+   variant_object obj = mutable_variant_object( "a\"key", "a\tvalue with \\ a backslash in the middle of a long string" )( "n", 42 );
+   variant parsed = json::from_string( json::to_string( obj ) );
+   BOOST_REQUIRE( parsed.is_object() );
+   BOOST_CHECK_EQUAL( parsed[ "a\"key" ].as_string(), "a\tvalue with \\ a backslash in the middle of a long string" );
+   BOOST_CHECK_EQUAL( parsed[ "n" ].as_uint64(), 42u );
+}
+
+BOOST_AUTO_TEST_CASE(parse_buffer)
+{
+   variant v = json::from_string( "{\"jsonrpc\":\"2.0\", \"method\": \"condenser_api.get_block\", \"params\":[1, -2, 3.5, true, null, \"\"], \"id\":1}" );
+   BOOST_REQUIRE( v.is_object() );
+   BOOST_CHECK_EQUAL( v[ "method" ].as_string(), "condenser_api.get_block" );
+
+   const variants& params = v[ "params" ].get_array();
+   BOOST_REQUIRE_EQUAL( params.size(), 6u );
+   BOOST_CHECK_EQUAL( params[0].as_uint64(), 1u );
+   BOOST_CHECK_EQUAL( params[1].as_int64(), -2 );
+   BOOST_CHECK( params[3].as_bool() );
+   BOOST_CHECK( params[4].is_null() );
+   BOOST_CHECK_EQUAL( params[5].as_string(), "" );
+
+   // A number at the very end of the input ends at EOF rather than at a delimiter
+   BOOST_CHECK_EQUAL( json::from_string( "12345" ).as_uint64(), 12345u );
+   BOOST_CHECK_EQUAL( json::from_string( "\"a string that is longer than one word\"" ).as_string(), "a string that is longer than one word" );
+
+   BOOST_CHECK_THROW( json::from_string( "\"unterminated string" ), fc::exception );
+   BOOST_CHECK_THROW( json::from_string( "{\"a\":" ), fc::exception );
+   BOOST_CHECK_THROW( json::from_string( "[1,2" ), fc::exception );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -79,6 +79,26 @@
 
 #define GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES           2
 
+/**
+ * When the advertise inventory loop is woken up by a new item, it waits this
+ * long before building inventory messages so that items arriving close together
+ * are announced to each peer in a single message instead of one message apiece.
+ */
+#define GRAPHENE_NET_INVENTORY_BATCH_INTERVAL_MS             50
+
+/**
+ * Peers that support it periodically exchange a bloom filter of the transactions
+ * they learned about since their previous summary.  We skip advertising (and
+ * tracking) any transaction the peer's recent summaries say it already has.
+ * A false positive only means that peer hears about the transaction from
+ * someone else.
+ */
+#define GRAPHENE_NET_KNOWN_ITEMS_SUMMARY_INTERVAL_SECONDS    3
+#define GRAPHENE_NET_KNOWN_ITEMS_SUMMARIES_TO_KEEP           4
+#define GRAPHENE_NET_KNOWN_ITEMS_SUMMARY_FALSE_POSITIVE_RATE 0.001
+#define GRAPHENE_NET_KNOWN_ITEMS_SUMMARY_MAX_ITEMS           (GRAPHENE_NET_MAX_TRX_PER_SECOND * GRAPHENE_NET_KNOWN_ITEMS_SUMMARY_INTERVAL_SECONDS)
+#define GRAPHENE_NET_KNOWN_ITEMS_SUMMARY_MAX_TABLE_BYTES     (64 * 1024)
+
 #define GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING      200
 
 /**
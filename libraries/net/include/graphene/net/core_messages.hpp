@@ -26,6 +26,7 @@
 #include <graphene/net/config.hpp>
 #include <steem/protocol/block.hpp>
 
+#include <fc/bloom_filter.hpp>
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/crypto/elliptic.hpp>
 #include <fc/crypto/sha256.hpp>
@@ -86,6 +87,7 @@ namespace graphene { namespace net {
     check_firewall_reply_message_type            = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type   = 5017,
+    known_items_summary_message_type             = 5018,
     core_message_type_last                       = 5099
   };
 
@@ -397,6 +399,26 @@ namespace graphene { namespace net {
     std::vector<current_connection_data> current_connections;
   };
 
+  /**
+   * Sent periodically to peers that announced "known_items_summary" in their hello
+   * user_data.  The filter holds the hashes of the items of @ref item_type that we
+   * learned about since the previous summary, so the receiver can avoid advertising
+   * them back to us.
+   */
+  struct known_items_summary_message
+  {
+    static const core_message_type_enum type;
+
+    uint32_t         item_type;
+    fc::bloom_filter known_items;
+
+    known_items_summary_message() {}
+    known_items_summary_message(uint32_t item_type, const fc::bloom_filter& known_items) :
+      item_type(item_type),
+      known_items(known_items)
+    {}
+  };
+
 
 } } // graphene::net
 
@@ -421,6 +443,7 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (check_firewall_reply_message_type)
                  (get_current_connections_request_message_type)
                  (get_current_connections_reply_message_type)
+                 (known_items_summary_message_type)
                  (core_message_type_last) )
 
 FC_REFLECT( graphene::net::trx_message, (trx) )
@@ -504,6 +527,8 @@ FC_REFLECT(graphene::net::get_current_connections_reply_message, (upload_rate_on
                                                             (upload_rate_one_hour)
                                                             (download_rate_one_hour)
                                                             (current_connections))
+FC_REFLECT(graphene::net::known_items_summary_message, (item_type)
+                                                  (known_items))
 
 #include <unordered_map>
 #include <fc/crypto/city.hpp>
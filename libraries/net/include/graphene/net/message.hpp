@@ -29,6 +29,8 @@
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <memory>
+
 namespace graphene { namespace net {
 
   /**
@@ -108,6 +110,13 @@ namespace graphene { namespace net {
      }
   };
 
+  /**
+   *  Received messages are handed around by reference count so the same buffer
+   *  the socket decrypted into can be cached and relayed to other peers without
+   *  being copied or re-packed.  The contents must not be modified once shared.
+   */
+  typedef std::shared_ptr<const message> message_ptr;
+
 
 
 
@@ -35,7 +35,7 @@ namespace graphene { namespace net {
   class message_oriented_connection_delegate 
   {
   public:
-    virtual void on_message(message_oriented_connection* originating_connection, const message& received_message) = 0;
+    virtual void on_message(message_oriented_connection* originating_connection, const message_ptr& received_message) = 0;
     virtual void on_connection_closed(message_oriented_connection* originating_connection) = 0;
   };
 
@@ -41,6 +41,7 @@
 #include <boost/multi_index/hashed_index.hpp>
 
 #include <queue>
+#include <deque>
 #include <boost/container/deque.hpp>
 #include <fc/thread/future.hpp>
 
@@ -66,9 +67,9 @@ namespace graphene { namespace net
     {
     public:
       virtual void on_message(peer_connection* originating_peer,
-                              const message& received_message) = 0;
+                              const message_ptr& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-      virtual message get_message_for_item(const item_id& item) = 0;
+      virtual message_ptr get_message_for_item(const item_id& item) = 0;
     };
 
     class peer_connection;
@@ -123,7 +124,7 @@ namespace graphene { namespace net
           enqueue_time(enqueue_time)
         {}
 
-        virtual message get_message(peer_connection_delegate* node) = 0;
+        virtual message_ptr get_message(peer_connection_delegate* node) = 0;
         /** returns roughly the number of bytes of memory the message is consuming while
          * it is sitting on the queue
          */
@@ -131,21 +132,21 @@ namespace graphene { namespace net
         virtual ~queued_message() {}
       };
 
-      /* when you queue up a 'real_queued_message', a full copy of the message is
-       * stored on the heap until it is sent
+      /* when you queue up a 'real_queued_message', a reference to the message is
+       * held until it is sent.  Messages relayed to several peers share one buffer.
        */
       struct real_queued_message : queued_message
       {
-        message        message_to_send;
+        message_ptr    message_to_send;
         size_t         message_send_time_field_offset;
 
-        real_queued_message(message message_to_send,
+        real_queued_message(message_ptr message_to_send,
                             size_t message_send_time_field_offset = (size_t)-1) :
           message_to_send(std::move(message_to_send)),
           message_send_time_field_offset(message_send_time_field_offset)
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        message_ptr get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
@@ -161,7 +162,7 @@ namespace graphene { namespace net
           item_to_send(std::move(item_to_send))
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        message_ptr get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
@@ -258,6 +259,9 @@ namespace graphene { namespace net
       timestamped_items_set_type inventory_peer_advertised_to_us;
       timestamped_items_set_type inventory_advertised_to_peer;
 
+      bool peer_accepts_known_items_summary = false; /// true if the peer's hello says it understands known_items_summary_message
+      std::deque<fc::bloom_filter> known_transactions_summaries; /// the most recent transaction summaries the peer sent us, oldest first
+
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
       /// @}
 
@@ -287,11 +291,12 @@ namespace graphene { namespace net
       void accept_connection();
       void connect_to(const fc::ip::endpoint& remote_endpoint, fc::optional<fc::ip::endpoint> local_endpoint = fc::optional<fc::ip::endpoint>());
 
-      void on_message(message_oriented_connection* originating_connection, const message& received_message) override;
+      void on_message(message_oriented_connection* originating_connection, const message_ptr& received_message) override;
       void on_connection_closed(message_oriented_connection* originating_connection) override;
 
       void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+      void send_message(const message_ptr& message_to_send);
       void send_item(const item_id& item_to_send);
       void close_connection();
       void destroy_connection(const char* caller);
@@ -313,6 +318,8 @@ namespace graphene { namespace net
       bool is_transaction_fetching_inhibited() const;
       fc::sha512 get_shared_secret() const;
       void clear_old_inventory();
+      void add_known_transactions_summary(const fc::bloom_filter& summary);
+      bool is_transaction_in_known_summaries(const item_hash_t& transaction_hash) const;
       bool is_inventory_advertised_to_us_list_full_for_transactions() const;
       bool is_inventory_advertised_to_us_list_full() const;
       bool performing_firewall_check() const;
@@ -63,6 +63,7 @@ namespace graphene { namespace net {
       fc::time_point _last_message_sent_time;
 
       bool _send_message_in_progress;
+      std::vector<char> _send_buffer; /// reused between sends so padding a message doesn't cost an allocation each time
 #ifndef NDEBUG
       fc::thread* _thread;
 #endif
@@ -152,9 +153,13 @@ namespace graphene { namespace net {
 
       try
       {
-        message m;
         while( true )
         {
+          // every message gets a buffer of its own: the socket decrypts straight into it and the
+          // node keeps a reference to it for caching and relaying, so it must not be reused
+          std::shared_ptr<message> received_message = std::make_shared<message>();
+          message& m = *received_message;
+
           char buffer[BUFFER_SIZE];
           _sock.read(buffer, BUFFER_SIZE);
           _bytes_received += BUFFER_SIZE;
@@ -167,7 +172,8 @@ namespace graphene { namespace net {
           std::copy(buffer + sizeof(message_header), buffer + sizeof(buffer), m.data.begin());
           if (remaining_bytes_with_padding)
           {
-            _sock.read(&m.data[LEFTOVER], remaining_bytes_with_padding);
+            // alias the message's own storage so the socket decrypts the body in place
+            _sock.read(std::shared_ptr<char>(received_message, m.data.data()), remaining_bytes_with_padding, LEFTOVER);
             _bytes_received += remaining_bytes_with_padding;
           }
           m.data.resize(m.size); // truncate off the padding bytes
@@ -177,7 +183,7 @@ namespace graphene { namespace net {
           try
           {
             // message handling errors are warnings...
-            _delegate->on_message(_self, m);
+            _delegate->on_message(_self, received_message);
           }
           /// Dedicated catches needed to distinguish from general fc::exception
           catch ( const fc::canceled_exception& e ) { throw e; }
@@ -260,16 +266,23 @@ namespace graphene { namespace net {
            elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
         //pad the message we send to a multiple of 16 bytes
         size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
+        if (_send_buffer.size() < size_with_padding)
+          _send_buffer.resize(size_with_padding);
+        char* padded_message = _send_buffer.data();
 
-        memcpy(padded_message.get(), (char*)&message_to_send, sizeof(message_header));
-        memcpy(padded_message.get() + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
-        char* paddingSpace = padded_message.get() + sizeof(message_header) + message_to_send.size;
+        memcpy(padded_message, (char*)&message_to_send, sizeof(message_header));
+        memcpy(padded_message + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
+        char* paddingSpace = padded_message + sizeof(message_header) + message_to_send.size;
         size_t toClean = size_with_padding - size_of_message_and_header;
         memset(paddingSpace, 0, toClean);
 
-        _sock.write(padded_message.get(), size_with_padding);
+        _sock.write(padded_message, size_with_padding);
         _sock.flush();
+
+        // don't let one large block pin a big buffer on every connection
+        const size_t MAX_RETAINED_SEND_BUFFER_SIZE = 64 * 1024;
+        if (_send_buffer.size() > MAX_RETAINED_SEND_BUFFER_SIZE)
+          std::vector<char>().swap(_send_buffer);
         _bytes_sent += size_with_padding;
         _last_message_sent_time = fc::time_point::now();
       } FC_RETHROW_EXCEPTIONS( warn, "unable to send message" );
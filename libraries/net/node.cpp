@@ -126,6 +126,34 @@ namespace graphene { namespace net {
   namespace detail
   {
     namespace bmi = boost::multi_index;
+
+    // block_message is reflected as (block)(block_id), so the packed id is the last thing in the
+    // message.  Reading it from there saves unpacking an entire block just to learn its id
+    static block_id_type get_block_id_from_packed_block_message(const message& packed_block_message)
+    {
+      FC_ASSERT(packed_block_message.msg_type == block_message_type &&
+                packed_block_message.data.size() >= sizeof(block_id_type));
+      block_id_type block_id;
+      memcpy(block_id.data(), packed_block_message.data.data() + packed_block_message.data.size() - sizeof(block_id_type),
+             sizeof(block_id_type));
+      return block_id;
+    }
+
+    // blocks we accept are cached and relayed as the bytes we received, and the trailing id is what
+    // get_block_id_from_packed_block_message() trusts later on.  So only accept a packed block whose
+    // payload unpacks to exactly one block_message whose block_id is the id of its block
+    static graphene::net::block_message unpack_block_message(const message& packed_block_message)
+    {
+      FC_ASSERT(packed_block_message.msg_type == block_message_type);
+      graphene::net::block_message unpacked_block_message;
+      fc::datastream<const char*> ds(packed_block_message.data.data(), packed_block_message.data.size());
+      fc::raw::unpack(ds, unpacked_block_message);
+      FC_ASSERT(ds.remaining() == 0, "block message has ${n} trailing bytes", ("n", ds.remaining()));
+      FC_ASSERT(unpacked_block_message.block_id == unpacked_block_message.block.id(),
+                "block message claims id ${claimed} for block ${actual}",
+                ("claimed", unpacked_block_message.block_id)("actual", unpacked_block_message.block.id()));
+      return unpacked_block_message;
+    }
     class blockchain_tied_message_cache
     {
     private:
@@ -137,7 +165,7 @@ namespace graphene { namespace net {
       struct message_info
       {
         message_hash_type message_hash;
-        message           message_body;
+        message_ptr       message_body;
         uint32_t          block_clock_when_received;
 
         // for network performance stats
@@ -145,7 +173,7 @@ namespace graphene { namespace net {
         fc::uint160_t     message_contents_hash; // hash of whatever the message contains (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
 
         message_info( const message_hash_type& message_hash,
-                      const message&           message_body,
+                      const message_ptr&       message_body,
                       uint32_t                 block_clock_when_received,
                       const message_propagation_data& propagation_data,
                       fc::uint160_t            message_contents_hash ) :
@@ -175,9 +203,9 @@ namespace graphene { namespace net {
         block_clock( 0 )
       {}
       void block_accepted();
-      void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
+      void cache_message( const message_ptr& message_to_cache, const message_hash_type& hash_of_message_to_cache,
                         const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
-      message get_message( const message_hash_type& hash_of_message_to_lookup );
+      message_ptr get_message( const message_hash_type& hash_of_message_to_lookup );
       message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
       size_t size() const { return _message_cache.size(); }
     };
@@ -190,7 +218,7 @@ namespace graphene { namespace net {
                                                       _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks ) );
     }
 
-    void blockchain_tied_message_cache::cache_message( const message& message_to_cache,
+    void blockchain_tied_message_cache::cache_message( const message_ptr& message_to_cache,
                                                      const message_hash_type& hash_of_message_to_cache,
                                                      const message_propagation_data& propagation_data,
                                                      const fc::uint160_t& message_content_hash )
@@ -202,7 +230,7 @@ namespace graphene { namespace net {
                                          message_content_hash ) );
     }
 
-    message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
+    message_ptr blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
     {
       message_cache_container::index<message_hash_index>::type::const_iterator iter =
          _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
@@ -451,6 +479,12 @@ namespace graphene { namespace net {
       std::unordered_set<item_id>   _new_inventory; /// list of items we have received but not yet advertised to our peers
       // @}
 
+      /// used by the task that sends bloom filter summaries of recently learned transactions to our peers
+      // @{
+      fc::future<void>              _known_items_summary_loop_done;
+      std::vector<item_hash_t>      _transactions_known_since_last_summary;
+      // @}
+
       fc::future<void>     _terminate_inactive_connections_loop_done;
       uint8_t _recent_block_interval_in_seconds; // a cached copy of the block interval, to avoid a thread hop to the blockchain to get the current value
 
@@ -559,6 +593,8 @@ namespace graphene { namespace net {
       void advertise_inventory_loop();
       void trigger_advertise_inventory_loop();
 
+      void known_items_summary_loop();
+
       void terminate_inactive_connections_loop();
 
       void fetch_updated_peer_lists_loop();
@@ -582,7 +618,7 @@ namespace graphene { namespace net {
       void parse_hello_user_data_for_peer( peer_connection* originating_peer, const fc::variant_object& user_data );
 
       void on_message( peer_connection* originating_peer,
-                       const message& received_message ) override;
+                       const message_ptr& received_message_ptr ) override;
 
       void on_hello_message( peer_connection* originating_peer,
                              const hello_message& hello_message_received );
@@ -637,16 +673,19 @@ namespace graphene { namespace net {
       void on_get_current_connections_reply_message(peer_connection* originating_peer,
                                                     const get_current_connections_reply_message& get_current_connections_reply_message_received);
 
+      void on_known_items_summary_message(peer_connection* originating_peer,
+                                          const known_items_summary_message& known_items_summary_message_received);
+
       void on_connection_closed(peer_connection* originating_peer) override;
 
       void send_sync_block_to_node_delegate(const graphene::net::block_message& block_message_to_send);
       void process_backlog_of_sync_blocks();
       void trigger_process_backlog_of_sync_blocks();
       void process_block_during_sync(peer_connection* originating_peer, const graphene::net::block_message& block_message, const message_hash_type& message_hash);
-      void process_block_during_normal_operation(peer_connection* originating_peer, const graphene::net::block_message& block_message, const message_hash_type& message_hash);
-      void process_block_message(peer_connection* originating_peer, const message& message_to_process, const message_hash_type& message_hash);
+      void process_block_during_normal_operation(peer_connection* originating_peer, const graphene::net::block_message& block_message, const message_hash_type& message_hash, const message_ptr& message_to_relay);
+      void process_block_message(peer_connection* originating_peer, const message_ptr& message_to_process, const message_hash_type& message_hash);
 
-      void process_ordinary_message(peer_connection* originating_peer, const message& message_to_process, const message_hash_type& message_hash);
+      void process_ordinary_message(peer_connection* originating_peer, const message_ptr& message_to_process, const message_hash_type& message_hash);
 
       void start_synchronizing();
       void start_synchronizing_with_peer(const peer_connection_ptr& peer);
@@ -693,6 +732,7 @@ namespace graphene { namespace net {
       std::vector<peer_status> get_connected_peers() const;
       uint32_t                 get_connection_count() const;
 
+      void broadcast(const message_ptr& item_to_broadcast, const message_propagation_data& propagation_data, const fc::uint160_t& hash_of_message_contents);
       void broadcast(const message& item_to_broadcast, const message_propagation_data& propagation_data);
       void broadcast(const message& item_to_broadcast);
       void sync_from(const item_id& current_head_block, const std::vector<uint32_t>& hard_fork_block_numbers);
@@ -709,7 +749,7 @@ namespace graphene { namespace net {
       void                       clear_peer_database();
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
       fc::variant_object         get_call_statistics() const;
-      message                    get_message_for_item(const item_id& item) override;
+      message_ptr                get_message_for_item(const item_id& item) override;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
@@ -1266,6 +1306,11 @@ namespace graphene { namespace net {
         std::unordered_set<item_id> inventory_to_advertise;
         inventory_to_advertise.swap(_new_inventory);
 
+        for (const item_id& item_to_advertise : inventory_to_advertise)
+          if (item_to_advertise.item_type == trx_message_type &&
+              _transactions_known_since_last_summary.size() < GRAPHENE_NET_KNOWN_ITEMS_SUMMARY_MAX_ITEMS)
+            _transactions_known_since_last_summary.push_back(item_to_advertise.item_hash);
+
         // process all inventory to advertise and construct the inventory messages we'll send
         // first, then send them all in a batch (to avoid any fiber interruption points while
         // we're computing the messages)
@@ -1290,6 +1335,12 @@ namespace graphene { namespace net {
               //if (peer->inventory_peer_advertised_to_us.find(item_to_advertise) != peer->inventory_peer_advertised_to_us.end() )
               //   wdump((*peer->inventory_peer_advertised_to_us.find(item_to_advertise)));
 
+              // if the peer's summaries say it already knows about the transaction, don't advertise
+              // it and don't spend memory remembering that we didn't
+              if (item_to_advertise.item_type == trx_message_type &&
+                  peer->is_transaction_in_known_summaries(item_to_advertise.item_hash))
+                continue;
+
               if (peer->inventory_advertised_to_peer.find(item_to_advertise) == peer->inventory_advertised_to_peer.end() &&
                   peer->inventory_peer_advertised_to_us.find(item_to_advertise) == peer->inventory_peer_advertised_to_us.end())
               {
@@ -1321,6 +1372,10 @@ namespace graphene { namespace net {
           _retrigger_advertise_inventory_loop_promise->wait();
           _retrigger_advertise_inventory_loop_promise.reset();
         }
+
+        // give other items arriving right behind this one a chance to join the same batch
+        if (!_advertise_inventory_loop_done.canceled())
+          fc::usleep(fc::milliseconds(GRAPHENE_NET_INVENTORY_BATCH_INTERVAL_MS));
       } // while(!canceled)
     }
 
@@ -1331,6 +1386,40 @@ namespace graphene { namespace net {
         _retrigger_advertise_inventory_loop_promise->set_value();
     }
 
+    void node_impl::known_items_summary_loop()
+    {
+      VERIFY_CORRECT_THREAD();
+      if (!_transactions_known_since_last_summary.empty())
+      {
+        fc::bloom_parameters parameters;
+        parameters.projected_element_count = _transactions_known_since_last_summary.size();
+        parameters.false_positive_probability = GRAPHENE_NET_KNOWN_ITEMS_SUMMARY_FALSE_POSITIVE_RATE;
+        parameters.compute_optimal_parameters();
+
+        fc::bloom_filter summary(parameters);
+        for (const item_hash_t& transaction_hash : _transactions_known_since_last_summary)
+          summary.insert(transaction_hash.data(), transaction_hash.data_size());
+        _transactions_known_since_last_summary.clear();
+
+        // build the message once and queue the same message for every interested peer
+        message summary_message(known_items_summary_message(trx_message_type, summary));
+        std::list<peer_connection_ptr> peers_to_send_summary_to;
+        for (const peer_connection_ptr& peer : _active_connections)
+          if (peer->peer_accepts_known_items_summary && !peer->peer_needs_sync_items_from_us)
+            peers_to_send_summary_to.push_back(peer);
+
+        dlog("sending summary of ${count} known transaction(s) (${bytes} bytes) to ${peers} peer(s)",
+             ("count", parameters.projected_element_count)("bytes", summary_message.size)("peers", peers_to_send_summary_to.size()));
+        for (const peer_connection_ptr& peer : peers_to_send_summary_to)
+          peer->send_message(summary_message);
+      }
+
+      if (!_node_is_shutting_down && !_known_items_summary_loop_done.canceled())
+        _known_items_summary_loop_done = schedule_task( [=](){ known_items_summary_loop(); },
+                                                       fc::time_point::now() + fc::seconds(GRAPHENE_NET_KNOWN_ITEMS_SUMMARY_INTERVAL_SECONDS),
+                                                       "known_items_summary_loop" );
+    }
+
     void node_impl::terminate_inactive_connections_loop()
     {
       std::list<peer_connection_ptr> peers_to_disconnect_gently;
@@ -1780,9 +1869,10 @@ namespace graphene { namespace net {
       }
     }
 
-    void node_impl::on_message( peer_connection* originating_peer, const message& received_message )
+    void node_impl::on_message( peer_connection* originating_peer, const message_ptr& received_message_ptr )
     {
       VERIFY_CORRECT_THREAD();
+      const message& received_message = *received_message_ptr;
 
       activity_tracer aTracer(__FUNCTION__, *this);
 
@@ -1828,7 +1918,7 @@ namespace graphene { namespace net {
         on_closing_connection_message(originating_peer, received_message.as<closing_connection_message>());
         break;
       case core_message_type_enum::block_message_type:
-        process_block_message(originating_peer, received_message, message_hash);
+        process_block_message(originating_peer, received_message_ptr, message_hash);
         break;
       case core_message_type_enum::current_time_request_message_type:
         on_current_time_request_message(originating_peer, received_message.as<current_time_request_message>());
@@ -1848,13 +1938,16 @@ namespace graphene { namespace net {
       case core_message_type_enum::get_current_connections_reply_message_type:
         on_get_current_connections_reply_message(originating_peer, received_message.as<get_current_connections_reply_message>());
         break;
+      case core_message_type_enum::known_items_summary_message_type:
+        on_known_items_summary_message(originating_peer, received_message.as<known_items_summary_message>());
+        break;
 
       default:
         // ignore any message in between core_message_type_first and _last that we don't handle above
         // to allow us to add messages in the future
         if (received_message.msg_type < core_message_type_enum::core_message_type_first ||
             received_message.msg_type > core_message_type_enum::core_message_type_last)
-          process_ordinary_message(originating_peer, received_message, message_hash);
+          process_ordinary_message(originating_peer, received_message_ptr, message_hash);
         break;
       }
     }
@@ -1892,6 +1985,7 @@ namespace graphene { namespace net {
         user_data["last_known_fork_block_number"] = _hard_fork_block_numbers.back();
 
       user_data["chain_id"] = _delegate->get_chain_id();
+      user_data["known_items_summary"] = true;
 
       return user_data;
     }
@@ -1917,6 +2011,8 @@ namespace graphene { namespace net {
         originating_peer->last_known_fork_block_number = user_data["last_known_fork_block_number"].as<uint32_t>();
       if (user_data.contains("chain_id"))
         originating_peer->chain_id = user_data["chain_id"].as<steem::protocol::chain_id_type>();
+      if (user_data.contains("known_items_summary"))
+        originating_peer->peer_accepts_known_items_summary = user_data["known_items_summary"].as_bool();
     }
 
     void node_impl::on_hello_message( peer_connection* originating_peer, const hello_message& hello_message_received )
@@ -2771,7 +2867,7 @@ namespace graphene { namespace net {
       }
     }
 
-    message node_impl::get_message_for_item(const item_id& item)
+    message_ptr node_impl::get_message_for_item(const item_id& item)
     {
       activity_tracer aTracer(__FUNCTION__, *this);
 
@@ -2783,11 +2879,11 @@ namespace graphene { namespace net {
       {}
       try
       {
-        return _delegate->get_item(item);
+        return std::make_shared<message>(_delegate->get_item(item));
       }
       catch (fc::key_not_found_exception&)
       {}
-      return item_not_available_message(item);
+      return std::make_shared<message>(item_not_available_message(item));
     }
 
     void node_impl::on_fetch_items_message(peer_connection* originating_peer, const fetch_items_message& fetch_items_message_received)
@@ -2798,18 +2894,21 @@ namespace graphene { namespace net {
            ("type", fetch_items_message_received.item_type)
            ("endpoint", originating_peer->get_remote_endpoint()));
 
-      fc::optional<message> last_block_message_sent;
+      message_ptr last_block_message_sent;
 
-      std::list<message> reply_messages;
+      // cached replies share the buffer we received (or packed) the item into.  Blocks that
+      // aren't cached are queued by id and fetched from the delegate only when it's their turn
+      // to be sent, so a slow peer doesn't make us hold every block it asked for in memory
+      std::list<std::pair<message_ptr, bool> > reply_messages; // the flag is set for blocks we'll send by id
       for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
       {
         try
         {
-          message requested_message = _message_cache.get_message(item_hash);
+          message_ptr requested_message = _message_cache.get_message(item_hash);
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
-               ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
+               ("id", requested_message->id()));
+          reply_messages.emplace_back(requested_message, false);
           if (fetch_items_message_received.item_type == block_message_type)
             last_block_message_sent = requested_message;
           continue;
@@ -2822,19 +2921,19 @@ namespace graphene { namespace net {
         item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
         try
         {
-          message requested_message = _delegate->get_item(item_to_fetch);
+          message_ptr requested_message = std::make_shared<message>(_delegate->get_item(item_to_fetch));
           dlog("received item request from peer ${endpoint}, returning the item from delegate with id ${id} size ${size}",
-               ("id", requested_message.id())
-               ("size", requested_message.size)
+               ("id", requested_message->id())
+               ("size", requested_message->size)
                ("endpoint", originating_peer->get_remote_endpoint()));
-          reply_messages.push_back(requested_message);
+          reply_messages.emplace_back(requested_message, requested_message->msg_type == block_message_type);
           if (fetch_items_message_received.item_type == block_message_type)
             last_block_message_sent = requested_message;
           continue;
         }
         catch (fc::key_not_found_exception&)
         {
-          reply_messages.push_back(item_not_available_message(item_to_fetch));
+          reply_messages.emplace_back(std::make_shared<message>(item_not_available_message(item_to_fetch)), false);
           dlog("received item request from peer ${endpoint} but we don't have it",
                ("endpoint", originating_peer->get_remote_endpoint()));
         }
@@ -2843,17 +2942,17 @@ namespace graphene { namespace net {
       // if we sent them a block, update our record of the last block they've seen accordingly
       if (last_block_message_sent)
       {
-        graphene::net::block_message block = last_block_message_sent->as<graphene::net::block_message>();
-        originating_peer->last_block_delegate_has_seen = block.block_id;
-        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
+        block_id_type last_block_id_sent = get_block_id_from_packed_block_message(*last_block_message_sent);
+        originating_peer->last_block_delegate_has_seen = last_block_id_sent;
+        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(last_block_id_sent);
       }
 
-      for (const message& reply : reply_messages)
+      for (const auto& reply : reply_messages)
       {
-        if (reply.msg_type == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+        if (reply.second)
+          originating_peer->send_item(item_id(block_message_type, get_block_id_from_packed_block_message(*reply.first)));
         else
-          originating_peer->send_message(reply);
+          originating_peer->send_message(reply.first);
       }
     }
 
@@ -3442,7 +3541,8 @@ namespace graphene { namespace net {
 
     void node_impl::process_block_during_normal_operation( peer_connection* originating_peer,
                                                            const graphene::net::block_message& block_message_to_process,
-                                                           const message_hash_type& message_hash )
+                                                           const message_hash_type& message_hash,
+                                                           const message_ptr& message_to_relay )
     {
       fc::time_point message_receive_time = fc::time_point::now();
 
@@ -3529,7 +3629,8 @@ namespace graphene { namespace net {
           peer->clear_old_inventory();
         }
         message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id};
-        broadcast( block_message_to_process, propagation_data );
+        // relay the bytes we received rather than packing the block all over again
+        broadcast( message_to_relay, propagation_data, block_message_to_process.block_id );
         _message_cache.block_accepted();
 
         if (is_hard_fork_block(block_number))
@@ -3601,7 +3702,7 @@ namespace graphene { namespace net {
       }
     }
     void node_impl::process_block_message(peer_connection* originating_peer,
-                                          const message& message_to_process,
+                                          const message_ptr& message_to_process,
                                           const message_hash_type& message_hash)
     {
       VERIFY_CORRECT_THREAD();
@@ -3610,12 +3711,25 @@ namespace graphene { namespace net {
       // (it's possible that we request an item during normal operation and then get kicked into sync
       // mode before we receive and process the item.  In that case, we should process the item as a normal
       // item to avoid confusing the sync code)
-      graphene::net::block_message block_message_to_process(message_to_process.as<graphene::net::block_message>());
+      graphene::net::block_message block_message_to_process;
+      try
+      {
+        block_message_to_process = unpack_block_message(*message_to_process);
+      }
+      catch (const fc::exception& e)
+      {
+        wlog("received a malformed block from peer ${endpoint}, disconnecting from peer: ${e}",
+             ("endpoint", originating_peer->get_remote_endpoint())
+             ("e", e));
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me a malformed block: ${e}", ("e", e.to_string())));
+        disconnect_from_peer(originating_peer, "You sent me a malformed block", true, detailed_error);
+        return;
+      }
       auto item_iter = originating_peer->items_requested_from_peer.find(item_id(graphene::net::block_message_type, message_hash));
       if (item_iter != originating_peer->items_requested_from_peer.end())
       {
         originating_peer->items_requested_from_peer.erase(item_iter);
-        process_block_during_normal_operation(originating_peer, block_message_to_process, message_hash);
+        process_block_during_normal_operation(originating_peer, block_message_to_process, message_hash, message_to_process);
         if (originating_peer->idle())
           trigger_fetch_items_loop();
         return;
@@ -3939,6 +4053,27 @@ namespace graphene { namespace net {
       VERIFY_CORRECT_THREAD();
     }
 
+    void node_impl::on_known_items_summary_message(peer_connection* originating_peer,
+                                                   const known_items_summary_message& known_items_summary_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      if (known_items_summary_message_received.item_type != trx_message_type)
+        return;
+
+      // the filter is used as-is for lookups, so make sure it can't index outside its own table
+      // or make us do an unreasonable amount of hashing per transaction
+      const fc::bloom_filter& summary = known_items_summary_message_received.known_items;
+      if (summary.salt_.empty() || summary.salt_.size() > 32 ||
+          summary.bit_table_.empty() || summary.bit_table_.size() > GRAPHENE_NET_KNOWN_ITEMS_SUMMARY_MAX_TABLE_BYTES ||
+          summary.table_size_ == 0 || summary.table_size_ > summary.bit_table_.size() * fc::bits_per_char)
+      {
+        wlog("Ignoring malformed known items summary from peer ${endpoint}", ("endpoint", originating_peer->get_remote_endpoint()));
+        return;
+      }
+
+      originating_peer->add_known_transactions_summary(summary);
+    }
+
 
     // this handles any message we get that doesn't require any special processing.
     // currently, this is any message other than block messages and p2p-specific
@@ -3946,8 +4081,9 @@ namespace graphene { namespace net {
     // this just passes the message to the client, and does the bookkeeping
     // related to requesting and rebroadcasting the message.
     void node_impl::process_ordinary_message( peer_connection* originating_peer,
-                                              const message& message_to_process, const message_hash_type& message_hash )
+                                              const message_ptr& message_to_process_ptr, const message_hash_type& message_hash )
     {
+      const message& message_to_process = *message_to_process_ptr;
       VERIFY_CORRECT_THREAD();
       fc::time_point message_receive_time = fc::time_point::now();
 
@@ -3970,12 +4106,14 @@ namespace graphene { namespace net {
 
         // Next: have the delegate process the message
         fc::time_point message_validated_time;
+        fc::uint160_t hash_of_message_contents;
         try
         {
           if (message_to_process.msg_type == trx_message_type)
           {
             trx_message transaction_message_to_process = message_to_process.as<trx_message>();
-            dlog("passing message containing transaction ${trx} to client", ("trx", transaction_message_to_process.trx.id()));
+            hash_of_message_contents = transaction_message_to_process.trx.id();
+            dlog("passing message containing transaction ${trx} to client", ("trx", hash_of_message_contents));
             _delegate->handle_transaction(transaction_message_to_process);
           }
           else
@@ -3996,7 +4134,7 @@ namespace graphene { namespace net {
 
         // finally, if the delegate validated the message, broadcast it to our other peers
         message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id};
-        broadcast( message_to_process, propagation_data );
+        broadcast( message_to_process_ptr, propagation_data, hash_of_message_contents );
       }
     }
 
@@ -4323,6 +4461,20 @@ namespace graphene { namespace net {
         wlog( "Exception thrown while terminating Bandwidth monitor loop, ignoring" );
       }
 
+      try
+      {
+        _known_items_summary_loop_done.cancel_and_wait("node_impl::close()");
+        dlog("Known items summary loop terminated");
+      }
+      catch ( const fc::exception& e )
+      {
+        wlog( "Exception thrown while terminating Known items summary loop, ignoring: ${e}", ("e", e) );
+      }
+      catch (...)
+      {
+        wlog( "Exception thrown while terminating Known items summary loop, ignoring" );
+      }
+
       try
       {
         _dump_node_status_task_done.cancel_and_wait("node_impl::close()");
@@ -4716,6 +4868,7 @@ namespace graphene { namespace net {
              !_terminate_inactive_connections_loop_done.valid() &&
              !_fetch_updated_peer_lists_loop_done.valid() &&
              !_bandwidth_monitor_loop_done.valid() &&
+             !_known_items_summary_loop_done.valid() &&
              !_dump_node_status_task_done.valid());
       if (_node_configuration.accept_incoming_connections)
         _accept_loop_complete = async_task( [=](){ accept_loop(); }, "accept_loop");
@@ -4726,6 +4879,7 @@ namespace graphene { namespace net {
       _terminate_inactive_connections_loop_done = async_task( [=]() { terminate_inactive_connections_loop(); }, "terminate_inactive_connections_loop" );
       _fetch_updated_peer_lists_loop_done = async_task([=](){ fetch_updated_peer_lists_loop(); }, "fetch_updated_peer_lists_loop");
       _bandwidth_monitor_loop_done = async_task([=](){ bandwidth_monitor_loop(); }, "bandwidth_monitor_loop");
+      _known_items_summary_loop_done = async_task([=](){ known_items_summary_loop(); }, "known_items_summary_loop");
       _dump_node_status_task_done = async_task([=](){ dump_node_status_task(); }, "dump_node_status_task");
     }
 
@@ -5041,15 +5195,26 @@ namespace graphene { namespace net {
       return (uint32_t)_active_connections.size();
     }
 
+    void node_impl::broadcast( const message_ptr& item_to_broadcast, const message_propagation_data& propagation_data,
+                               const fc::uint160_t& hash_of_message_contents )
+    {
+      VERIFY_CORRECT_THREAD();
+      if( item_to_broadcast->msg_type == graphene::net::block_message_type )
+        _most_recent_blocks_accepted.push_back( hash_of_message_contents );
+      message_hash_type hash_of_item_to_broadcast = item_to_broadcast->id();
+
+      _message_cache.cache_message( item_to_broadcast, hash_of_item_to_broadcast, propagation_data, hash_of_message_contents );
+      _new_inventory.insert( item_id(item_to_broadcast->msg_type, hash_of_item_to_broadcast ) );
+      trigger_advertise_inventory_loop();
+    }
+
     void node_impl::broadcast( const message& item_to_broadcast, const message_propagation_data& propagation_data )
     {
       VERIFY_CORRECT_THREAD();
       fc::uint160_t hash_of_message_contents;
       if( item_to_broadcast.msg_type == graphene::net::block_message_type )
       {
-        graphene::net::block_message block_message_to_broadcast = item_to_broadcast.as<graphene::net::block_message>();
-        hash_of_message_contents = block_message_to_broadcast.block_id; // for debugging
-        _most_recent_blocks_accepted.push_back( block_message_to_broadcast.block_id );
+        hash_of_message_contents = get_block_id_from_packed_block_message( item_to_broadcast );
       }
       else if( item_to_broadcast.msg_type == graphene::net::trx_message_type )
       {
@@ -5057,11 +5222,7 @@ namespace graphene { namespace net {
         hash_of_message_contents = transaction_message_to_broadcast.trx.id(); // for debugging
         dlog( "broadcasting trx: ${trx}", ("trx", transaction_message_to_broadcast) );
       }
-      message_hash_type hash_of_item_to_broadcast = item_to_broadcast.id();
-
-      _message_cache.cache_message( item_to_broadcast, hash_of_item_to_broadcast, propagation_data, hash_of_message_contents );
-      _new_inventory.insert( item_id(item_to_broadcast.msg_type, hash_of_item_to_broadcast ) );
-      trigger_advertise_inventory_loop();
+      broadcast( std::make_shared<message>( item_to_broadcast ), propagation_data, hash_of_message_contents );
     }
 
     void node_impl::broadcast( const message& item_to_broadcast )
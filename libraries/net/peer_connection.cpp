@@ -43,24 +43,26 @@
 
 namespace graphene { namespace net
   {
-    message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
+    message_ptr peer_connection::real_queued_message::get_message(peer_connection_delegate*)
     {
       if (message_send_time_field_offset != (size_t)-1)
       {
         // patch the current time into the message.  Since this operates on the packed version of the structure,
-        // it won't work for anything after a variable-length field
+        // it won't work for anything after a variable-length field.  The buffer may be shared, so patch a copy
+        std::shared_ptr<message> patched_message = std::make_shared<message>(*message_to_send);
         std::vector<char> packed_current_time = fc::raw::pack_to_vector(fc::time_point::now());
-        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send.data.size());
-        memcpy(message_to_send.data.data() + message_send_time_field_offset,
+        assert(message_send_time_field_offset + packed_current_time.size() <= patched_message->data.size());
+        memcpy(patched_message->data.data() + message_send_time_field_offset,
                packed_current_time.data(), packed_current_time.size());
+        return patched_message;
       }
       return message_to_send;
     }
     size_t peer_connection::real_queued_message::get_size_in_queue()
     {
-      return message_to_send.data.size();
+      return message_to_send->data.size();
     }
-    message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
+    message_ptr peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
     {
       return node->get_message_for_item(item_to_send);
     }
@@ -264,7 +266,7 @@ namespace graphene { namespace net
       }
     } // connect_to()
 
-    void peer_connection::on_message( message_oriented_connection* originating_connection, const message& received_message )
+    void peer_connection::on_message( message_oriented_connection* originating_connection, const message_ptr& received_message )
     {
       VERIFY_CORRECT_THREAD();
       _currently_handling_message = true;
@@ -294,13 +296,13 @@ namespace graphene { namespace net
       while (!_queued_messages.empty())
       {
         _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        message_ptr message_to_send = _queued_messages.front()->get_message(_node);
         try
         {
           //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
           //     "to send message of type ${type} for peer ${endpoint}",
           //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-          _message_connection.send_message(message_to_send);
+          _message_connection.send_message(*message_to_send);
           //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
           //     ("endpoint", get_remote_endpoint()));
         }
@@ -374,7 +376,14 @@ namespace graphene { namespace net
       VERIFY_CORRECT_THREAD();
       //dlog("peer_connection::send_message() enqueueing message of type ${type} for peer ${endpoint}",
       //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-      std::unique_ptr<queued_message> message_to_enqueue(new real_queued_message(message_to_send, message_send_time_field_offset));
+      std::unique_ptr<queued_message> message_to_enqueue(new real_queued_message(std::make_shared<message>(message_to_send), message_send_time_field_offset));
+      send_queueable_message(std::move(message_to_enqueue));
+    }
+
+    void peer_connection::send_message(const message_ptr& message_to_send)
+    {
+      VERIFY_CORRECT_THREAD();
+      std::unique_ptr<queued_message> message_to_enqueue(new real_queued_message(message_to_send));
       send_queueable_message(std::move(message_to_enqueue));
     }
 
@@ -496,6 +505,24 @@ namespace graphene { namespace net
            ("to_us", number_of_elements_peer_advertised_to_discard)("remain_to_us", inventory_peer_advertised_to_us.size()));
     }
 
+    void peer_connection::add_known_transactions_summary(const fc::bloom_filter& summary)
+    {
+      VERIFY_CORRECT_THREAD();
+      known_transactions_summaries.push_back(summary);
+      while (known_transactions_summaries.size() > GRAPHENE_NET_KNOWN_ITEMS_SUMMARIES_TO_KEEP)
+        known_transactions_summaries.pop_front();
+    }
+
+    bool peer_connection::is_transaction_in_known_summaries(const item_hash_t& transaction_hash) const
+    {
+      VERIFY_CORRECT_THREAD();
+      // check the newest summaries first, they're the most likely to hold a transaction we're about to advertise
+      for (auto iter = known_transactions_summaries.rbegin(); iter != known_transactions_summaries.rend(); ++iter)
+        if (iter->contains(transaction_hash.data(), transaction_hash.data_size()))
+          return true;
+      return false;
+    }
+
     // we have a higher limit for blocks than transactions so we will still fetch blocks even when transactions are throttled
     bool peer_connection::is_inventory_advertised_to_us_list_full_for_transactions() const
     {
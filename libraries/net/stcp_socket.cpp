@@ -116,10 +116,24 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
     return s;
 } FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
 
+/**
+ *   Reads directly into the caller's buffer and decrypts it in place, skipping
+ *   the bounce through _read_buffer.  The shared_ptr keeps the destination alive
+ *   if this task is canceled while the read is still outstanding.
+ */
 size_t stcp_socket::readsome( const std::shared_ptr<char>& buf, size_t len, size_t offset ) 
-{
-  return readsome(buf.get() + offset, len);
-}
+{ try {
+    assert( len > 0 && (len % 16) == 0 );
+
+    size_t s = _sock.readsome( buf, len, offset );
+    if( s % 16 )
+    {
+      _sock.read(buf, 16 - (s%16), offset + s);
+      s += 16-(s%16);
+    }
+    _recv_aes.decode( buf.get() + offset, s, buf.get() + offset );
+    return s;
+} FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
 
 bool stcp_socket::eof()const
 {
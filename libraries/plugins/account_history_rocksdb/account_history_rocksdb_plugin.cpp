@@ -2,6 +2,7 @@
 #include <steem/chain/steem_fwd.hpp>
 
 #include <steem/plugins/account_history_rocksdb/account_history_rocksdb_plugin.hpp>
+#include <steem/plugins/account_history_rocksdb/account_history_chunk.hpp>
 
 #include <steem/chain/database.hpp>
 #include <steem/chain/history_object.hpp>
@@ -15,17 +16,27 @@
 
 #include <appbase/application.hpp>
 
+#include <rocksdb/compaction_filter.h>
+#include <rocksdb/convenience.h>
 #include <rocksdb/db.h>
+#include <rocksdb/merge_operator.h>
 #include <rocksdb/options.h>
 #include <rocksdb/slice.h>
+#include <rocksdb/sst_file_writer.h>
 #include <rocksdb/utilities/write_batch_with_index.h>
 
 #include <boost/type.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/asio/io_service.hpp>
 #include <boost/container/flat_set.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <limits>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <typeindex>
 #include <typeinfo>
 
@@ -41,19 +52,15 @@ namespace bpo = boost::program_options;
 #define OPERATION_BY_ID 2
 #define OPERATION_BY_BLOCK 3
 #define AH_INFO_BY_NAME 4
-#define AH_OPERATION_BY_ID 5
+#define AH_OPERATION_CHUNKS 5
+#define AH_OP_TYPE_CHUNKS 6
+#define VIRTUAL_OP_BY_BLOCK 7
 
 #define WRITE_BUFFER_FLUSH_LIMIT     10
-#define ACCOUNT_HISTORY_LENGTH_LIMIT 30
-#define ACCOUNT_HISTORY_TIME_LIMIT   30
-#define VIRTUAL_OP_FLAG              0x8000000000000000
+/// Number of blocks handed to a single worker during parallel data import.
+#define IMPORT_CHUNK_BLOCK_COUNT     1000
 
-/** Because localtion_id_pair stores block_number paired with (VIRTUAL_OP_FLAG|operation_id),
- *  max allowed operation-id is max_int (instead of max_uint).
- */
-#define MAX_OPERATION_ID             std::numeric_limits<int64_t>::max()
-
-#define STORE_MAJOR_VERSION          1
+#define STORE_MAJOR_VERSION          2
 #define STORE_MINOR_VERSION          0
 
 namespace steem { namespace plugins { namespace account_history_rocksdb {
@@ -103,59 +110,6 @@ public:
 
 namespace
 {
-   template <class T>
-   serialize_buffer_t dump(const T& obj)
-   {
-      serialize_buffer_t serializedObj;
-      auto size = fc::raw::pack_size(obj);
-      serializedObj.resize(size);
-      fc::datastream<char*> ds(serializedObj.data(), size);
-      fc::raw::pack(ds, obj);
-      return serializedObj;
-   }
-
-   template <class T>
-   void load(T& obj, const char* data, size_t size)
-   {
-      fc::datastream<const char*> ds(data, size);
-      fc::raw::unpack(ds, obj);
-   }
-
-   template <class T>
-   void load(T& obj, const serialize_buffer_t& source)
-   {
-      load(obj, source.data(), source.size());
-   }
-
-/** Helper class to simplify construction of Slice objects holding primitive type values.
- *
- */
-template <typename T>
-class PrimitiveTypeSlice final : public Slice
-{
-public:
-   explicit PrimitiveTypeSlice(T value) : _value(value)
-   {
-      data_ = reinterpret_cast<const char*>(&_value);
-      size_ = sizeof(T);
-   }
-
-   static const T& unpackSlice(const Slice& s)
-   {
-      assert(sizeof(T) == s.size());
-      return *reinterpret_cast<const T*>(s.data());
-   }
-
-   static const T& unpackSlice(const std::string& s)
-   {
-      assert(sizeof(T) == s.size());
-      return *reinterpret_cast<const T*>(s.data());
-   }
-
-private:
-   T _value;
-};
-
 /** Helper base class to cover all common functionality across defined comparators.
  *
  */
@@ -235,22 +189,19 @@ typedef PrimitiveTypeSlice< uint32_t > lib_slice_t;
 
 #define LIB_ID lib_id_slice_t( 0 )
 
-/** Location index is nonunique. Since RocksDB supports only unique indexes, it must be extended
- *  by some unique part (ie ID).
- *
- */
-typedef std::pair< uint32_t, uint64_t > block_op_id_pair;
-typedef PrimitiveTypeComparatorImpl< block_op_id_pair > op_by_block_num_ComparatorImpl;
+typedef PrimitiveTypeComparatorImpl< uint32_t > by_block_ComparatorImpl;
 
-/// Compares account_history_info::id and rocksdb_operation_object::id pair
-typedef std::pair< int64_t, uint32_t > ah_op_id_pair;
-typedef PrimitiveTypeComparatorImpl< ah_op_id_pair > ah_op_by_id_ComparatorImpl;
+/// Compares block number and index of a virtual operation within the block
+typedef std::pair< uint32_t, uint32_t > block_vop_index_pair;
+typedef PrimitiveTypeComparatorImpl< block_vop_index_pair > vop_by_block_ComparatorImpl;
+
+typedef PrimitiveTypeComparatorImpl< ah_chunk_id_pair > ah_chunk_ComparatorImpl;
+
+typedef PrimitiveTypeComparatorImpl< ah_op_type_chunk_id > ah_op_type_chunk_ComparatorImpl;
 
-typedef PrimitiveTypeSlice< int64_t > id_slice_t;
-typedef PrimitiveTypeSlice< block_op_id_pair > op_by_block_num_slice_t;
 typedef PrimitiveTypeSlice< uint32_t > by_block_slice_t;
+typedef PrimitiveTypeSlice< block_vop_index_pair > vop_by_block_slice_t;
 typedef PrimitiveTypeSlice< account_name_type::Storage > ah_info_by_name_slice_t;
-typedef PrimitiveTypeSlice< ah_op_id_pair > ah_op_by_id_slice_t;
 
 const Comparator* by_id_Comparator()
 {
@@ -258,9 +209,15 @@ const Comparator* by_id_Comparator()
    return &c;
 }
 
-const Comparator* op_by_block_num_Comparator()
+const Comparator* by_block_Comparator()
 {
-   static op_by_block_num_ComparatorImpl c;
+   static by_block_ComparatorImpl c;
+   return &c;
+}
+
+const Comparator* vop_by_block_Comparator()
+{
+   static vop_by_block_ComparatorImpl c;
    return &c;
 }
 
@@ -270,12 +227,102 @@ const Comparator* by_account_name_Comparator()
    return &c;
 }
 
-const Comparator* ah_op_by_id_Comparator()
+const Comparator* ah_chunk_Comparator()
 {
-   static ah_op_by_id_ComparatorImpl c;
+   static ah_chunk_ComparatorImpl c;
    return &c;
 }
 
+const Comparator* ah_op_type_chunk_Comparator()
+{
+   static ah_op_type_chunk_ComparatorImpl c;
+   return &c;
+}
+
+/// Serialized operation starts with the index of its type within protocol::operation.
+uint32_t getOperationType(const rocksdb_operation_object& obj)
+{
+   return fc::raw::unpack_from_buffer< fc::unsigned_int >(obj.serialized_op).value;
+}
+
+/** Operations stored for a block get consecutive ids, so the block index holds only the id of the first one and
+ *  their count, packed as two varints. Virtual operations are additionally indexed by virtual_operation_by_block.
+ */
+class block_operations_record
+{
+public:
+   uint32_t             block = 0;
+   int64_t              firstOpId = 0;
+   uint32_t             count = 0;
+   /// Number of virtual operations added so far, gives index of the next one. Not stored.
+   uint32_t             virtualCount = 0;
+
+   void add(int64_t opId)
+   {
+      if(count == 0)
+         firstOpId = opId;
+
+      FC_ASSERT(opId == firstOpId + count, "Operations of block ${b} have not been given consecutive ids", ("b", block));
+
+      ++count;
+   }
+
+   void clear()
+   {
+      block = 0;
+      firstOpId = 0;
+      count = 0;
+      virtualCount = 0;
+   }
+
+   std::string pack() const
+   {
+      std::string data;
+      appendVarint(&data, firstOpId);
+      appendVarint(&data, count);
+      return data;
+   }
+
+   void unpack(uint32_t blockNum, const Slice& data)
+   {
+      const char* itr = data.data();
+      const char* end = itr + data.size();
+      uint64_t first = 0, opCount = 0;
+
+      bool valid = readVarint(&itr, end, &first) && readVarint(&itr, end, &opCount) && itr == end;
+      FC_ASSERT(valid, "Corrupted operation range of block ${b}", ("b", blockNum));
+
+      block = blockNum;
+      firstOpId = first;
+      count = opCount;
+      virtualCount = 0;
+   }
+};
+
+/** Value of virtual_operation_by_block entries: varint operation type (index within protocol::operation) followed
+ *  by varint operation id, so type filtering does not need to load the operations.
+ */
+std::string packVirtualOpEntry(uint32_t opType, int64_t opId)
+{
+   std::string data;
+   appendVarint(&data, opType);
+   appendVarint(&data, opId);
+   return data;
+}
+
+void unpackVirtualOpEntry(const Slice& data, uint32_t* opType, int64_t* opId)
+{
+   const char* itr = data.data();
+   const char* end = itr + data.size();
+   uint64_t type = 0, id = 0;
+
+   bool valid = readVarint(&itr, end, &type) && readVarint(&itr, end, &id) && itr == end;
+   FC_ASSERT(valid, "Corrupted virtual operation entry");
+
+   *opType = type;
+   *opId = id;
+}
+
 #define checkStatus(s) FC_ASSERT((s).ok(), "Data access failed: ${m}", ("m", (s).ToString()))
 
 class operation_name_provider
@@ -353,6 +400,47 @@ private:
    std::map<account_name_type, account_history_info> _ahInfoCache;
 };
 
+/** Unit of work of the parallel data import: a run of consecutive blocks, the operations prepared from them
+ *  and, once the chunk has been merged, the account history entries pointing to these operations.
+ */
+struct import_chunk
+{
+   typedef std::pair<rocksdb_operation_object, std::vector<account_name_type>> prepared_op;
+   /// Account history id and entry id paired with the operation id.
+   typedef std::pair<std::pair<int64_t, uint32_t>, int64_t>                    ah_entry;
+
+   size_t                      chunkNo = 0;
+   std::vector<signed_block>   blocks;
+   std::vector<prepared_op>    ops;
+   std::vector<ah_entry>       ahEntries;
+};
+
+/// Key/value pairs collected for a single column before they are written into a SST file.
+typedef std::vector<std::pair<std::string, std::string>> sst_entries_t;
+/// SST files paired with the column they belong to, in the order they have to be ingested.
+typedef std::vector<std::pair<int, bfs::path>> sst_files_t;
+
+template <typename Filter>
+class ah_prune_filter_factory final : public ::rocksdb::CompactionFilterFactory
+{
+public:
+   explicit ah_prune_filter_factory(const ah_retention_state& state) : _state(state) {}
+
+   virtual std::unique_ptr<::rocksdb::CompactionFilter> CreateCompactionFilter(
+      const ::rocksdb::CompactionFilter::Context& context) override
+   {
+      return std::unique_ptr<::rocksdb::CompactionFilter>(new Filter(_state));
+   }
+
+   virtual const char* Name() const override
+   {
+      static const std::string name = boost::core::demangle(typeid(this).name());
+      return name.c_str();
+   }
+
+private:
+   const ah_retention_state& _state;
+};
 
 } /// anonymous
 
@@ -410,6 +498,9 @@ public:
          loadSeqIdentifiers(storageDb);
          _storage.reset(storageDb);
 
+         if(_prune)
+            loadRetentionState();
+
          const auto& rocksdb_plugin = appbase::app().get_plugin< account_history_rocksdb_plugin >();
 
          // I do not like using exceptions for control paths, but column definitions are set multiple times
@@ -455,6 +546,10 @@ public:
 
    void find_account_history_data(const account_name_type& name, uint64_t start, uint32_t limit,
       std::function<void(unsigned int, const rocksdb_operation_object&)> processor) const;
+   /// Walks only entries holding operations of given types, using the ah_op_type_chunks index.
+   void find_account_history_data(const account_name_type& name, uint64_t start, uint32_t limit,
+      const std::vector<uint32_t>& opTypes,
+      std::function<void(unsigned int, const rocksdb_operation_object&)> processor) const;
    bool find_operation_object(size_t opId, rocksdb_operation_object* op) const;
    /// Allows to look for all operations present in given block and call `processor` for them.
    void find_operations_by_block(size_t blockNum,
@@ -462,12 +557,44 @@ public:
    /// Allows to enumerate all operations registered in given block range.
    uint32_t enumVirtualOperationsFromBlockRange(uint32_t blockRangeBegin,
       uint32_t blockRangeEnd, std::function<void(const rocksdb_operation_object&)> processor) const;
+   /** Enumerates at most `limit' (0 means no limit) virtual operations of given types (all if empty) starting at
+    *  `cursor'. Sets `nextCursor' to the position of the first operation left out, or 0 if the range is done.
+    */
+   uint32_t enumVirtualOperations(uint32_t blockRangeBegin, uint32_t blockRangeEnd, uint64_t cursor, uint32_t limit,
+      const std::vector<uint32_t>& opTypes, std::function<void(const rocksdb_operation_object&)> processor,
+      uint64_t* nextCursor) const;
+
+   /** Compacts the ah_operation_chunks and ah_op_type_chunks columns right away instead of waiting for background
+    *  compactions. The first pass folds pending merge operands into values, which the prune filters only get to see
+    *  in the second one.
+    */
+   void compactAccountHistory()
+   {
+      flushStorage();
+
+      for(int column : { AH_OPERATION_CHUNKS, AH_OP_TYPE_CHUNKS })
+      {
+         for(int pass = 0; pass < 2; ++pass)
+         {
+            auto s = _storage->CompactRange(::rocksdb::CompactRangeOptions(), _columnHandles[column], nullptr, nullptr);
+            checkStatus(s);
+         }
+      }
+   }
 
    void shutdownDb()
    {
       chain::util::disconnect_signal(_on_post_apply_operation_con);
       chain::util::disconnect_signal(_on_irreversible_block_conn);
       flushStorage();
+
+      if(_storage != nullptr)
+      {
+         /// Pruning filter uses column handles being released below, so no compaction may still be running.
+         ::rocksdb::CancelAllBackgroundWork(_storage.get(), true);
+      }
+
+      _retention.detach();
       cleanupColumnHandles();
       _storage.reset();
    }
@@ -512,17 +639,21 @@ private:
       auto s = _writeBuffer.Put(_columnHandles[OPERATION_BY_ID], idSlice, Slice(serializedObj.data(), serializedObj.size()));
       checkStatus(s);
 
-      // uint64_t location = ( (uint64_t) obj.trx_in_block << 32 ) | ( (uint64_t) obj.op_in_trx << 16 ) | ( obj.virtual_op );
-
-      uint64_t encoded_id = (uint64_t) obj.id;
-      if( obj.virtual_op > 0 )
+      if(_blockRecord.count != 0 && _blockRecord.block != obj.block)
       {
-         encoded_id |= VIRTUAL_OP_FLAG;
+         storeBlockRecord();
+         _blockRecord.clear();
       }
 
-      op_by_block_num_slice_t blockLocSlice( block_op_id_pair( obj.block, encoded_id ) );
-      s = _writeBuffer.Put(_columnHandles[OPERATION_BY_BLOCK], blockLocSlice, idSlice);
-      checkStatus(s);
+      _blockRecord.block = obj.block;
+      _blockRecord.add(obj.id);
+
+      if(obj.virtual_op > 0)
+      {
+         vop_by_block_slice_t vopSlice(std::make_pair(obj.block, _blockRecord.virtualCount++));
+         s = _writeBuffer.Put(_columnHandles[VIRTUAL_OP_BY_BLOCK], vopSlice, packVirtualOpEntry(getOperationType(obj), obj.id));
+         checkStatus(s);
+      }
 
       for(const auto& name : impacted)
          buildAccountHistoryRecord( name, obj );
@@ -534,8 +665,32 @@ private:
 }
 
    void buildAccountHistoryRecord( const account_name_type& name, const rocksdb_operation_object& obj );
-   void prunePotentiallyTooOldItems(account_history_info* ahInfo, const account_name_type& name,
-      const fc::time_point_sec& now);
+   bool loadAccountHistoryInfo(const account_name_type& name, account_history_info* ahInfo) const;
+   /// Returns false if the chunk is not present (has been pruned).
+   bool loadAccountHistoryChunk(const account_history_info& ahInfo, uint32_t chunkNo, std::vector<int64_t>* opIds) const;
+   /// Writes operation range of the block being imported. Can be called repeatedly while the block grows.
+   void storeBlockRecord()
+   {
+      by_block_slice_t blockSlice(_blockRecord.block);
+      auto s = _writeBuffer.Put(_columnHandles[OPERATION_BY_BLOCK], blockSlice, _blockRecord.pack());
+      checkStatus(s);
+   }
+
+   /// Feeds the pruning compaction filter with newest entries of all account histories held in the storage.
+   void loadRetentionState();
+
+   /// Imports blocks using the worker threads and SST file ingestion. Returns number of the last imported block.
+   size_t importDataInParallel(unsigned int blockLimit, unsigned int threadCount);
+   void prepareImportChunk(import_chunk& chunk) const;
+   void mergeImportChunk(import_chunk& chunk, std::map<account_name_type, account_history_info>& ahInfos);
+   /// Ingests operation SST files of the chunk and returns the account history ones, which must go in chunk order.
+   sst_files_t writeImportChunk(const import_chunk& chunk, const bfs::path& sstDir) const;
+   /// Makes entries of an ingested chunk known to the pruning compaction filters.
+   void updateImportRetention(const import_chunk& chunk);
+   /// Returns false if there were no entries and no file has been written.
+   bool writeSstFile(int column, sst_entries_t& entries, const bfs::path& sstFile, bool merge) const;
+   void ingestSstFile(int column, const bfs::path& sstFile) const;
+
 
    void saveStoreVersion()
    {
@@ -604,6 +759,9 @@ private:
    {
       storeSequenceIds();
 
+      if(_blockRecord.count != 0)
+         storeBlockRecord();
+
       if(storage == nullptr)
          storage = _storage.get();
 
@@ -675,12 +833,14 @@ private:
    /// Helper member to be able to detect another incomming tx and increment tx-counter.
    transaction_id_type              _lastTx;
    size_t                           _txNo = 0;
+   /// Operation range of the block being currently imported, stored when the next block starts or on flush.
+   block_operations_record          _blockRecord;
    /// Total processed ops in this session (counts every operation, even excluded by filtering).
    size_t                           _totalOps = 0;
    /// Total number of ops being skipped by filtering options.
    size_t                           _excludedOps = 0;
    /// Total number of accounts (impacted by ops) excluded from processing because of filtering.
-   mutable size_t                   _excludedAccountCount = 0;
+   mutable std::atomic<size_t>      _excludedAccountCount = { 0 };
    /// IDs to be assigned to object.id field.
    uint64_t                         _operationSeqId = 0;
    uint64_t                         _accountHistorySeqId = 0;
@@ -701,12 +861,35 @@ private:
    bool                             _reindexing = false;
 
    bool                             _prune = false;
+   ah_retention_state               _retention;
+   std::shared_ptr<::rocksdb::CompactionFilterFactory> _pruneFilterFactory;
+   std::shared_ptr<::rocksdb::CompactionFilterFactory> _opTypePruneFilterFactory;
+   std::shared_ptr<::rocksdb::MergeOperator> _chunkMergeOperator = std::make_shared<account_history_chunk_merge_operator>();
+   std::shared_ptr<::rocksdb::MergeOperator> _bitmapMergeOperator = std::make_shared<entry_bitmap_merge_operator>();
+
+   /// Number of threads preparing data during immediate import, 1 means sequential import.
+   unsigned int                     _importThreadCount = 0;
 };
 
 void account_history_rocksdb_plugin::impl::collectOptions(const boost::program_options::variables_map& options)
 {
     fc::mutable_variant_object state_opts;
 
+   if(options.count("account-history-rocksdb-import-threads"))
+      _importThreadCount = options.at("account-history-rocksdb-import-threads").as<uint32_t>();
+
+   if(_importThreadCount == 0)
+      _importThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+   if(options.count("account-history-rocksdb-prune"))
+      _prune = options.at("account-history-rocksdb-prune").as<bool>();
+
+   if(_prune)
+   {
+      _pruneFilterFactory = std::make_shared<ah_prune_filter_factory<ah_prune_filter>>(_retention);
+      _opTypePruneFilterFactory = std::make_shared<ah_prune_filter_factory<ah_op_type_prune_filter>>(_retention);
+   }
+
    typedef std::pair< account_name_type, account_name_type > pairstring;
    STEEM_LOAD_VALUE_SET(options, "account-history-rocksdb-track-account-range", _tracked_accounts, pairstring);
 
@@ -847,63 +1030,169 @@ void account_history_rocksdb_plugin::impl::storeOpFilteringParameters(const std:
       }
    }
 
-void account_history_rocksdb_plugin::impl::find_account_history_data(const account_name_type& name, uint64_t start,
-   uint32_t limit, std::function<void(unsigned int, const rocksdb_operation_object&)> processor) const
+bool account_history_rocksdb_plugin::impl::loadAccountHistoryInfo(const account_name_type& name,
+   account_history_info* ahInfo) const
 {
-   ReadOptions rOptions;
-
    ah_info_by_name_slice_t nameSlice(name.data);
    PinnableSlice buffer;
-   auto s = _storage->Get(rOptions, _columnHandles[AH_INFO_BY_NAME], nameSlice, &buffer);
+   auto s = _storage->Get(ReadOptions(), _columnHandles[AH_INFO_BY_NAME], nameSlice, &buffer);
 
    if(s.IsNotFound())
-      return;
+      return false;
+
+   checkStatus(s);
+
+   load(*ahInfo, buffer.data(), buffer.size());
+   return true;
+}
+
+bool account_history_rocksdb_plugin::impl::loadAccountHistoryChunk(const account_history_info& ahInfo, uint32_t chunkNo,
+   std::vector<int64_t>* opIds) const
+{
+   ah_chunk_slice_t key(std::make_pair(ahInfo.id, chunkNo));
+   PinnableSlice buffer;
+   auto s = _storage->Get(ReadOptions(), _columnHandles[AH_OPERATION_CHUNKS], key, &buffer);
+
+   /// Chunk could be already pruned.
+   if(s.IsNotFound())
+      return false;
 
    checkStatus(s);
 
+   bool valid = account_history_chunk::decode(buffer, opIds);
+   FC_ASSERT(valid, "Corrupted account history chunk ${c} of history ${h}", ("c", chunkNo)("h", ahInfo.id));
+   return true;
+}
+
+void account_history_rocksdb_plugin::impl::find_account_history_data(const account_name_type& name, uint64_t start,
+   uint32_t limit, std::function<void(unsigned int, const rocksdb_operation_object&)> processor) const
+{
    account_history_info ahInfo;
-   load(ahInfo, buffer.data(), buffer.size());
+   if(loadAccountHistoryInfo(name, &ahInfo) == false)
+      return;
 
-   ah_op_by_id_slice_t lowerBoundSlice(std::make_pair(ahInfo.id, ahInfo.oldestEntryId));
-   ah_op_by_id_slice_t upperBoundSlice(std::make_pair(ahInfo.id, ahInfo.newestEntryId+1));
+   /// Entries are returned from the newest one not exceeding `start', down to `limit' entries below it.
+   int64_t first = static_cast<int64_t>(std::min<uint64_t>(start, ahInfo.newestEntryId));
+   if(first < ahInfo.oldestEntryId)
+      return;
 
-   rOptions.iterate_lower_bound = &lowerBoundSlice;
-   rOptions.iterate_upper_bound = &upperBoundSlice;
+   int64_t lowerBound = std::max<int64_t>(first - static_cast<int64_t>(limit), ahInfo.oldestEntryId);
 
-   ah_op_by_id_slice_t key(std::make_pair(ahInfo.id, start));
-   id_slice_t ahIdSlice(ahInfo.id);
+   std::vector<int64_t> opIds;
 
-   std::unique_ptr<::rocksdb::Iterator> it(_storage->NewIterator(rOptions, _columnHandles[AH_OPERATION_BY_ID]));
+   for(int64_t chunkNo = first / AH_CHUNK_SIZE; chunkNo >= lowerBound / AH_CHUNK_SIZE; --chunkNo)
+   {
+      if(loadAccountHistoryChunk(ahInfo, chunkNo, &opIds) == false)
+         continue;
 
-   it->SeekForPrev(key);
+      int64_t chunkBase = chunkNo * AH_CHUNK_SIZE;
+      int64_t top = std::min<int64_t>(first - chunkBase, static_cast<int64_t>(opIds.size()) - 1);
+      int64_t bottom = std::max<int64_t>(lowerBound - chunkBase, 0);
 
-   if(it->Valid() == false)
+      for(int64_t i = top; i >= bottom; --i)
+      {
+         rocksdb_operation_object oObj;
+         bool found = find_operation_object(opIds[i], &oObj);
+         FC_ASSERT(found, "Missing operation?");
+
+         processor(chunkBase + i, oObj);
+      }
+   }
+}
+
+void account_history_rocksdb_plugin::impl::find_account_history_data(const account_name_type& name, uint64_t start,
+   uint32_t limit, const std::vector<uint32_t>& opTypes,
+   std::function<void(unsigned int, const rocksdb_operation_object&)> processor) const
+{
+   account_history_info ahInfo;
+   if(loadAccountHistoryInfo(name, &ahInfo) == false)
       return;
 
-   auto keySlice = it->key();
-   auto keyValue = ah_op_by_id_slice_t::unpackSlice(keySlice);
+   int64_t first = static_cast<int64_t>(std::min<uint64_t>(start, ahInfo.newestEntryId));
+   if(first < ahInfo.oldestEntryId)
+      return;
+
+   /// One cursor per requested type, each walking down over the chunks holding at least one entry of its type.
+   struct type_cursor
+   {
+      uint32_t                             opType = 0;
+      std::unique_ptr<::rocksdb::Iterator> it;
+
+      int64_t chunkNo(int64_t ahId) const
+      {
+         if(it->Valid() == false)
+            return -1;
+
+         const auto& key = ah_op_type_chunk_slice_t::unpackSlice(it->key());
+         return key.first == std::make_pair(ahId, opType) ? static_cast<int64_t>(key.second) : -1;
+      }
+   };
+
+   std::vector<type_cursor> cursors;
+   flat_set<uint32_t> uniqueTypes(opTypes.begin(), opTypes.end());
+
+   for(auto opType : uniqueTypes)
+   {
+      cursors.emplace_back();
+      auto& cursor = cursors.back();
+      cursor.opType = opType;
+      cursor.it.reset(_storage->NewIterator(ReadOptions(), _columnHandles[AH_OP_TYPE_CHUNKS]));
+
+      ah_op_type_chunk_slice_t key(std::make_pair(std::make_pair(ahInfo.id, opType),
+         static_cast<uint32_t>(first / AH_CHUNK_SIZE)));
+      cursor.it->SeekForPrev(key);
+   }
 
-   auto lowerBound = keyValue.second > limit ? keyValue.second - limit : 0;
+   int64_t oldestChunkNo = ahInfo.oldestEntryId / AH_CHUNK_SIZE;
+   uint32_t found = 0;
+   std::string bitmap;
+   std::vector<int64_t> opIds;
 
-   for(; it->Valid(); it->Prev())
+   while(found < limit)
    {
-      auto keySlice = it->key();
-      if(keySlice.starts_with(ahIdSlice) == false)
+      int64_t chunkNo = -1;
+      for(const auto& cursor : cursors)
+         chunkNo = std::max(chunkNo, cursor.chunkNo(ahInfo.id));
+
+      if(chunkNo < oldestChunkNo)
          break;
 
-      keyValue = ah_op_by_id_slice_t::unpackSlice(keySlice);
+      /// Union of the type bitmaps selects the chunk entries to be returned.
+      bitmap.assign(AH_CHUNK_BITMAP_SIZE, '\0');
+      for(auto& cursor : cursors)
+      {
+         if(cursor.chunkNo(ahInfo.id) != chunkNo)
+            continue;
+
+         Slice value = cursor.it->value();
+         for(size_t i = 0; i < AH_CHUNK_BITMAP_SIZE && i < value.size(); ++i)
+            bitmap[i] |= value[i];
 
-      auto valueSlice = it->value();
-      const auto& opId = id_slice_t::unpackSlice(valueSlice);
-      rocksdb_operation_object oObj;
-      bool found = find_operation_object(opId, &oObj);
-      FC_ASSERT(found, "Missing operation?");
+         cursor.it->Prev();
+      }
 
-      processor(keyValue.second, oObj);
+      if(loadAccountHistoryChunk(ahInfo, chunkNo, &opIds) == false)
+         continue;
 
-      if(keyValue.second <= lowerBound)
-        break;
+      int64_t chunkBase = chunkNo * AH_CHUNK_SIZE;
+      int64_t top = std::min<int64_t>(first - chunkBase, static_cast<int64_t>(opIds.size()) - 1);
+
+      for(int64_t i = top; i >= 0 && chunkBase + i >= ahInfo.oldestEntryId && found < limit; --i)
+      {
+         if(entry_bitmap_merge_operator::isSet(bitmap, i) == false)
+            continue;
+
+         rocksdb_operation_object oObj;
+         bool exists = find_operation_object(opIds[i], &oObj);
+         FC_ASSERT(exists, "Missing operation?");
+
+         processor(chunkBase + i, oObj);
+         ++found;
+      }
    }
+
+   for(const auto& cursor : cursors)
+      checkStatus(cursor.it->status());
 }
 
 bool account_history_rocksdb_plugin::impl::find_operation_object(size_t opId, rocksdb_operation_object* op) const
@@ -926,17 +1215,22 @@ bool account_history_rocksdb_plugin::impl::find_operation_object(size_t opId, ro
 void account_history_rocksdb_plugin::impl::find_operations_by_block(size_t blockNum,
    std::function<void(const rocksdb_operation_object&)> processor) const
 {
-   std::unique_ptr<::rocksdb::Iterator> it(_storage->NewIterator(ReadOptions(), _columnHandles[OPERATION_BY_BLOCK]));
-   by_block_slice_t blockNumSlice(blockNum);
-   op_by_block_num_slice_t key(block_op_id_pair(blockNum, 0));
+   by_block_slice_t key(blockNum);
+   PinnableSlice buffer;
+   auto s = _storage->Get(ReadOptions(), _columnHandles[OPERATION_BY_BLOCK], key, &buffer);
 
-   for(it->Seek(key); it->Valid() && it->key().starts_with(blockNumSlice); it->Next())
-   {
-      auto valueSlice = it->value();
-      const auto& opId = id_slice_t::unpackSlice(valueSlice);
+   if(s.IsNotFound())
+      return;
 
+   checkStatus(s);
+
+   block_operations_record record;
+   record.unpack(blockNum, buffer);
+
+   for(uint32_t i = 0; i < record.count; ++i)
+   {
       rocksdb_operation_object op;
-      bool found = find_operation_object(opId, &op);
+      bool found = find_operation_object(record.firstOpId + i, &op);
       FC_ASSERT(found);
 
       processor(op);
@@ -945,55 +1239,76 @@ void account_history_rocksdb_plugin::impl::find_operations_by_block(size_t block
 
 uint32_t account_history_rocksdb_plugin::impl::enumVirtualOperationsFromBlockRange(uint32_t blockRangeBegin,
    uint32_t blockRangeEnd, std::function<void(const rocksdb_operation_object&)> processor) const
+{
+   uint64_t nextCursor = 0;
+   return enumVirtualOperations(blockRangeBegin, blockRangeEnd, 0, 0, std::vector<uint32_t>(), processor, &nextCursor);
+}
+
+uint32_t account_history_rocksdb_plugin::impl::enumVirtualOperations(uint32_t blockRangeBegin, uint32_t blockRangeEnd,
+   uint64_t cursor, uint32_t limit, const std::vector<uint32_t>& opTypes,
+   std::function<void(const rocksdb_operation_object&)> processor, uint64_t* nextCursor) const
 {
    FC_ASSERT(blockRangeEnd > blockRangeBegin, "Block range must be upward");
 
-   op_by_block_num_slice_t upperBoundSlice(block_op_id_pair(blockRangeEnd, 0));
+   block_vop_index_pair begin(blockRangeBegin, 0);
+   if(cursor != 0)
+   {
+      begin = block_vop_index_pair(cursor >> 32, static_cast<uint32_t>(cursor));
+      FC_ASSERT(begin.first >= blockRangeBegin && begin.first < blockRangeEnd,
+         "Cursor must point into the block range");
+   }
 
-   op_by_block_num_slice_t rangeBeginSlice(block_op_id_pair(blockRangeBegin, 0));
+   vop_by_block_slice_t upperBoundSlice(block_vop_index_pair(blockRangeEnd, 0));
+   vop_by_block_slice_t rangeBeginSlice(begin);
 
    ReadOptions rOptions;
    rOptions.iterate_upper_bound = &upperBoundSlice;
 
-   std::unique_ptr<::rocksdb::Iterator> it(_storage->NewIterator(rOptions, _columnHandles[OPERATION_BY_BLOCK]));
+   std::unique_ptr<::rocksdb::Iterator> it(_storage->NewIterator(rOptions, _columnHandles[VIRTUAL_OP_BY_BLOCK]));
 
+   flat_set<uint32_t> selectedTypes(opTypes.begin(), opTypes.end());
    uint32_t lastFoundBlock = 0;
+   uint32_t found = 0;
+   *nextCursor = 0;
 
    for(it->Seek(rangeBeginSlice); it->Valid(); it->Next())
    {
-      auto keySlice = it->key();
-      const auto& key = op_by_block_num_slice_t::unpackSlice(keySlice);
+      const auto& key = vop_by_block_slice_t::unpackSlice(it->key());
 
-      /// Accept only virtual operations
-      if(key.second & VIRTUAL_OP_FLAG)
-      {
-         auto valueSlice = it->value();
-         const auto& opId = id_slice_t::unpackSlice(valueSlice);
+      uint32_t opType = 0;
+      int64_t opId = 0;
+      unpackVirtualOpEntry(it->value(), &opType, &opId);
 
-         rocksdb_operation_object op;
-         bool found = find_operation_object(opId, &op);
-         FC_ASSERT(found);
+      if(selectedTypes.empty() == false && selectedTypes.count(opType) == 0)
+         continue;
 
-         processor(op);
-         lastFoundBlock = op.block;
+      if(limit != 0 && found >= limit)
+      {
+         *nextCursor = (static_cast<uint64_t>(key.first) << 32) | key.second;
+         return key.first;
       }
+
+      rocksdb_operation_object op;
+      bool exists = find_operation_object(opId, &op);
+      FC_ASSERT(exists);
+
+      processor(op);
+      lastFoundBlock = key.first;
+      ++found;
    }
 
-   op_by_block_num_slice_t lowerBoundSlice(block_op_id_pair(lastFoundBlock, 0));
+   checkStatus(it->status());
+
    rOptions = ReadOptions();
-   rOptions.iterate_lower_bound = &lowerBoundSlice;
-   it.reset(_storage->NewIterator(rOptions, _columnHandles[OPERATION_BY_BLOCK]));
+   it.reset(_storage->NewIterator(rOptions, _columnHandles[VIRTUAL_OP_BY_BLOCK]));
 
-   op_by_block_num_slice_t nextRangeBeginSlice(block_op_id_pair(lastFoundBlock + 1, 0));
-   for(it->Seek(nextRangeBeginSlice); it->Valid(); it->Next())
-   {
-      auto keySlice = it->key();
-      const auto& key = op_by_block_num_slice_t::unpackSlice(keySlice);
+   vop_by_block_slice_t nextRangeBeginSlice(block_vop_index_pair(lastFoundBlock + 1, 0));
+   it->Seek(nextRangeBeginSlice);
 
-      if(key.second & VIRTUAL_OP_FLAG)
-         return key.first;
-   }
+   if(it->Valid())
+      return vop_by_block_slice_t::unpackSlice(it->key()).first;
 
+   checkStatus(it->status());
    return 0;
 }
 
@@ -1027,17 +1342,31 @@ account_history_rocksdb_plugin::impl::ColumnDefinitions account_history_rocksdb_
    auto& byIdColumn = columnDefs.back();
    byIdColumn.options.comparator = by_id_Comparator();
 
-   columnDefs.emplace_back("operation_by_block", ColumnFamilyOptions());
+   columnDefs.emplace_back("operation_range_by_block", ColumnFamilyOptions());
    auto& byLocationColumn = columnDefs.back();
-   byLocationColumn.options.comparator = op_by_block_num_Comparator();
+   byLocationColumn.options.comparator = by_block_Comparator();
 
    columnDefs.emplace_back("account_history_info_by_name", ColumnFamilyOptions());
    auto& byAccountNameColumn = columnDefs.back();
    byAccountNameColumn.options.comparator = by_account_name_Comparator();
 
-   columnDefs.emplace_back("ah_operation_by_id", ColumnFamilyOptions());
+   columnDefs.emplace_back("ah_operation_chunks", ColumnFamilyOptions());
    auto& byAHInfoColumn = columnDefs.back();
-   byAHInfoColumn.options.comparator = ah_op_by_id_Comparator();
+   byAHInfoColumn.options.comparator = ah_chunk_Comparator();
+   /// Entries are appended to their chunks by merge operands.
+   byAHInfoColumn.options.merge_operator = _chunkMergeOperator;
+   /// Retention policy is applied in background, while entries get compacted.
+   byAHInfoColumn.options.compaction_filter_factory = _pruneFilterFactory;
+
+   columnDefs.emplace_back("ah_op_type_chunks", ColumnFamilyOptions());
+   auto& byAHOpTypeColumn = columnDefs.back();
+   byAHOpTypeColumn.options.comparator = ah_op_type_chunk_Comparator();
+   byAHOpTypeColumn.options.merge_operator = _bitmapMergeOperator;
+   byAHOpTypeColumn.options.compaction_filter_factory = _opTypePruneFilterFactory;
+
+   columnDefs.emplace_back("virtual_operation_by_block", ColumnFamilyOptions());
+   auto& vopByBlockColumn = columnDefs.back();
+   vopByBlockColumn.options.comparator = vop_by_block_Comparator();
 
    return columnDefs;
 }
@@ -1110,21 +1439,7 @@ void account_history_rocksdb_plugin::impl::buildAccountHistoryRecord( const acco
 
    if(found)
    {
-      auto count = ahInfo.getAssociatedOpCount();
-
-      if(_prune && count > ACCOUNT_HISTORY_LENGTH_LIMIT &&
-         ((obj.timestamp - ahInfo.oldestEntryTimestamp) > fc::days(ACCOUNT_HISTORY_TIME_LIMIT)))
-         {
-            prunePotentiallyTooOldItems(&ahInfo, name, obj.timestamp);
-         }
-
-      auto nextEntryId = ++ahInfo.newestEntryId;
-       _writeBuffer.putAHInfo(name, ahInfo);
-
-      ah_op_by_id_slice_t ahInfoOpSlice(std::make_pair(ahInfo.id, nextEntryId));
-      id_slice_t valueSlice(obj.id);
-      auto s = _writeBuffer.Put(_columnHandles[AH_OPERATION_BY_ID], ahInfoOpSlice, valueSlice);
-      checkStatus(s);
+      ++ahInfo.newestEntryId;
    }
    else
    {
@@ -1132,84 +1447,46 @@ void account_history_rocksdb_plugin::impl::buildAccountHistoryRecord( const acco
       ahInfo.id = _accountHistorySeqId++;
       ahInfo.newestEntryId = ahInfo.oldestEntryId = 0;
       ahInfo.oldestEntryTimestamp = obj.timestamp;
-
-      _writeBuffer.putAHInfo(name, ahInfo);
-
-      ah_op_by_id_slice_t ahInfoOpSlice(std::make_pair(ahInfo.id, 0));
-      id_slice_t valueSlice(obj.id);
-      auto s = _writeBuffer.Put(_columnHandles[AH_OPERATION_BY_ID], ahInfoOpSlice, valueSlice);
-      checkStatus(s);
    }
-}
-
-void account_history_rocksdb_plugin::impl::prunePotentiallyTooOldItems(account_history_info* ahInfo, const account_name_type& name,
-   const fc::time_point_sec& now)
-{
-   std::string strName = name;
 
-   auto ageLimit =  fc::days(ACCOUNT_HISTORY_TIME_LIMIT);
+   _writeBuffer.putAHInfo(name, ahInfo);
 
-   ah_op_by_id_slice_t oldestEntrySlice(
-      std::make_pair(ahInfo->id, ahInfo->oldestEntryId));
-   auto lookupUpperBound = std::make_pair(ahInfo->id + 1,
-      ahInfo->newestEntryId - ACCOUNT_HISTORY_LENGTH_LIMIT + 1);
+   uint32_t chunkNo = ahInfo.newestEntryId / AH_CHUNK_SIZE;
+   uint32_t position = ahInfo.newestEntryId % AH_CHUNK_SIZE;
 
-   ah_op_by_id_slice_t newestEntrySlice(lookupUpperBound);
-
-   ReadOptions rOptions;
-   //rOptions.tailing = true;
-   rOptions.iterate_lower_bound = &oldestEntrySlice;
-   rOptions.iterate_upper_bound = &newestEntrySlice;
-
-   auto s = _writeBuffer.SingleDelete(_columnHandles[AH_OPERATION_BY_ID], oldestEntrySlice);
+   ah_chunk_slice_t chunkSlice(std::make_pair(ahInfo.id, chunkNo));
+   int64_t opId = obj.id;
+   auto s = _writeBuffer.Merge(_columnHandles[AH_OPERATION_CHUNKS], chunkSlice,
+      account_history_chunk::makeOperand(position, &opId, 1));
    checkStatus(s);
 
-   std::unique_ptr<::rocksdb::Iterator> dataItr(_storage->NewIterator(rOptions, _columnHandles[AH_OPERATION_BY_ID]));
-
-   /** To clean outdated records we have to iterate over all AH records having subsequent number greater than limit
-    *  and additionally verify date of operation, to clean up only these exceeding a date limit.
-    *  So just operations having a list position > ACCOUNT_HISTORY_LENGTH_LIMIT and older that ACCOUNT_HISTORY_TIME_LIMIT
-    *  shall be removed.
-    */
-   dataItr->Seek(oldestEntrySlice);
-
-   /// Boundaries of keys to be removed
-   //uint32_t leftBoundary = ahInfo->oldestEntryId;
-   uint32_t rightBoundary = ahInfo->oldestEntryId;
+   ah_op_type_chunk_slice_t opTypeSlice(std::make_pair(std::make_pair(ahInfo.id, getOperationType(obj)), chunkNo));
+   std::string bitmap;
+   entry_bitmap_merge_operator::set(&bitmap, position);
+   s = _writeBuffer.Merge(_columnHandles[AH_OP_TYPE_CHUNKS], opTypeSlice, bitmap);
+   checkStatus(s);
 
-   for(; dataItr->Valid(); dataItr->Next())
+   if(_prune)
    {
-      auto key = dataItr->key();
-      auto foundEntry = ah_op_by_id_slice_t::unpackSlice(key);
-
-      if(foundEntry.first != ahInfo->id || foundEntry.second >= lookupUpperBound.second)
-         break;
-
-      auto value = dataItr->value();
+      _retention.setNewestEntry(ahInfo.id, ahInfo.newestEntryId);
+      _retention.setNewestTimestamp(obj.timestamp);
+   }
+}
 
-      auto pointedOpId = id_slice_t::unpackSlice(value);
-      rocksdb_operation_object op;
-      find_operation_object(pointedOpId, &op);
+void account_history_rocksdb_plugin::impl::loadRetentionState()
+{
+   std::unique_ptr<::rocksdb::Iterator> it(_storage->NewIterator(ReadOptions(), _columnHandles[AH_INFO_BY_NAME]));
 
-      auto age = now - op.timestamp;
+   for(it->SeekToFirst(); it->Valid(); it->Next())
+   {
+      account_history_info ahInfo;
+      load(ahInfo, it->value().data(), it->value().size());
+      _retention.setNewestEntry(ahInfo.id, ahInfo.newestEntryId);
+   }
 
-      if(age > ageLimit)
-      {
-         rightBoundary = foundEntry.second;
-         ah_op_by_id_slice_t rightBoundarySlice(
-            std::make_pair(ahInfo->id, rightBoundary));
-         s = _writeBuffer.SingleDelete(_columnHandles[4], rightBoundarySlice);
-         checkStatus(s);
-      }
-      else
-      {
-         ahInfo->oldestEntryId = foundEntry.second;
-         ahInfo->oldestEntryTimestamp = op.timestamp;
-         FC_ASSERT(ahInfo->oldestEntryId <= ahInfo->newestEntryId);
+   checkStatus(it->status());
 
-         break;
-      }
-   }
+   _retention.attach(_storage.get(), _columnHandles[OPERATION_BY_ID], _columnHandles[AH_OPERATION_CHUNKS]);
 }
 
 void account_history_rocksdb_plugin::impl::on_pre_reindex(const steem::chain::reindex_notification& note)
@@ -1230,6 +1507,7 @@ void account_history_rocksdb_plugin::impl::on_pre_reindex(const steem::chain::re
 
    _lastTx = transaction_id_type();
    _txNo = 0;
+   _blockRecord.clear();
    _totalOps = 0;
    _excludedOps = 0;
    _reindexing = true;
@@ -1260,7 +1538,7 @@ void account_history_rocksdb_plugin::impl::printReport(uint32_t blockNo, const c
       ("tx", _txNo)
       ("op", _totalOps)
       ("ep", _excludedOps)
-      ("ea", _excludedAccountCount)
+      ("ea", _excludedAccountCount.load())
       );
 }
 
@@ -1279,52 +1557,60 @@ void account_history_rocksdb_plugin::impl::importData(unsigned int blockLimit)
 
    _lastTx = transaction_id_type();
    _txNo = 0;
+   _blockRecord.clear();
    _totalOps = 0;
    _excludedOps = 0;
 
    benchmark_dumper dumper;
    dumper.initialize([](benchmark_dumper::database_object_sizeof_cntr_t&){}, "rocksdb_data_import.json");
 
-   _mainDb.foreach_operation([blockLimit, &blockNo, &lastBlock, this](
-      const signed_block_header& prevBlockHeader, const signed_block& block, const signed_transaction& tx,
-      uint32_t txInBlock, const operation& op, uint16_t opInTx) -> bool
+   if(_importThreadCount > 1)
    {
-      if(lastBlock != block.previous)
+      blockNo = importDataInParallel(blockLimit, _importThreadCount);
+   }
+   else
+   {
+      _mainDb.foreach_operation([blockLimit, &blockNo, &lastBlock, this](
+         const signed_block_header& prevBlockHeader, const signed_block& block, const signed_transaction& tx,
+         uint32_t txInBlock, const operation& op, uint16_t opInTx) -> bool
       {
-         blockNo = block.block_num();
-         lastBlock = block.previous;
-
-         if(blockLimit != 0 && blockNo > blockLimit)
+         if(lastBlock != block.previous)
          {
-            ilog( "RocksDb data import stopped because of block limit reached.");
-            return false;
+            blockNo = block.block_num();
+            lastBlock = block.previous;
+
+            if(blockLimit != 0 && blockNo > blockLimit)
+            {
+               ilog( "RocksDb data import stopped because of block limit reached.");
+               return false;
+            }
          }
-      }
 
-      auto impacted = getImpactedAccounts( op );
+         auto impacted = getImpactedAccounts( op );
 
-      if( impacted.empty() )
-         return true;
+         if( impacted.empty() )
+            return true;
 
-      rocksdb_operation_object obj;
-      obj.trx_id = tx.id();
-      obj.block = blockNo;
-      obj.trx_in_block = txInBlock;
-      obj.op_in_trx = opInTx;
-      obj.timestamp = _mainDb.head_block_time();
-      auto size = fc::raw::pack_size( op );
-      obj.serialized_op.resize( size );
-      fc::datastream< char* > ds( obj.serialized_op.data(), size );
-      fc::raw::pack( ds, op );
+         rocksdb_operation_object obj;
+         obj.trx_id = tx.id();
+         obj.block = blockNo;
+         obj.trx_in_block = txInBlock;
+         obj.op_in_trx = opInTx;
+         obj.timestamp = block.timestamp;
+         auto size = fc::raw::pack_size( op );
+         obj.serialized_op.resize( size );
+         fc::datastream< char* > ds( obj.serialized_op.data(), size );
+         fc::raw::pack( ds, op );
 
-      importOperation( obj, impacted );
+         importOperation( obj, impacted );
 
-      return true;
-   }
-   );
+         return true;
+      }
+      );
 
-   if(_collectedOps != 0)
-      flushWriteBuffer();
+      if(_collectedOps != 0)
+         flushWriteBuffer();
+   }
 
    const auto& measure = dumper.measure(blockNo, [](benchmark_dumper::index_memory_details_cntr_t&, bool){});
    ilog( "RocksDb data import - Performance report at block ${n}. Elapsed time: ${rt} ms (real), ${ct} ms (cpu). Memory usage: ${cm} (current), ${pm} (peak) kilobytes.",
@@ -1337,6 +1623,451 @@ void account_history_rocksdb_plugin::impl::importData(unsigned int blockLimit)
    printReport(blockNo, "RocksDB data import finished. ");
 }
 
+/** Data import split across threads:
+ *  - blocks are read from block_log by the calling thread (the log is a single stream) and grouped into chunks,
+ *  - worker threads compute transaction ids and impacted accounts and serialize operations of each chunk,
+ *  - the calling thread merges prepared chunks strictly in block order, assigning operation and account history
+ *    sequence numbers exactly like the sequential import does,
+ *  - worker threads write the merged chunk into sorted SST files and ingest them into the storage.
+ *  Memory usage is bounded by the number of chunks allowed to be in flight at once.
+ */
+size_t account_history_rocksdb_plugin::impl::importDataInParallel(unsigned int blockLimit, unsigned int threadCount)
+{
+   ilog("Importing data using ${n} threads.", ("n", threadCount));
+
+   bfs::path sstDir = _storagePath / "import";
+   bfs::remove_all(sstDir);
+   bfs::create_directories(sstDir);
+
+   boost::asio::io_service ios;
+   std::unique_ptr<boost::asio::io_service::work> work(new boost::asio::io_service::work(ios));
+   std::vector<std::thread> workers;
+   for(unsigned int i = 0; i < threadCount; ++i)
+      workers.emplace_back([&ios]() { ios.run(); });
+
+   auto stopWorkers = [&]()
+   {
+      work.reset();
+      ios.stop();
+      for(auto& w : workers)
+         w.join();
+      workers.clear();
+   };
+
+   std::mutex mtx;
+   std::condition_variable cv;
+   std::map<size_t, std::shared_ptr<import_chunk>> prepared;
+   std::exception_ptr failure;
+   size_t inFlight = 0;
+   size_t chunkCount = 0;
+   size_t nextToMerge = 0;
+   /// Merge operands of account history chunks have to be applied in entry order, so chunks are ingested in turn.
+   size_t nextAhIngest = 0;
+   const size_t inFlightLimit = 2 * threadCount;
+
+   std::map<account_name_type, account_history_info> ahInfos;
+
+   /// Runs given job at the worker pool, the first failure is reported back to the calling thread.
+   auto post = [&](std::function<void()> job)
+   {
+      ios.post([&, job]()
+      {
+         try
+         {
+            job();
+         }
+         catch(...)
+         {
+            std::lock_guard<std::mutex> guard(mtx);
+            if(!failure)
+               failure = std::current_exception();
+            cv.notify_all();
+         }
+      });
+   };
+
+   /// Merges every prepared chunk which is next in order, then waits until either less than limit chunks are in
+   /// flight or, when draining, all of them have been ingested.
+   auto pump = [&](bool drain)
+   {
+      std::unique_lock<std::mutex> lock(mtx);
+      for(;;)
+      {
+         if(failure)
+            std::rethrow_exception(failure);
+
+         auto itr = prepared.find(nextToMerge);
+         if(itr != prepared.end())
+         {
+            auto chunk = itr->second;
+            prepared.erase(itr);
+            ++nextToMerge;
+            lock.unlock();
+
+            mergeImportChunk(*chunk, ahInfos);
+            post([&, chunk]()
+            {
+               auto ahFiles = writeImportChunk(*chunk, sstDir);
+
+               {
+                  std::unique_lock<std::mutex> turnLock(mtx);
+                  cv.wait(turnLock, [&]() { return nextAhIngest == chunk->chunkNo || failure; });
+                  if(failure)
+                     return;
+               }
+
+               for(const auto& file : ahFiles)
+                  ingestSstFile(file.first, file.second);
+
+               if(_prune)
+                  updateImportRetention(*chunk);
+
+               std::lock_guard<std::mutex> guard(mtx);
+               ++nextAhIngest;
+               --inFlight;
+               cv.notify_all();
+            });
+
+            lock.lock();
+            continue;
+         }
+
+         if(drain ? (nextToMerge == chunkCount && inFlight == 0) : inFlight < inFlightLimit)
+            return;
+
+         cv.wait(lock);
+      }
+   };
+
+   auto dispatch = [&](std::shared_ptr<import_chunk> chunk)
+   {
+      pump(false);
+
+      chunk->chunkNo = chunkCount++;
+      {
+         std::lock_guard<std::mutex> guard(mtx);
+         ++inFlight;
+      }
+
+      post([&, chunk]()
+      {
+         prepareImportChunk(*chunk);
+
+         std::lock_guard<std::mutex> guard(mtx);
+         prepared[chunk->chunkNo] = chunk;
+         cv.notify_all();
+      });
+   };
+
+   size_t blockNo = 0;
+
+   try
+   {
+      auto chunk = std::make_shared<import_chunk>();
+      chunk->blocks.reserve(IMPORT_CHUNK_BLOCK_COUNT);
+
+      _mainDb.foreach_block([&](const signed_block_header& prevBlockHeader, const signed_block& block) -> bool
+      {
+         if(blockLimit != 0 && block.block_num() > blockLimit)
+         {
+            ilog( "RocksDb data import stopped because of block limit reached.");
+            return false;
+         }
+
+         blockNo = block.block_num();
+         chunk->blocks.push_back(block);
+
+         if(chunk->blocks.size() >= IMPORT_CHUNK_BLOCK_COUNT)
+         {
+            dispatch(chunk);
+            chunk = std::make_shared<import_chunk>();
+            chunk->blocks.reserve(IMPORT_CHUNK_BLOCK_COUNT);
+         }
+
+         if(blockNo % 100000 == 0)
+            printReport(blockNo, "RocksDb data import in progress. ");
+
+         return true;
+      });
+
+      if(chunk->blocks.empty() == false)
+         dispatch(chunk);
+
+      pump(true);
+   }
+   catch(...)
+   {
+      stopWorkers();
+      bfs::remove_all(sstDir);
+      throw;
+   }
+
+   stopWorkers();
+   bfs::remove_all(sstDir);
+
+   for(const auto& info : ahInfos)
+      _writeBuffer.putAHInfo(info.first, info.second);
+
+   flushWriteBuffer();
+
+   return blockNo;
+}
+
+void account_history_rocksdb_plugin::impl::prepareImportChunk(import_chunk& chunk) const
+{
+   for(const auto& block : chunk.blocks)
+   {
+      uint32_t blockNo = block.block_num();
+      uint32_t txInBlock = 0;
+
+      for(const auto& tx : block.transactions)
+      {
+         transaction_id_type txId = tx.id();
+         uint16_t opInTx = 0;
+
+         for(const auto& op : tx.operations)
+         {
+            auto impacted = getImpactedAccounts( op );
+
+            if( impacted.empty() == false )
+            {
+               chunk.ops.emplace_back();
+               auto& obj = chunk.ops.back().first;
+               obj.trx_id = txId;
+               obj.block = blockNo;
+               obj.trx_in_block = txInBlock;
+               obj.op_in_trx = opInTx;
+               obj.timestamp = block.timestamp;
+               auto size = fc::raw::pack_size( op );
+               obj.serialized_op.resize( size );
+               fc::datastream< char* > ds( obj.serialized_op.data(), size );
+               fc::raw::pack( ds, op );
+
+               chunk.ops.back().second = std::move(impacted);
+            }
+
+            ++opInTx;
+         }
+
+         ++txInBlock;
+      }
+   }
+
+   /// Blocks are no longer needed, release them before the chunk waits for its turn to be merged.
+   std::vector<signed_block>().swap(chunk.blocks);
+}
+
+void account_history_rocksdb_plugin::impl::mergeImportChunk(import_chunk& chunk,
+   std::map<account_name_type, account_history_info>& ahInfos)
+{
+   for(auto& prepared : chunk.ops)
+   {
+      auto& obj = prepared.first;
+
+      if(_lastTx != obj.trx_id)
+      {
+         ++_txNo;
+         _lastTx = obj.trx_id;
+      }
+
+      obj.id = _operationSeqId++;
+
+      for(const auto& name : prepared.second)
+      {
+         auto itr = ahInfos.find(name);
+         if(itr == ahInfos.end())
+         {
+            account_history_info ahInfo;
+            if(_writeBuffer.getAHInfo(name, &ahInfo))
+            {
+               ++ahInfo.newestEntryId;
+            }
+            else
+            {
+               ahInfo.id = _accountHistorySeqId++;
+               ahInfo.newestEntryId = ahInfo.oldestEntryId = 0;
+               ahInfo.oldestEntryTimestamp = obj.timestamp;
+            }
+
+            itr = ahInfos.emplace(name, ahInfo).first;
+         }
+         else
+         {
+            ++itr->second.newestEntryId;
+         }
+
+         chunk.ahEntries.emplace_back(std::make_pair(itr->second.id, itr->second.newestEntryId), obj.id);
+      }
+
+      ++_totalOps;
+   }
+}
+
+/** Called once the chunk has been ingested, in chunk order. The filters must not learn about entries ahead of the
+ *  storage, otherwise they could judge chunks and bitmaps which only have part of their entries written so far.
+ */
+void account_history_rocksdb_plugin::impl::updateImportRetention(const import_chunk& chunk)
+{
+   for(const auto& entry : chunk.ahEntries)
+      _retention.setNewestEntry(entry.first.first, entry.first.second);
+
+   if(chunk.ops.empty() == false)
+      _retention.setNewestTimestamp(chunk.ops.back().first.timestamp);
+}
+
+sst_files_t account_history_rocksdb_plugin::impl::writeImportChunk(const import_chunk& chunk, const bfs::path& sstDir) const
+{
+   sst_entries_t byId;
+   sst_entries_t byBlock;
+   sst_entries_t ahChunks;
+   std::map<ah_op_type_chunk_id, std::string> opTypeBitmaps;
+
+   byId.reserve(chunk.ops.size());
+
+   /// Operations of the chunk have consecutive ids, so their types can be indexed by id offset.
+   std::vector<uint32_t> opTypes;
+   opTypes.reserve(chunk.ops.size());
+   int64_t firstOpId = chunk.ops.empty() ? 0 : chunk.ops.front().first.id;
+
+   sst_entries_t vopByBlock;
+   block_operations_record blockRecord;
+
+   for(const auto& prepared : chunk.ops)
+   {
+      const auto& obj = prepared.first;
+      auto serializedObj = dump(obj);
+
+      id_slice_t idSlice(obj.id);
+      byId.emplace_back(idSlice.ToString(), std::string(serializedObj.data(), serializedObj.size()));
+
+      if(blockRecord.count != 0 && blockRecord.block != obj.block)
+      {
+         byBlock.emplace_back(by_block_slice_t(blockRecord.block).ToString(), blockRecord.pack());
+         blockRecord.clear();
+      }
+
+      blockRecord.block = obj.block;
+      blockRecord.add(obj.id);
+
+      opTypes.push_back(getOperationType(obj));
+
+      if(obj.virtual_op > 0)
+      {
+         vop_by_block_slice_t vopSlice(std::make_pair(obj.block, blockRecord.virtualCount++));
+         vopByBlock.emplace_back(vopSlice.ToString(), packVirtualOpEntry(opTypes.back(), obj.id));
+      }
+   }
+
+   if(blockRecord.count != 0)
+      byBlock.emplace_back(by_block_slice_t(blockRecord.block).ToString(), blockRecord.pack());
+
+   /// Entries of a single account history are consecutive, so each touched chunk gets one operand per import chunk.
+   auto ahEntries = chunk.ahEntries;
+   std::sort(ahEntries.begin(), ahEntries.end());
+
+   std::vector<int64_t> opIds;
+   for(size_t i = 0; i < ahEntries.size();)
+   {
+      int64_t ahId = ahEntries[i].first.first;
+      uint32_t chunkNo = ahEntries[i].first.second / AH_CHUNK_SIZE;
+      uint16_t firstPosition = ahEntries[i].first.second % AH_CHUNK_SIZE;
+
+      opIds.clear();
+      for(; i < ahEntries.size() && ahEntries[i].first.first == ahId &&
+         ahEntries[i].first.second / AH_CHUNK_SIZE == chunkNo; ++i)
+      {
+         const auto& entry = ahEntries[i];
+         opIds.push_back(entry.second);
+
+         uint32_t opType = opTypes[entry.second - firstOpId];
+         entry_bitmap_merge_operator::set(&opTypeBitmaps[std::make_pair(std::make_pair(ahId, opType), chunkNo)],
+            entry.first.second % AH_CHUNK_SIZE);
+      }
+
+      ah_chunk_slice_t chunkSlice(std::make_pair(ahId, chunkNo));
+      ahChunks.emplace_back(chunkSlice.ToString(),
+         account_history_chunk::makeOperand(firstPosition, opIds.data(), opIds.size()));
+   }
+
+   sst_entries_t ahOpTypes;
+   ahOpTypes.reserve(opTypeBitmaps.size());
+   for(const auto& bitmap : opTypeBitmaps)
+      ahOpTypes.emplace_back(ah_op_type_chunk_slice_t(bitmap.first).ToString(), bitmap.second);
+
+   auto prefix = "chunk-" + std::to_string(chunk.chunkNo);
+
+   bfs::path sstFile = sstDir / (prefix + "-operation_by_id.sst");
+   if(writeSstFile(OPERATION_BY_ID, byId, sstFile, false))
+      ingestSstFile(OPERATION_BY_ID, sstFile);
+
+   sstFile = sstDir / (prefix + "-operation_range_by_block.sst");
+   if(writeSstFile(OPERATION_BY_BLOCK, byBlock, sstFile, false))
+      ingestSstFile(OPERATION_BY_BLOCK, sstFile);
+
+   sstFile = sstDir / (prefix + "-virtual_operation_by_block.sst");
+   if(writeSstFile(VIRTUAL_OP_BY_BLOCK, vopByBlock, sstFile, false))
+      ingestSstFile(VIRTUAL_OP_BY_BLOCK, sstFile);
+
+   /// Bitmaps go after their chunks, so the pruning filter never sees a bitmap whose chunk is still to come.
+   sst_files_t ahFiles;
+
+   sstFile = sstDir / (prefix + "-ah_operation_chunks.sst");
+   if(writeSstFile(AH_OPERATION_CHUNKS, ahChunks, sstFile, true))
+      ahFiles.emplace_back(AH_OPERATION_CHUNKS, sstFile);
+
+   sstFile = sstDir / (prefix + "-ah_op_type_chunks.sst");
+   if(writeSstFile(AH_OP_TYPE_CHUNKS, ahOpTypes, sstFile, true))
+      ahFiles.emplace_back(AH_OP_TYPE_CHUNKS, sstFile);
+
+   return ahFiles;
+}
+
+/** SST files must hold keys ordered by the column comparator, which for some columns differs from the numeric
+ *  order of the ids, so entries are always sorted with the comparator of the target column.
+ */
+bool account_history_rocksdb_plugin::impl::writeSstFile(int column, sst_entries_t& entries, const bfs::path& sstFile,
+   bool merge) const
+{
+   if(entries.empty())
+      return false;
+
+   auto* handle = _columnHandles[column];
+   const Comparator* comparator = handle->GetComparator();
+
+   std::sort(entries.begin(), entries.end(),
+      [comparator](const sst_entries_t::value_type& a, const sst_entries_t::value_type& b)
+      {
+         return comparator->Compare(a.first, b.first) < 0;
+      });
+
+   Options options;
+   options.comparator = comparator;
+
+   ::rocksdb::SstFileWriter writer(::rocksdb::EnvOptions(), options, handle);
+   auto s = writer.Open(sstFile.string());
+   checkStatus(s);
+
+   for(const auto& entry : entries)
+   {
+      s = merge ? writer.Merge(entry.first, entry.second) : writer.Put(entry.first, entry.second);
+      checkStatus(s);
+   }
+
+   s = writer.Finish();
+   checkStatus(s);
+
+   return true;
+}
+
+void account_history_rocksdb_plugin::impl::ingestSstFile(int column, const bfs::path& sstFile) const
+{
+   ::rocksdb::IngestExternalFileOptions ingestOptions;
+   ingestOptions.move_files = true;
+
+   auto s = _storage->IngestExternalFile(_columnHandles[column], { sstFile.string() }, ingestOptions);
+   checkStatus(s);
+}
+
 void account_history_rocksdb_plugin::impl::on_post_apply_operation(const operation_notification& n)
 {
    if( n.block % 10000 == 0 && n.trx_in_block == 0 && n.op_in_trx == 0 && n.virtual_op == 0 )
@@ -1348,7 +2079,7 @@ void account_history_rocksdb_plugin::impl::on_post_apply_operation(const operati
          ("tx", _txNo)
          ("op", _totalOps)
          ("ep", _excludedOps)
-         ("ea", _excludedAccountCount)
+         ("ea", _excludedAccountCount.load())
          );
    }
 
@@ -1444,6 +2175,7 @@ void account_history_rocksdb_plugin::set_program_options(
       ("account-history-rocksdb-track-account-range", boost::program_options::value< std::vector<std::string> >()->composing()->multitoken(), "Defines a range of accounts to track as a json pair [\"from\",\"to\"] [from,to] Can be specified multiple times.")
       ("account-history-rocksdb-whitelist-ops", boost::program_options::value< std::vector<std::string> >()->composing(), "Defines a list of operations which will be explicitly logged.")
       ("account-history-rocksdb-blacklist-ops", boost::program_options::value< std::vector<std::string> >()->composing(), "Defines a list of operations which will be explicitly ignored.")
+      ("account-history-rocksdb-prune", bpo::value<bool>()->default_value(false), "Drop history entries older than 30 days from accounts having more than 30 newer entries. Pruning is done by RocksDB compactions in background.")
 
    ;
    command_line_options.add_options()
@@ -1451,6 +2183,8 @@ void account_history_rocksdb_plugin::set_program_options(
          "Allows to force immediate data import at plugin startup. By default storage is supplied during reindex process.")
       ("account-history-rocksdb-stop-import-at-block", bpo::value<uint32_t>()->default_value(0),
          "Allows to specify block number, the data import process should stop at.")
+      ("account-history-rocksdb-import-threads", bpo::value<uint32_t>()->default_value(0),
+         "Number of threads used by the immediate data import. 0 means one thread per CPU core, 1 imports sequentially.")
    ;
 }
 
@@ -1498,6 +2232,12 @@ void account_history_rocksdb_plugin::find_account_history_data(const account_nam
    _my->find_account_history_data(name, start, limit, processor);
 }
 
+void account_history_rocksdb_plugin::find_account_history_data(const account_name_type& name, uint64_t start, uint32_t limit,
+   const std::vector<uint32_t>& opTypes, std::function<void(unsigned int, const rocksdb_operation_object&)> processor) const
+{
+   _my->find_account_history_data(name, start, limit, opTypes, processor);
+}
+
 bool account_history_rocksdb_plugin::find_operation_object(size_t opId, rocksdb_operation_object* op) const
 {
    return _my->find_operation_object(opId, op);
@@ -1515,6 +2255,18 @@ uint32_t account_history_rocksdb_plugin::enum_operations_from_block_range(uint32
    return _my->enumVirtualOperationsFromBlockRange(blockRangeBegin, blockRangeEnd, processor);
 }
 
+uint32_t account_history_rocksdb_plugin::enum_virtual_operations(uint32_t blockRangeBegin, uint32_t blockRangeEnd,
+   uint64_t cursor, uint32_t limit, const std::vector<uint32_t>& opTypes,
+   std::function<void(const rocksdb_operation_object&)> processor, uint64_t* nextCursor) const
+{
+   return _my->enumVirtualOperations(blockRangeBegin, blockRangeEnd, cursor, limit, opTypes, processor, nextCursor);
+}
+
+void account_history_rocksdb_plugin::compact_account_history()
+{
+   _my->compactAccountHistory();
+}
+
 } } }
 
 FC_REFLECT( steem::plugins::account_history_rocksdb::account_history_info,
@@ -0,0 +1,565 @@
+#pragma once
+
+#include <steem/plugins/account_history_rocksdb/account_history_rocksdb_objects.hpp>
+
+#include <rocksdb/compaction_filter.h>
+#include <rocksdb/db.h>
+#include <rocksdb/merge_operator.h>
+#include <rocksdb/slice.h>
+
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** On-disk format of the account history kept by account_history_rocksdb_plugin: chunks of account history
+ *  entries, their merge operators and the compaction filter pruning them.
+ */
+
+#define ACCOUNT_HISTORY_LENGTH_LIMIT 30
+#define ACCOUNT_HISTORY_TIME_LIMIT   30
+/// Number of account history entries kept in a single value of the ah_operation_chunks column.
+#define AH_CHUNK_SIZE                256
+#define AH_CHUNK_BITMAP_SIZE         (AH_CHUNK_SIZE / 8)
+
+namespace steem { namespace plugins { namespace account_history_rocksdb {
+
+using ::rocksdb::ColumnFamilyHandle;
+using ::rocksdb::DB;
+using ::rocksdb::PinnableSlice;
+using ::rocksdb::ReadOptions;
+using ::rocksdb::Slice;
+
+
+template <class T>
+serialize_buffer_t dump(const T& obj)
+{
+   serialize_buffer_t serializedObj;
+   auto size = fc::raw::pack_size(obj);
+   serializedObj.resize(size);
+   fc::datastream<char*> ds(serializedObj.data(), size);
+   fc::raw::pack(ds, obj);
+   return serializedObj;
+}
+
+template <class T>
+void load(T& obj, const char* data, size_t size)
+{
+   fc::datastream<const char*> ds(data, size);
+   fc::raw::unpack(ds, obj);
+}
+
+template <class T>
+void load(T& obj, const serialize_buffer_t& source)
+{
+   load(obj, source.data(), source.size());
+}
+
+/** Helper class to simplify construction of Slice objects holding primitive type values.
+ *
+ */
+template <typename T>
+class PrimitiveTypeSlice final : public Slice
+{
+public:
+   explicit PrimitiveTypeSlice(T value) : _value(value)
+   {
+      data_ = reinterpret_cast<const char*>(&_value);
+      size_ = sizeof(T);
+   }
+
+   static const T& unpackSlice(const Slice& s)
+   {
+      assert(sizeof(T) == s.size());
+      return *reinterpret_cast<const T*>(s.data());
+   }
+
+   static const T& unpackSlice(const std::string& s)
+   {
+      assert(sizeof(T) == s.size());
+      return *reinterpret_cast<const T*>(s.data());
+   }
+
+private:
+   T _value;
+};
+
+/// Compares account_history_info::id and chunk number pair
+typedef std::pair< int64_t, uint32_t > ah_chunk_id_pair;
+
+typedef PrimitiveTypeSlice< int64_t > id_slice_t;
+typedef PrimitiveTypeSlice< ah_chunk_id_pair > ah_chunk_slice_t;
+
+/// Compares account_history_info::id and operation type pair, followed by the chunk number
+typedef std::pair< std::pair< int64_t, uint32_t >, uint32_t > ah_op_type_chunk_id;
+typedef PrimitiveTypeSlice< ah_op_type_chunk_id > ah_op_type_chunk_slice_t;
+
+inline void appendVarint(std::string* out, uint64_t value)
+{
+   while(value >= 0x80)
+   {
+      out->push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+   }
+   out->push_back(static_cast<char>(value));
+}
+
+inline bool readVarint(const char** data, const char* end, uint64_t* value)
+{
+   *value = 0;
+   for(unsigned int shift = 0; shift < 64 && *data < end; shift += 7)
+   {
+      uint64_t byte = static_cast<uint8_t>(*(*data)++);
+      *value |= (byte & 0x7F) << shift;
+      if((byte & 0x80) == 0)
+         return true;
+   }
+   return false;
+}
+
+/** Holds operation ids of AH_CHUNK_SIZE consecutive entries of a single account history. Stored value consists
+ *  of the entry count (uint16), id of the last operation (int64) and the operation ids in entry order as varints,
+ *  the first one as is and every next one as a delta to its predecessor (ids grow along with the entries).
+ *
+ *  Entries are appended by merge operands holding position of their first entry in the chunk (uint16) followed by
+ *  raw operation ids. Operands overlapping entries already present in the chunk contribute only the entries past
+ *  the overlap, so importing the same entries twice does not change the chunk. An operand which would leave a gap
+ *  (its chunk has been pruned meanwhile) is dropped.
+ */
+class account_history_chunk
+{
+public:
+   static const size_t HEADER_SIZE = sizeof(uint16_t) + sizeof(int64_t);
+
+   static std::string makeOperand(uint16_t firstPosition, const int64_t* opIds, size_t count)
+   {
+      std::string operand(sizeof(uint16_t) + count * sizeof(int64_t), '\0');
+      memcpy(&operand[0], &firstPosition, sizeof(uint16_t));
+      if(count != 0)
+         memcpy(&operand[sizeof(uint16_t)], opIds, count * sizeof(int64_t));
+      return operand;
+   }
+
+   static bool applyOperand(std::string* value, const Slice& operand)
+   {
+      uint16_t firstPosition = 0;
+      size_t opCount = 0;
+      if(unpackOperand(operand, &firstPosition, &opCount) == false)
+         return false;
+
+      uint16_t count = 0;
+      int64_t lastOpId = 0;
+
+      if(value->empty())
+         value->assign(HEADER_SIZE, '\0');
+      else if(unpackHeader(*value, &count, &lastOpId) == false)
+         return false;
+
+      if(firstPosition > count)
+         return true;
+
+      for(size_t i = count - firstPosition; i < opCount && count < AH_CHUNK_SIZE; ++i)
+      {
+         int64_t opId = 0;
+         memcpy(&opId, operand.data() + sizeof(uint16_t) + i * sizeof(int64_t), sizeof(int64_t));
+
+         if(count == 0)
+         {
+            appendVarint(value, opId);
+         }
+         else
+         {
+            if(opId <= lastOpId)
+               return false;
+            appendVarint(value, opId - lastOpId);
+         }
+
+         lastOpId = opId;
+         ++count;
+      }
+
+      memcpy(&(*value)[0], &count, sizeof(uint16_t));
+      memcpy(&(*value)[sizeof(uint16_t)], &lastOpId, sizeof(int64_t));
+      return true;
+   }
+
+   /// Joins two operands into one, fails if there is a gap between them.
+   static bool combineOperands(std::string* operand, const Slice& next)
+   {
+      uint16_t firstPosition = 0, nextPosition = 0;
+      size_t count = 0, nextCount = 0;
+      if(unpackOperand(*operand, &firstPosition, &count) == false || unpackOperand(next, &nextPosition, &nextCount) == false)
+         return false;
+
+      size_t end = firstPosition + count;
+      if(nextPosition > end)
+         return false;
+
+      size_t skip = end - nextPosition;
+      if(skip < nextCount)
+         operand->append(next.data() + sizeof(uint16_t) + skip * sizeof(int64_t), (nextCount - skip) * sizeof(int64_t));
+
+      return true;
+   }
+
+   static bool decode(const Slice& value, std::vector<int64_t>* opIds)
+   {
+      uint16_t count = 0;
+      int64_t lastOpId = 0;
+      if(unpackHeader(value, &count, &lastOpId) == false)
+         return false;
+
+      opIds->clear();
+      opIds->reserve(count);
+
+      const char* data = value.data() + HEADER_SIZE;
+      const char* end = value.data() + value.size();
+      int64_t opId = 0;
+
+      for(uint16_t i = 0; i < count; ++i)
+      {
+         uint64_t delta = 0;
+         if(readVarint(&data, end, &delta) == false)
+            return false;
+         opId = (i == 0) ? static_cast<int64_t>(delta) : opId + static_cast<int64_t>(delta);
+         opIds->push_back(opId);
+      }
+
+      return true;
+   }
+
+   static bool unpackHeader(const Slice& value, uint16_t* count, int64_t* lastOpId)
+   {
+      if(value.size() < HEADER_SIZE)
+         return false;
+
+      memcpy(count, value.data(), sizeof(uint16_t));
+      memcpy(lastOpId, value.data() + sizeof(uint16_t), sizeof(int64_t));
+      return true;
+   }
+
+   /// Reads id of the first operation of a chunk without decoding the rest of it.
+   static bool unpackFirstOpId(const Slice& value, int64_t* opId)
+   {
+      uint16_t count = 0;
+      int64_t lastOpId = 0;
+      if(unpackHeader(value, &count, &lastOpId) == false || count == 0)
+         return false;
+
+      const char* data = value.data() + HEADER_SIZE;
+      uint64_t firstOpId = 0;
+      if(readVarint(&data, value.data() + value.size(), &firstOpId) == false)
+         return false;
+
+      *opId = static_cast<int64_t>(firstOpId);
+      return true;
+   }
+
+private:
+   static bool unpackOperand(const Slice& operand, uint16_t* firstPosition, size_t* count)
+   {
+      if(operand.size() < sizeof(uint16_t) || (operand.size() - sizeof(uint16_t)) % sizeof(int64_t) != 0)
+         return false;
+
+      memcpy(firstPosition, operand.data(), sizeof(uint16_t));
+      *count = (operand.size() - sizeof(uint16_t)) / sizeof(int64_t);
+      return true;
+   }
+};
+
+class account_history_chunk_merge_operator final : public ::rocksdb::MergeOperator
+{
+public:
+   virtual bool FullMergeV2(const MergeOperationInput& merge_in, MergeOperationOutput* merge_out) const override
+   {
+      merge_out->new_value.clear();
+      if(merge_in.existing_value != nullptr)
+         merge_out->new_value.assign(merge_in.existing_value->data(), merge_in.existing_value->size());
+
+      for(const auto& operand : merge_in.operand_list)
+      {
+         if(account_history_chunk::applyOperand(&merge_out->new_value, operand) == false)
+            return false;
+      }
+
+      return true;
+   }
+
+   virtual bool PartialMergeMulti(const Slice& key, const std::deque<Slice>& operand_list, std::string* new_value,
+      ::rocksdb::Logger* logger) const override
+   {
+      new_value->assign(operand_list.front().data(), operand_list.front().size());
+
+      for(size_t i = 1; i < operand_list.size(); ++i)
+      {
+         if(account_history_chunk::combineOperands(new_value, operand_list[i]) == false)
+            return false;
+      }
+
+      return true;
+   }
+
+   virtual const char* Name() const override
+   {
+      return "account_history_chunk_merge_operator";
+   }
+};
+
+/** Marks entries of an account history chunk holding operations of a single type, one bit per entry position.
+ *  Bits are only ever set, so operands are merged by OR and can be applied in any order.
+ */
+class entry_bitmap_merge_operator final : public ::rocksdb::AssociativeMergeOperator
+{
+public:
+   static void set(std::string* bitmap, uint32_t position)
+   {
+      if(bitmap->empty())
+         bitmap->assign(AH_CHUNK_BITMAP_SIZE, '\0');
+      (*bitmap)[position / 8] |= 1 << (position % 8);
+   }
+
+   static bool isSet(const std::string& bitmap, uint32_t position)
+   {
+      return (bitmap[position / 8] >> (position % 8)) & 1;
+   }
+
+   virtual bool Merge(const Slice& key, const Slice* existing_value, const Slice& value, std::string* new_value,
+      ::rocksdb::Logger* logger) const override
+   {
+      if(value.size() != AH_CHUNK_BITMAP_SIZE ||
+         (existing_value != nullptr && existing_value->size() != AH_CHUNK_BITMAP_SIZE))
+         return false;
+
+      new_value->assign(value.data(), value.size());
+
+      if(existing_value != nullptr)
+      {
+         for(size_t i = 0; i < AH_CHUNK_BITMAP_SIZE; ++i)
+            (*new_value)[i] |= existing_value->data()[i];
+      }
+
+      return true;
+   }
+
+   virtual const char* Name() const override
+   {
+      return "entry_bitmap_merge_operator";
+   }
+};
+
+/** Data the pruning compaction filter needs from the import path: the newest entry of each account history
+ *  (indexed by account_history_info::id, which are assigned sequentially) and the time of the newest imported
+ *  operation. Updating it costs the import path a single store per account.
+ */
+class ah_retention_state
+{
+public:
+   void setNewestEntry(int64_t ahId, uint32_t entryId)
+   {
+      std::lock_guard<std::mutex> guard(_mtx);
+      if(static_cast<size_t>(ahId) >= _newestEntryIds.size())
+         _newestEntryIds.resize(std::max<size_t>(ahId + 1, _newestEntryIds.size() * 2), 0);
+      _newestEntryIds[ahId] = entryId;
+   }
+
+   bool getNewestEntry(int64_t ahId, uint32_t* entryId) const
+   {
+      std::lock_guard<std::mutex> guard(_mtx);
+      if(ahId < 0 || static_cast<size_t>(ahId) >= _newestEntryIds.size())
+         return false;
+      *entryId = _newestEntryIds[ahId];
+      return true;
+   }
+
+   void setNewestTimestamp(const fc::time_point_sec& timestamp)
+   {
+      _newestTimestamp.store(timestamp.sec_since_epoch(), std::memory_order_relaxed);
+   }
+
+   fc::time_point_sec getNewestTimestamp() const
+   {
+      return fc::time_point_sec(_newestTimestamp.load(std::memory_order_relaxed));
+   }
+
+   void attach(DB* storage, ColumnFamilyHandle* operationById, ColumnFamilyHandle* ahChunks)
+   {
+      _operationById.store(operationById);
+      _ahChunks.store(ahChunks);
+      _storage.store(storage);
+   }
+
+   void detach()
+   {
+      _storage.store(nullptr);
+      _operationById.store(nullptr);
+      _ahChunks.store(nullptr);
+      std::lock_guard<std::mutex> guard(_mtx);
+      _newestEntryIds.clear();
+   }
+
+   /// Returns true if given operation is known to be older than ACCOUNT_HISTORY_TIME_LIMIT.
+   bool isOperationTooOld(int64_t opId) const
+   {
+      auto newest = getNewestTimestamp();
+      DB* storage = _storage.load();
+      ColumnFamilyHandle* column = _operationById.load();
+
+      if(newest == fc::time_point_sec() || storage == nullptr || column == nullptr)
+         return false;
+
+      id_slice_t idSlice(opId);
+      PinnableSlice buffer;
+      auto s = storage->Get(ReadOptions(), column, idSlice, &buffer);
+      if(s.ok() == false)
+         return false;
+
+      rocksdb_operation_object op;
+      load(op, buffer.data(), buffer.size());
+
+      return newest - op.timestamp > fc::days(ACCOUNT_HISTORY_TIME_LIMIT);
+   }
+
+   /** Returns true if entries of given account history chunk are known to be older than ACCOUNT_HISTORY_TIME_LIMIT.
+    *  A stored chunk counts only when full and is judged by its last operation, like ah_prune_filter does. A chunk
+    *  missing while a newer one of the same account history is stored has been pruned, and the first operation of
+    *  that newer chunk bounds the age of its entries. A chunk with no newer one may be yet to be written, so it is
+    *  never reported.
+    */
+   bool isChunkTooOld(int64_t ahId, uint32_t chunkNo) const
+   {
+      DB* storage = _storage.load();
+      ColumnFamilyHandle* column = _ahChunks.load();
+
+      if(storage == nullptr || column == nullptr)
+         return false;
+
+      std::unique_ptr<::rocksdb::Iterator> it(storage->NewIterator(ReadOptions(), column));
+      it->Seek(ah_chunk_slice_t(std::make_pair(ahId, chunkNo)));
+      if(it->Valid() == false || it->key().size() != sizeof(ah_chunk_id_pair))
+         return false;
+
+      const auto& found = ah_chunk_slice_t::unpackSlice(it->key());
+      if(found.first != ahId)
+         return false;
+
+      uint16_t count = 0;
+      int64_t opId = 0;
+
+      if(found.second == chunkNo)
+      {
+         if(account_history_chunk::unpackHeader(it->value(), &count, &opId) == false || count != AH_CHUNK_SIZE)
+            return false;
+      }
+      else if(account_history_chunk::unpackFirstOpId(it->value(), &opId) == false)
+      {
+         return false;
+      }
+
+      return isOperationTooOld(opId);
+   }
+
+private:
+   mutable std::mutex                   _mtx;
+   std::vector<uint32_t>                _newestEntryIds;
+   std::atomic<uint32_t>                _newestTimestamp = { 0 };
+   std::atomic<DB*>                     _storage = { nullptr };
+   std::atomic<ColumnFamilyHandle*>     _operationById = { nullptr };
+   std::atomic<ColumnFamilyHandle*>     _ahChunks = { nullptr };
+};
+
+/** Drops full ah_operation_chunks values whose last entry has more than ACCOUNT_HISTORY_LENGTH_LIMIT newer
+ *  entries in the same account history and points to an operation older than ACCOUNT_HISTORY_TIME_LIMIT.
+ *  Only full chunks are dropped, since a partial one can still receive merge operands continuing it.
+ *  Operation ids grow with time, so the filter remembers the bounds it already established during a compaction
+ *  and only loads operations falling between them.
+ */
+class ah_prune_filter final : public ::rocksdb::CompactionFilter
+{
+public:
+   explicit ah_prune_filter(const ah_retention_state& state) : _state(state) {}
+
+   virtual bool Filter(int level, const Slice& key, const Slice& existing_value, std::string* new_value,
+      bool* value_changed) const override
+   {
+      uint16_t count = 0;
+      int64_t opId = 0;
+      if(key.size() != sizeof(ah_chunk_id_pair) ||
+         account_history_chunk::unpackHeader(existing_value, &count, &opId) == false || count != AH_CHUNK_SIZE)
+         return false;
+
+      const auto& chunk = ah_chunk_slice_t::unpackSlice(key);
+      uint64_t lastEntryId = static_cast<uint64_t>(chunk.second) * AH_CHUNK_SIZE + count - 1;
+
+      uint32_t newestEntryId = 0;
+      if(_state.getNewestEntry(chunk.first, &newestEntryId) == false ||
+         lastEntryId + ACCOUNT_HISTORY_LENGTH_LIMIT > newestEntryId)
+         return false;
+
+      if(opId <= _newestOldOpId)
+         return true;
+
+      if(opId >= _oldestRecentOpId)
+         return false;
+
+      if(_state.isOperationTooOld(opId))
+      {
+         _newestOldOpId = opId;
+         return true;
+      }
+
+      _oldestRecentOpId = opId;
+      return false;
+   }
+
+   virtual const char* Name() const override
+   {
+      return "ah_prune_filter";
+   }
+
+private:
+   const ah_retention_state& _state;
+   mutable int64_t           _newestOldOpId = -1;
+   mutable int64_t           _oldestRecentOpId = std::numeric_limits<int64_t>::max();
+};
+
+/** Drops ah_op_type_chunks bitmaps by the rule ah_prune_filter applies to their chunks: the last entry of the
+ *  chunk has more than ACCOUNT_HISTORY_LENGTH_LIMIT newer entries and is older than ACCOUNT_HISTORY_TIME_LIMIT.
+ *  The age comes from the stored chunks (see ah_retention_state::isChunkTooOld), so a bitmap ingested ahead of
+ *  its chunk is kept.
+ */
+class ah_op_type_prune_filter final : public ::rocksdb::CompactionFilter
+{
+public:
+   explicit ah_op_type_prune_filter(const ah_retention_state& state) : _state(state) {}
+
+   virtual bool Filter(int level, const Slice& key, const Slice& existing_value, std::string* new_value,
+      bool* value_changed) const override
+   {
+      if(key.size() != sizeof(ah_op_type_chunk_id))
+         return false;
+
+      const auto& chunk = ah_op_type_chunk_slice_t::unpackSlice(key);
+      uint64_t lastEntryId = (static_cast<uint64_t>(chunk.second) + 1) * AH_CHUNK_SIZE - 1;
+
+      uint32_t newestEntryId = 0;
+      if(_state.getNewestEntry(chunk.first.first, &newestEntryId) == false ||
+         lastEntryId + ACCOUNT_HISTORY_LENGTH_LIMIT > newestEntryId)
+         return false;
+
+      return _state.isChunkTooOld(chunk.first.first, chunk.second);
+   }
+
+   virtual const char* Name() const override
+   {
+      return "ah_op_type_prune_filter";
+   }
+
+private:
+   const ah_retention_state& _state;
+};
+
+} } } // steem::plugins::account_history_rocksdb
@@ -8,6 +8,7 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 
 namespace steem {
 
@@ -38,11 +39,29 @@ public:
 
    void find_account_history_data(const protocol::account_name_type& name, uint64_t start, uint32_t limit,
       std::function<void(unsigned int, const rocksdb_operation_object&)> processor) const;
+   /** Returns at most `limit' newest entries not exceeding `start' which hold operations of given types
+    *  (indexes within protocol::operation).
+    */
+   void find_account_history_data(const protocol::account_name_type& name, uint64_t start, uint32_t limit,
+      const std::vector<uint32_t>& opTypes,
+      std::function<void(unsigned int, const rocksdb_operation_object&)> processor) const;
    bool find_operation_object(size_t opId, rocksdb_operation_object* data) const;
    void find_operations_by_block(size_t blockNum,
       std::function<void(const rocksdb_operation_object&)> processor) const;
    uint32_t enum_operations_from_block_range(uint32_t blockRangeBegin, uint32_t blockRangeEnd,
       std::function<void(const rocksdb_operation_object&)> processor) const;
+   /** Pages over virtual operations of the [blockRangeBegin, blockRangeEnd) range, reading only the virtual ones.
+    *  `cursor' is 0 or a value returned in `nextCursor' by the previous call ((block << 32) | index of the virtual
+    *  operation within the block), `limit' of 0 means no limit and empty `opTypes' selects all types.
+    *  `nextCursor' is set to 0 once the range is done. Returns the first block holding virtual operations past
+    *  the returned ones.
+    */
+   uint32_t enum_virtual_operations(uint32_t blockRangeBegin, uint32_t blockRangeEnd, uint64_t cursor, uint32_t limit,
+      const std::vector<uint32_t>& opTypes, std::function<void(const rocksdb_operation_object&)> processor,
+      uint64_t* nextCursor) const;
+   /// Compacts account history chunks and their type bitmaps right away, so pruning does not have to wait for
+   /// background compactions.
+   void compact_account_history();
 
 private:
    class impl;
@@ -7,6 +7,27 @@ namespace steem { namespace plugins { namespace account_history {
 
 namespace detail {
 
+/// Returns types of operations selected by the filter arguments, empty if no filter has been given.
+std::vector< uint32_t > get_filtered_operation_types( const fc::optional< uint64_t >& filter_low,
+   const fc::optional< uint64_t >& filter_high )
+{
+   std::vector< uint32_t > result;
+
+   if( filter_low.valid() == false && filter_high.valid() == false )
+      return result;
+
+   uint64_t masks[] = { filter_low.valid() ? *filter_low : 0, filter_high.valid() ? *filter_high : 0 };
+
+   for( uint32_t i = 0; i < 2; ++i )
+      for( uint32_t bit = 0; bit < 64; ++bit )
+         if( masks[ i ] & ( uint64_t( 1 ) << bit ) )
+            result.push_back( i * 64 + bit );
+
+   FC_ASSERT( result.empty() == false, "operation filter does not select any operation" );
+
+   return result;
+}
+
 class abstract_account_history_api_impl
 {
    public:
@@ -89,6 +110,9 @@ DEFINE_API_IMPL( account_history_api_chainbase_impl, get_account_history )
 {
    FC_ASSERT( args.limit <= 10000, "limit of ${l} is greater than maxmimum allowed", ("l",args.limit) );
    FC_ASSERT( args.start >= args.limit, "start must be greater than limit" );
+   /// Chainbase history has no type index, a filter would have to scan the whole history under the read lock.
+   FC_ASSERT( args.operation_filter_low.valid() == false && args.operation_filter_high.valid() == false,
+      "Operation filter is not supported for account history backed by Chainbase" );
 
    return _db.with_read_lock( [&]()
    {
@@ -154,12 +178,17 @@ DEFINE_API_IMPL( account_history_api_rocksdb_impl, get_account_history )
    FC_ASSERT( args.start >= args.limit, "start must be greater than limit" );
 
    get_account_history_return result;
+   auto op_types = get_filtered_operation_types( args.operation_filter_low, args.operation_filter_high );
 
-   _dataSource.find_account_history_data(args.account, args.start, args.limit,
-      [&result](unsigned int sequence, const account_history_rocksdb::rocksdb_operation_object& op)
+   auto processor = [&result](unsigned int sequence, const account_history_rocksdb::rocksdb_operation_object& op)
       {
          result.history[sequence] = api_operation_object( op );
-      });
+      };
+
+   if( op_types.empty() )
+      _dataSource.find_account_history_data(args.account, args.start, args.limit, processor);
+   else
+      _dataSource.find_account_history_data(args.account, args.start, args.limit, op_types, processor);
 
    return result;
 }
@@ -171,14 +200,19 @@ DEFINE_API_IMPL( account_history_api_rocksdb_impl, get_transaction )
 
 DEFINE_API_IMPL( account_history_api_rocksdb_impl, enum_virtual_ops)
 {
+   FC_ASSERT( args.limit.valid() == false || *args.limit > 0, "limit must be greater than 0" );
+
    enum_virtual_ops_return result;
+   auto op_types = get_filtered_operation_types( args.operation_filter_low, args.operation_filter_high );
 
-   result.next_block_range_begin = _dataSource.enum_operations_from_block_range(args.block_range_begin,
-      args.block_range_end,
+   result.next_block_range_begin = _dataSource.enum_virtual_operations(args.block_range_begin,
+      args.block_range_end, args.operation_begin.valid() ? *args.operation_begin : 0,
+      args.limit.valid() ? *args.limit : 0, op_types,
       [&result](const account_history_rocksdb::rocksdb_operation_object& op)
       {
          result.ops.emplace_back(api_operation_object(op));
-      }
+      },
+      &result.next_operation_begin
    );
 
    return result;
@@ -208,6 +242,13 @@ account_history_api::account_history_api()
    }
 
    JSON_RPC_REGISTER_API( STEEM_ACCOUNT_HISTORY_API_PLUGIN_NAME );
+
+   // Operations in irreversible blocks never change, their responses can be cached
+   appbase::app().get_plugin< steem::plugins::json_rpc::json_rpc_plugin >().add_immutable_api_method< get_ops_in_block_args >(
+      STEEM_ACCOUNT_HISTORY_API_PLUGIN_NAME, "get_ops_in_block", [this]( const get_ops_in_block_args& args )
+      {
+         return my->_db.with_read_lock( [&]() { return args.block_num <= my->_db.last_non_undoable_block_num(); } );
+      });
 }
 
 account_history_api::~account_history_api() {}
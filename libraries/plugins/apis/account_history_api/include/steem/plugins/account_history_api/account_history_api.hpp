@@ -64,11 +64,18 @@ struct get_transaction_args
 typedef steem::protocol::annotated_signed_transaction get_transaction_return;
 
 
+/** Allows to restrict returned history to some operation types.
+ *  \param operation_filter_low  - bit N selects operations of type N (index within protocol::operation)
+ *  \param operation_filter_high - bit N selects operations of type N + 64
+ *  When a filter is given, `limit' counts matching operations only. Filters need the RocksDB backed history.
+ */
 struct get_account_history_args
 {
    steem::protocol::account_name_type   account;
    uint64_t                               start = -1;
    uint32_t                               limit = 1000;
+   fc::optional< uint64_t >               operation_filter_low;
+   fc::optional< uint64_t >               operation_filter_high;
 };
 
 struct get_account_history_return
@@ -77,19 +84,29 @@ struct get_account_history_return
 };
 
 /** Allows to specify range of blocks to retrieve virtual operations for.
- *  \param block_range_begin - starting block number (inclusive) to search for virtual operations
- *  \param block_range_end   - last block number (exclusive) to search for virtual operations
+ *  \param block_range_begin     - starting block number (inclusive) to search for virtual operations
+ *  \param block_range_end       - last block number (exclusive) to search for virtual operations
+ *  \param operation_begin       - next_operation_begin returned by the previous call, to continue paging
+ *  \param limit                 - maximum number of returned operations
+ *  \param operation_filter_low  - same as in get_account_history_args
+ *  \param operation_filter_high - same as in get_account_history_args
  */
 struct enum_virtual_ops_args
 {
-   uint32_t block_range_begin = 1;
-   uint32_t block_range_end = 2;
+   uint32_t                 block_range_begin = 1;
+   uint32_t                 block_range_end = 2;
+   fc::optional< uint64_t > operation_begin;
+   fc::optional< uint32_t > limit;
+   fc::optional< uint64_t > operation_filter_low;
+   fc::optional< uint64_t > operation_filter_high;
 };
 
+/// next_operation_begin is nonzero if `limit' has been reached before the end of the block range.
 struct enum_virtual_ops_return
 {
    vector<api_operation_object> ops;
    uint32_t                     next_block_range_begin = 0;
+   uint64_t                     next_operation_begin = 0;
 };
 
 
@@ -125,13 +142,13 @@ FC_REFLECT( steem::plugins::account_history::get_transaction_args,
    (id) )
 
 FC_REFLECT( steem::plugins::account_history::get_account_history_args,
-   (account)(start)(limit) )
+   (account)(start)(limit)(operation_filter_low)(operation_filter_high) )
 
 FC_REFLECT( steem::plugins::account_history::get_account_history_return,
    (history) )
 
 FC_REFLECT( steem::plugins::account_history::enum_virtual_ops_args,
-   (block_range_begin)(block_range_end) )
+   (block_range_begin)(block_range_end)(operation_begin)(limit)(operation_filter_low)(operation_filter_high) )
 
 FC_REFLECT( steem::plugins::account_history::enum_virtual_ops_return,
-   (ops)(next_block_range_begin) )
+   (ops)(next_block_range_begin)(next_operation_begin) )
@@ -19,6 +19,11 @@ class block_api_impl
          (get_block)
       )
 
+      bool is_irreversible( uint32_t block_num )
+      {
+         return _db.with_read_lock( [&]() { return block_num <= _db.last_non_undoable_block_num(); } );
+      }
+
       chain::database& _db;
 };
 
@@ -32,6 +37,13 @@ block_api::block_api()
    : my( new block_api_impl() )
 {
    JSON_RPC_REGISTER_API( STEEM_BLOCK_API_PLUGIN_NAME );
+
+   // Irreversible blocks never change, their responses can be cached
+   auto& json_rpc = appbase::app().get_plugin< steem::plugins::json_rpc::json_rpc_plugin >();
+   json_rpc.add_immutable_api_method< get_block_header_args >( STEEM_BLOCK_API_PLUGIN_NAME, "get_block_header",
+      [this]( const get_block_header_args& args ) { return my->is_irreversible( args.block_num ); } );
+   json_rpc.add_immutable_api_method< get_block_args >( STEEM_BLOCK_API_PLUGIN_NAME, "get_block",
+      [this]( const get_block_args& args ) { return my->is_irreversible( args.block_num ); } );
 }
 
 block_api::~block_api() {}
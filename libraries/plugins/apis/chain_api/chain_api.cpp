@@ -12,7 +12,8 @@ class chain_api_impl
 
       DECLARE_API_IMPL(
          (push_block)
-         (push_transaction) )
+         (push_transaction)
+         (get_apply_latency) )
 
    private:
       chain_plugin& _chain;
@@ -72,6 +73,30 @@ DEFINE_API_IMPL( chain_api_impl, push_transaction )
    return result;
 }
 
+DEFINE_API_IMPL( chain_api_impl, get_apply_latency )
+{
+   get_apply_latency_return result;
+   auto& tracker = _chain.db().get_apply_latency_tracker();
+
+   tracker.for_each_operation( [&]( steem::chain::util::apply_latency_tracker::entry& e )
+   {
+      auto summary = e.histogram.summarize();
+      if( summary.count )
+         result.operations.push_back( { e.name, summary } );
+   });
+
+   tracker.for_each_handler( [&]( steem::chain::util::apply_latency_tracker::entry& e )
+   {
+      auto summary = e.histogram.summarize();
+      if( summary.count )
+         result.handlers.push_back( { e.name, summary } );
+   });
+
+   result.change_stream_backlog = _chain.async_block_backlog();
+
+   return result;
+}
+
 } // detail
 
 chain_api::chain_api(): my( new detail::chain_api_impl() )
@@ -84,6 +109,7 @@ chain_api::~chain_api() {}
 DEFINE_LOCKLESS_APIS( chain_api,
    (push_block)
    (push_transaction)
+   (get_apply_latency)
 )
 
 } } } //steem::plugins::chain
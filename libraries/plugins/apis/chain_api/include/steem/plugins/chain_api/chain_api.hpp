@@ -3,6 +3,8 @@
 
 #include <steem/protocol/types.hpp>
 
+#include <steem/chain/util/latency_histogram.hpp>
+
 #include <fc/optional.hpp>
 
 namespace steem { namespace plugins { namespace chain {
@@ -30,6 +32,22 @@ struct push_transaction_return
    optional<string>  error;
 };
 
+typedef json_rpc::void_type get_apply_latency_args;
+
+/// Latencies in microseconds, accumulated since the node started
+struct apply_latency_entry
+{
+   string                                 name;
+   steem::chain::util::latency_summary    latency;
+};
+
+struct get_apply_latency_return
+{
+   vector< apply_latency_entry > operations;  ///< Evaluator time per operation type
+   vector< apply_latency_entry > handlers;    ///< Time per plugin signal handler and change stream consumer
+   uint32_t                      change_stream_backlog = 0;
+};
+
 
 class chain_api
 {
@@ -39,8 +57,9 @@ class chain_api
 
       DECLARE_API(
          (push_block)
-         (push_transaction) )
-      
+         (push_transaction)
+         (get_apply_latency) )
+
    private:
       std::unique_ptr< detail::chain_api_impl > my;
 };
@@ -50,3 +69,5 @@ class chain_api
 FC_REFLECT( steem::plugins::chain::push_block_args, (block)(currently_syncing) )
 FC_REFLECT( steem::plugins::chain::push_block_return, (success)(error) )
 FC_REFLECT( steem::plugins::chain::push_transaction_return, (success)(error) )
+FC_REFLECT( steem::plugins::chain::apply_latency_entry, (name)(latency) )
+FC_REFLECT( steem::plugins::chain::get_apply_latency_return, (operations)(handlers)(change_stream_backlog) )
@@ -2185,6 +2185,36 @@ condenser_api::condenser_api()
    : my( new detail::condenser_api_impl() )
 {
    JSON_RPC_REGISTER_API( STEEM_CONDENSER_API_PLUGIN_NAME );
+
+   // Irreversible blocks and their operations never change, their responses can be cached
+   auto& json_rpc = appbase::app().get_plugin< steem::plugins::json_rpc::json_rpc_plugin >();
+   auto block_is_irreversible = [this]( uint32_t block_num )
+   {
+      return my->_db.with_read_lock( [&]() { return block_num <= my->_db.last_non_undoable_block_num(); } );
+   };
+
+   // Positional args are normalized through typed containers, i.e. [ "1000" ] and [1000] share an entry
+   auto block_arg_is_irreversible = [block_is_irreversible]( const vector< uint32_t >& args )
+   {
+      return args.size() == 1 && block_is_irreversible( args[0] );
+   };
+
+   json_rpc.add_immutable_api_method< vector< uint32_t > >( STEEM_CONDENSER_API_PLUGIN_NAME, "get_block_header", block_arg_is_irreversible );
+   json_rpc.add_immutable_api_method< vector< uint32_t > >( STEEM_CONDENSER_API_PLUGIN_NAME, "get_block", block_arg_is_irreversible );
+   json_rpc.add_immutable_api_method( STEEM_CONDENSER_API_PLUGIN_NAME, "get_ops_in_block",
+      [block_is_irreversible]( const fc::variant& v, string& normalized_args )
+      {
+         const fc::variants& args = v.get_array();
+         if( args.size() != 2 )
+            return false;
+
+         auto typed_args = std::make_pair( args[0].as< uint32_t >(), args[1].as< bool >() );
+         if( !block_is_irreversible( typed_args.first ) )
+            return false;
+
+         normalized_args = fc::json::to_string( fc::variant( typed_args ) );
+         return true;
+      });
 }
 
 condenser_api::~condenser_api() {}
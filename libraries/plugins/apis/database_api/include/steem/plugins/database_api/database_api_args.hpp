@@ -882,3 +882,26 @@ FC_REFLECT( steem::plugins::database_api::find_smt_token_balances_args,
 FC_REFLECT( steem::plugins::database_api::find_smt_token_balances_return,
    (balances) )
 
+// Pages of up to DATABASE_API_SINGLE_QUERY_LIMIT objects are written out an object at a time
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_witnesses_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_witness_votes_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_accounts_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_owner_histories_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_account_recovery_requests_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_change_recovery_account_requests_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_escrows_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_withdraw_vesting_routes_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_savings_withdrawals_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_vesting_delegations_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_vesting_delegation_expirations_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_sbd_conversion_requests_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_decline_voting_rights_requests_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_comments_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_votes_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_limit_orders_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_proposals_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_proposal_votes_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_smt_contributions_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_smt_tokens_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::list_smt_token_emissions_return )
+JSON_RPC_STREAMED_RESULT( steem::plugins::database_api::find_smt_token_balances_return )
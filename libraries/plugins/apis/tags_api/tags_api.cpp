@@ -60,6 +60,13 @@ class tags_api_impl
                                                bool ignore_parent = false
                                                );
 
+      bool get_feed_discussions( const discussion_query& q,
+                                 const string& tag,
+                                 chain::comment_id_type parent,
+                                 tags::tag_feed_type type,
+                                 const std::function< bool( const database_api::api_comment_object& ) >& filter,
+                                 discussion_query_result& result );
+
       chain::comment_id_type get_parent( const discussion_query& q );
 
       chain::database& _db;
@@ -174,6 +181,10 @@ DEFINE_API_IMPL( tags_api_impl, get_discussions_by_trending )
    auto tag = fc::to_lower( args.tag );
    auto parent = get_parent( args );
 
+   discussion_query_result result;
+   if( get_feed_discussions( args, tag, parent, tags::trending_feed, []( const database_api::api_comment_object& c ) { return c.net_rshares <= 0; }, result ) )
+      return result;
+
    const auto& tidx = _db.get_index< tags::tag_index, tags::by_parent_trending >();
    auto tidx_itr = tidx.lower_bound( boost::make_tuple( tag, parent, std::numeric_limits< double >::max() )  );
 
@@ -186,6 +197,10 @@ DEFINE_API_IMPL( tags_api_impl, get_discussions_by_created )
    auto tag = fc::to_lower( args.tag );
    auto parent = get_parent( args );
 
+   discussion_query_result result;
+   if( get_feed_discussions( args, tag, parent, tags::created_feed, filter_default, result ) )
+      return result;
+
    const auto& tidx = _db.get_index< tags::tag_index, tags::by_parent_created >();
    auto tidx_itr = tidx.lower_bound( boost::make_tuple( tag, parent, fc::time_point_sec::maximum() )  );
 
@@ -248,6 +263,10 @@ DEFINE_API_IMPL( tags_api_impl, get_discussions_by_hot )
    auto tag = fc::to_lower( args.tag );
    auto parent = get_parent( args );
 
+   discussion_query_result result;
+   if( get_feed_discussions( args, tag, parent, tags::hot_feed, []( const database_api::api_comment_object& c ) { return c.net_rshares <= 0; }, result ) )
+      return result;
+
    const auto& tidx = _db.get_index< tags::tag_index, tags::by_parent_hot >();
    auto tidx_itr = tidx.lower_bound( boost::make_tuple( tag, parent, std::numeric_limits< double >::max() )  );
 
@@ -420,6 +439,10 @@ DEFINE_API_IMPL( tags_api_impl, get_discussions_by_promoted )
    auto tag = fc::to_lower( args.tag );
    auto parent = get_parent( args );
 
+   discussion_query_result result;
+   if( get_feed_discussions( args, tag, parent, tags::promoted_feed, filter_default, result ) )
+      return result;
+
    const auto& tidx = _db.get_index< tags::tag_index, tags::by_parent_promoted >();
    auto tidx_itr = tidx.lower_bound( boost::make_tuple( tag, parent, share_type( STEEM_MAX_SHARE_SUPPLY ) )  );
 
@@ -696,6 +719,75 @@ discussion_query_result tags_api_impl::get_discussions( const discussion_query&
    return result;
 }
 
+/**
+ *  Serves a query from the precomputed tag feed when the requested page lies within it. Returns
+ *  false when the caller has to walk the index instead.
+ */
+bool tags_api_impl::get_feed_discussions( const discussion_query& query,
+                                          const string& tag,
+                                          chain::comment_id_type parent,
+                                          tags::tag_feed_type type,
+                                          const std::function< bool( const database_api::api_comment_object& ) >& filter,
+                                          discussion_query_result& result )
+{
+   if( parent != chain::comment_id_type() )
+      return false;
+
+   const auto* feed = _db.find< tags::tag_feed_object, tags::by_tag_type >( boost::make_tuple( tags::tag_name_type( tag ), type ) );
+   if( feed == nullptr )
+      return false;
+
+   size_t offset = 0;
+   if( query.start_author && query.start_permlink )
+   {
+      auto start = _db.get_comment( *query.start_author, *query.start_permlink ).id;
+      auto itr = std::find( feed->comments.begin(), feed->comments.end(), start );
+      if( itr == feed->comments.end() )
+         return false;
+      offset = itr - feed->comments.begin();
+   }
+
+   if( !feed->complete && offset + query.limit > feed->comments.size() )
+      return false;
+
+   const auto& comment_idx = _db.get_index< tags::tag_index, tags::by_comment >();
+
+   try
+   {
+      result.discussions.reserve( std::min< size_t >( query.limit, feed->comments.size() - offset ) );
+
+      for( auto itr = feed->comments.begin() + offset; itr != feed->comments.end() && result.discussions.size() < query.limit; ++itr )
+      {
+         // Promoted comes from the tag_object, as in the index walk
+         auto tag_itr = comment_idx.lower_bound( *itr );
+         while( tag_itr != comment_idx.end() && tag_itr->comment == *itr && tag_itr->tag != feed->tag )
+            ++tag_itr;
+
+         if( tag_itr == comment_idx.end() || tag_itr->comment != *itr )
+         {
+            result.discussions.clear();
+            return false;
+         }
+
+         result.discussions.push_back( lookup_discussion( *itr, query.truncate_body ) );
+         result.discussions.back().promoted = asset( tag_itr->promoted_balance, SBD_SYMBOL );
+
+         if( filter( result.discussions.back() ) )
+         {
+            result.discussions.clear();
+            return false;
+         }
+      }
+   }
+   catch( const fc::exception& e )
+   {
+      result.discussions.clear();
+      return false;
+   }
+
+   return true;
+}
+
 chain::comment_id_type tags_api_impl::get_parent( const discussion_query& query )
 {
    chain::comment_id_type parent;
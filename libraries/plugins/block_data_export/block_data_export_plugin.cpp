@@ -5,6 +5,7 @@
 #define BOOST_THREAD_USES_MOVE
 
 #include <steem/plugins/block_data_export/block_data_export_plugin.hpp>
+#include <steem/plugins/block_data_export/binary_export_format.hpp>
 #include <steem/plugins/block_data_export/exportable_block_data.hpp>
 
 #include <steem/chain/account_object.hpp>
@@ -50,11 +51,12 @@ FC_REFLECT( steem::plugins::block_data_export::detail::api_export_data_object, (
 
 namespace steem { namespace plugins { namespace block_data_export { namespace detail {
 
+/// Carries export data of a block to a conversion thread and its JSON line or binary record to the output thread.
 struct work_item
 {
    std::shared_ptr< api_export_data_object >          edo;
-   boost::promise< std::shared_ptr< std::string > >   edo_json_promise;
-   boost::future< std::shared_ptr< std::string > >    edo_json_future = edo_json_promise.get_future();
+   boost::promise< std::shared_ptr< std::string > >   edo_data_promise;
+   boost::future< std::shared_ptr< std::string > >    edo_data_future = edo_data_promise.get_future();
 };
 
 class block_data_export_plugin_impl
@@ -76,9 +78,13 @@ class block_data_export_plugin_impl
 
       void start_threads();
       void stop_threads();
-      void convert_to_json_thread_main();
+      void conversion_thread_main();
       void output_thread_main();
 
+      void init_binary_schema();
+      void write_binary_header( std::ostream& output );
+      std::shared_ptr< std::string > to_binary_record( const api_export_data_object& edo )const;
+
       database&                     _db;
       block_data_export_plugin&     _self;
       boost::signals2::connection   _pre_apply_block_conn;
@@ -92,6 +98,15 @@ class block_data_export_plugin_impl
       std::string                   _output_name;
       bool                          _enabled = false;
 
+      bool                          _binary = false;
+      /// Export types still written as JSON within the binary format
+      flat_set< std::string >       _json_types;
+      binary_export_header          _binary_header;
+      flat_map< std::string, uint32_t >
+                                    _binary_type_index;
+      /// Set by the output thread, read once it has been joined
+      bool                          _binary_header_written = false;
+
       size_t                        _max_queue_size = 100;
       boost::concurrent::sync_bounded_queue< std::shared_ptr< work_item > >    _data_queue;
       boost::concurrent::sync_bounded_queue< std::shared_ptr< work_item > >    _output_queue;
@@ -99,7 +114,7 @@ class block_data_export_plugin_impl
       size_t                        _thread_stack_size = 4096*1024;
       std::shared_ptr< boost::thread >                      _output_thread;
 
-      std::vector< boost::thread >  _json_conversion_threads;
+      std::vector< boost::thread >  _conversion_threads;
 };
 
 void block_data_export_plugin_impl::start_threads()
@@ -110,7 +125,7 @@ void block_data_export_plugin_impl::start_threads()
    size_t num_threads = boost::thread::hardware_concurrency()+1;
    for( size_t i=0; i<num_threads; i++ )
    {
-      _json_conversion_threads.emplace_back( attrs, [this]() { convert_to_json_thread_main(); } );
+      _conversion_threads.emplace_back( attrs, [this]() { conversion_thread_main(); } );
    }
 
    _output_thread = std::make_shared< boost::thread >( attrs, [this]() { output_thread_main(); } );
@@ -130,13 +145,23 @@ void block_data_export_plugin_impl::stop_threads()
    _output_thread->join();
    _output_thread.reset();
 
+   // An export without any block still gets its header, so that it reads as empty rather than broken
+   if( _binary && !_binary_header_written )
+   {
+      if( _binary_header.types.empty() )
+         init_binary_schema();
+
+      std::ofstream output_file( _output_name, std::ios::binary | std::ios::app );
+      write_binary_header( output_file );
+   }
+
    _data_queue.close();
-   for( boost::thread& t : _json_conversion_threads )
+   for( boost::thread& t : _conversion_threads )
       t.join();
-   _json_conversion_threads.clear();
+   _conversion_threads.clear();
 }
 
-void block_data_export_plugin_impl::convert_to_json_thread_main()
+void block_data_export_plugin_impl::conversion_thread_main()
 {
    while( true )
    {
@@ -151,11 +176,78 @@ void block_data_export_plugin_impl::convert_to_json_thread_main()
       }
 
       // TODO exception handling
-      std::shared_ptr< std::string > edo_json = std::make_shared< std::string >( fc::json::to_string( work->edo ) );
-      work->edo_json_promise.set_value( edo_json );
+      std::shared_ptr< std::string > edo_data;
+      if( _binary )
+         edo_data = to_binary_record( *work->edo );
+      else
+         edo_data = std::make_shared< std::string >( fc::json::to_string( work->edo ) );
+      work->edo_data_promise.set_value( edo_data );
    }
 }
 
+/**
+ * Export types are known only once all plugins have registered their factories, so the schema is built when
+ * the first block is exported, before any work is queued (or at shutdown if no block has been exported).
+ */
+void block_data_export_plugin_impl::init_binary_schema()
+{
+   for( const auto& fact : _factory_list )
+   {
+      if( _binary_type_index.count( fact.first ) )
+         continue;
+
+      binary_export_type type;
+      type.name = fact.first;
+      type.type_name = fact.second()->binary_type_name();
+      type.encoding = _json_types.count( fact.first ) ? json_encoding : raw_encoding;
+
+      _binary_type_index[ fact.first ] = _binary_header.types.size();
+      _binary_header.types.push_back( type );
+   }
+}
+
+void block_data_export_plugin_impl::write_binary_header( std::ostream& output )
+{
+   std::string header;
+   append_sized_object( header, _binary_header );
+   output.write( header.c_str(), header.length() );
+   _binary_header_written = true;
+}
+
+std::shared_ptr< std::string > block_data_export_plugin_impl::to_binary_record( const api_export_data_object& edo )const
+{
+   binary_export_record record;
+   record.block_id = edo.block_id;
+   record.previous = edo.previous;
+   record.entries.reserve( edo.export_data.size() );
+
+   for( const auto& entry : edo.export_data )
+   {
+      auto itr = _binary_type_index.find( entry.first );
+      FC_ASSERT( itr != _binary_type_index.end(), "Export data ${n} registered after the export has started", ("n", entry.first) );
+
+      record.entries.emplace_back();
+      binary_export_entry& exported = record.entries.back();
+      exported.type = itr->second;
+
+      if( _binary_header.types[ itr->second ].encoding == json_encoding )
+      {
+         fc::variant v;
+         entry.second->to_variant( v );
+         std::string json = fc::json::to_string( v );
+         exported.data.assign( json.begin(), json.end() );
+      }
+      else
+      {
+         entry.second->to_binary( exported.data );
+      }
+   }
+
+   std::shared_ptr< std::string > result = std::make_shared< std::string >();
+   append_sized_object( *result, record );
+   return result;
+}
+
 void block_data_export_plugin_impl::output_thread_main()
 {
    std::ofstream output_file( _output_name, std::ios::binary );
@@ -171,10 +263,20 @@ void block_data_export_plugin_impl::output_thread_main()
          break;
       }
 
-      std::shared_ptr< std::string > edo_json = work->edo_json_future.get();
+      std::shared_ptr< std::string > edo_data = work->edo_data_future.get();
 
-      output_file.write( edo_json->c_str(), edo_json->length() );
-      output_file.put( '\n' );
+      if( _binary )
+      {
+         if( !_binary_header_written )
+            write_binary_header( output_file );
+
+         output_file.write( edo_data->c_str(), edo_data->length() );
+      }
+      else
+      {
+         output_file.write( edo_data->c_str(), edo_data->length() );
+         output_file.put( '\n' );
+      }
       output_file.flush();
    }
 }
@@ -200,6 +302,9 @@ void block_data_export_plugin_impl::create_export_data( const block_id_type& pre
    {
       _edo->export_data.emplace( fact.first, fact.second() );
    }
+
+   if( _binary && _binary_header.types.empty() )
+      init_binary_schema();
 }
 
 void block_data_export_plugin_impl::send_export_data()
@@ -265,6 +370,8 @@ void block_data_export_plugin::set_program_options( options_description& cli, op
 {
    cfg.add_options()
          ("block-data-export-file", boost::program_options::value< string >()->default_value("NONE"), "Where to export data (NONE to discard)")
+         ("block-data-export-format", boost::program_options::value< string >()->default_value("json"), "Format of exported data: json (one object per line) or binary (size prefixed fc::raw records)")
+         ("block-data-export-json-types", boost::program_options::value< vector< string > >()->composing(), "Export data types kept as JSON within the binary format")
          ;
 }
 
@@ -280,6 +387,16 @@ void block_data_export_plugin::plugin_initialize( const boost::program_options::
       if( !my->_enabled )
          return;
 
+      const std::string& format = options.at( "block-data-export-format" ).as< string >();
+      FC_ASSERT( format == "json" || format == "binary", "Unknown block-data-export-format ${f}", ("f", format) );
+      my->_binary = (format == "binary");
+
+      if( options.count( "block-data-export-json-types" ) )
+      {
+         for( const std::string& type : options.at( "block-data-export-json-types" ).as< vector< string > >() )
+            my->_json_types.insert( type );
+      }
+
       my->_pre_apply_block_conn = my->_db.add_pre_apply_block_handler(
          [&]( const block_notification& note ){ my->on_pre_apply_block( note ); }, *this, -9300 );
       my->_post_apply_block_conn = my->_db.add_post_apply_block_handler(
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <steem/protocol/types.hpp>
+
+#include <fc/crypto/hex.hpp>
+#include <fc/io/datastream.hpp>
+#include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/variant_object.hpp>
+
+#include <functional>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Layout of the binary export file.
+ *
+ * The file starts with binary_export_header followed by one binary_export_record per exported block, each of them
+ * serialized by fc::raw and preceded by its size as uint32. The header lists all exported data types, so records
+ * refer to them just by index. Payload of each type is either fc::raw of the exported object or its JSON.
+ */
+#define STEEM_BLOCK_DATA_EXPORT_BINARY_MAGIC    "steem-block-data-export"
+#define STEEM_BLOCK_DATA_EXPORT_BINARY_VERSION  1
+
+namespace steem { namespace plugins { namespace block_data_export {
+
+enum binary_export_encoding
+{
+   raw_encoding,
+   json_encoding
+};
+
+struct binary_export_type
+{
+   /// Name the export data has been registered with
+   std::string                         name;
+   /// C++ type of the export data, lets the reader pick how to unpack raw payload
+   std::string                         type_name;
+   uint8_t                             encoding = raw_encoding;
+};
+
+struct binary_export_header
+{
+   std::string                         magic = STEEM_BLOCK_DATA_EXPORT_BINARY_MAGIC;
+   uint32_t                            version = STEEM_BLOCK_DATA_EXPORT_BINARY_VERSION;
+   std::vector< binary_export_type >   types;
+};
+
+struct binary_export_entry
+{
+   fc::unsigned_int                    type;
+   std::vector< char >                 data;
+};
+
+struct binary_export_record
+{
+   protocol::block_id_type             block_id;
+   protocol::block_id_type             previous;
+   std::vector< binary_export_entry >  entries;
+};
+
+/// Appends `obj' serialized by fc::raw, preceded by its size, to `out'.
+template< typename T >
+void append_sized_object( std::string& out, const T& obj )
+{
+   uint32_t size = fc::raw::pack_size( obj );
+   size_t offset = out.size();
+   out.resize( offset + sizeof( size ) + size );
+   memcpy( &out[ offset ], &size, sizeof( size ) );
+   fc::datastream< char* > ds( &out[ offset + sizeof( size ) ], size );
+   fc::raw::pack( ds, obj );
+}
+
+/// Reads next size prefixed object from `in', returns false at the end of the stream.
+template< typename T >
+bool read_sized_object( std::istream& in, T& obj )
+{
+   uint32_t size = 0;
+   if( !in.read( reinterpret_cast< char* >( &size ), sizeof( size ) ) )
+      return false;
+
+   std::vector< char > buffer( size );
+   FC_ASSERT( size == 0 || in.read( buffer.data(), size ), "Truncated block data export file" );
+
+   fc::datastream< const char* > ds( buffer.data(), buffer.size() );
+   fc::raw::unpack( ds, obj );
+   return true;
+}
+
+} } } // steem::plugins::block_data_export
+
+FC_REFLECT( steem::plugins::block_data_export::binary_export_type, (name)(type_name)(encoding) )
+FC_REFLECT( steem::plugins::block_data_export::binary_export_header, (magic)(version)(types) )
+FC_REFLECT( steem::plugins::block_data_export::binary_export_entry, (type)(data) )
+FC_REFLECT( steem::plugins::block_data_export::binary_export_record, (block_id)(previous)(entries) )
+
+namespace steem { namespace plugins { namespace block_data_export {
+
+/**
+ * Reads a binary export back into the objects the JSON format writes, one per block.
+ * Raw payload of types without a decoder is returned in hex along with its type name.
+ */
+class binary_export_reader
+{
+   public:
+      typedef std::function< fc::variant( const std::vector< char >& ) > raw_decoder;
+
+      /// Reads and checks the header, which even an export of no blocks starts with.
+      explicit binary_export_reader( std::istream& input ) : _input( input )
+      {
+         FC_ASSERT( read_sized_object( _input, _header ), "Missing header" );
+         FC_ASSERT( _header.magic == STEEM_BLOCK_DATA_EXPORT_BINARY_MAGIC, "Not a block data export file" );
+         FC_ASSERT( _header.version == STEEM_BLOCK_DATA_EXPORT_BINARY_VERSION, "Unsupported version ${v}", ("v", _header.version) );
+      }
+
+      /// Unpacks raw payload of T, found by the reflected name exportable_block_data::binary_type_name() reports.
+      template< typename T >
+      void add_raw_decoder()
+      {
+         _decoders[ fc::get_typename< T >::name() ] = []( const std::vector< char >& data )
+         {
+            fc::variant v;
+            fc::to_variant( fc::raw::unpack_from_vector< T >( data ), v );
+            return v;
+         };
+      }
+
+      const binary_export_header& get_header()const { return _header; }
+
+      /// Reads the next block into `block', returns false at the end of the export.
+      bool read_block( fc::variant& block )
+      {
+         binary_export_record record;
+         if( !read_sized_object( _input, record ) )
+            return false;
+
+         fc::mutable_variant_object export_data;
+
+         for( const binary_export_entry& entry : record.entries )
+         {
+            FC_ASSERT( entry.type.value < _header.types.size(), "Unknown export type index ${i}", ("i", entry.type.value) );
+            const binary_export_type& type = _header.types[ entry.type.value ];
+
+            if( type.encoding == json_encoding )
+            {
+               export_data( type.name, fc::json::from_string( std::string( entry.data.begin(), entry.data.end() ) ) );
+               continue;
+            }
+
+            auto itr = _decoders.find( type.type_name );
+            if( itr != _decoders.end() )
+               export_data( type.name, itr->second( entry.data ) );
+            else
+               export_data( type.name, fc::mutable_variant_object( "type", type.type_name )( "hex", fc::to_hex( entry.data ) ) );
+         }
+
+         block = fc::mutable_variant_object
+            ( "block_id", record.block_id )
+            ( "previous", record.previous )
+            ( "export_data", export_data );
+         return true;
+      }
+
+   private:
+      std::istream&                          _input;
+      binary_export_header                   _header;
+      std::map< std::string, raw_decoder >   _decoders;
+};
+
+} } } // steem::plugins::block_data_export
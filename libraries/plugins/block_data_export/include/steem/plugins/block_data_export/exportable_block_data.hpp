@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace fc {
 class variant;
@@ -15,6 +16,10 @@ class exportable_block_data
       virtual ~exportable_block_data();
 
       virtual void to_variant( fc::variant& v )const = 0;
+      /// Serializes the data by fc::raw for the binary export format.
+      virtual void to_binary( std::vector< char >& data )const = 0;
+      /// Type name recorded in the binary export schema, readers pick how to unpack the raw payload by it.
+      virtual std::string binary_type_name()const = 0;
 };
 
 } } }
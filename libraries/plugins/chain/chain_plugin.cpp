@@ -15,6 +15,7 @@
 #include <fc/io/json.hpp>
 #include <fc/io/fstream.hpp>
 
+#include <boost/algorithm/string/replace.hpp>
 #include <boost/asio.hpp>
 #include <boost/optional.hpp>
 #include <boost/bind.hpp>
@@ -22,6 +23,8 @@
 #include <boost/thread/future.hpp>
 #include <boost/lockfree/queue.hpp>
 
+#include <array>
+#include <atomic>
 #include <thread>
 #include <memory>
 #include <iostream>
@@ -51,7 +54,7 @@ struct generate_block_request
    signed_block block;
 };
 
-typedef fc::static_variant< const signed_block*, const signed_transaction*, generate_block_request* > write_request_ptr;
+typedef fc::static_variant< const signed_block*, prepared_transaction*, generate_block_request* > write_request_ptr;
 typedef fc::static_variant< boost::promise< void >*, fc::future< void >* > promise_ptr;
 
 struct write_context
@@ -65,18 +68,44 @@ struct write_context
 
 namespace detail {
 
+static const char* write_lane_names[ NUM_WRITE_PRIORITIES ] = { "block", "produced_block", "api_transaction", "p2p_transaction" };
+
+struct write_lane
+{
+   write_lane( uint32_t w ) : queue( 64 ), weight( w ) {}
+
+   boost::lockfree::queue< write_context* > queue;
+   std::atomic< uint32_t >                  size{ 0 };
+   uint32_t                                 admission_limit = 0; ///< 0 is unlimited
+   uint32_t                                 weight = 1;          ///< Consecutive writes served per turn (transaction lanes only)
+};
+
 class chain_plugin_impl
 {
    public:
-      chain_plugin_impl() : write_queue( 64 ) {}
+      chain_plugin_impl()
+      {
+         write_lanes[ block_write_priority ]           = std::make_unique< write_lane >( 1 );
+         write_lanes[ produced_block_write_priority ]  = std::make_unique< write_lane >( 1 );
+         write_lanes[ api_transaction_write_priority ] = std::make_unique< write_lane >( 4 );
+         write_lanes[ p2p_transaction_write_priority ] = std::make_unique< write_lane >( 1 );
+      }
       ~chain_plugin_impl() { stop_write_processing(); }
 
       void start_write_processing();
       void stop_write_processing();
       void write_default_database_config( bfs::path& p );
 
+      void push_write_request( write_priority priority, write_context* cxt );
+      bool pop_write_request( write_context*& cxt );
+      bool pop_write_request( write_priority priority, write_context*& cxt );
+      bool has_pending_blocks() const;
+
       void post_block( const block_notification& note );
 
+      static void report_latency( const char* stat, const std::string& name, const steem::chain::util::latency_summary& summary );
+      void report_apply_latency();
+
       uint64_t                         shared_memory_size = 0;
       uint16_t                         shared_file_full_threshold = 0;
       uint16_t                         shared_file_scale_rate = 0;
@@ -105,17 +134,24 @@ class chain_plugin_impl
 
       bool                             running = true;
       std::shared_ptr< std::thread >   write_processor_thread;
-      boost::lockfree::queue< write_context* > write_queue;
+      std::array< std::unique_ptr< write_lane >, NUM_WRITE_PRIORITIES > write_lanes;
+      write_priority                   current_transaction_lane = api_transaction_write_priority; ///< Only used by the write thread
+      uint32_t                         transaction_lane_turns_left = 0;                           ///< Only used by the write thread
       int16_t                          write_lock_hold_time = 500;
+      uint32_t                         transaction_batch_size = 100;
 
       flat_map< string, fc::variant_object > plugin_state_opts;
       bfs::path                        database_cfg;
 
       database  db;
+      std::unique_ptr< change_stream > changes;   ///< Declared after db, which it is connected to
       std::string block_generator_registrant;
       std::shared_ptr< abstract_block_producer > block_generator;
 
       boost::signals2::connection      _post_apply_block_conn;
+
+      steem::plugins::statsd::statsd_plugin* statsd = nullptr;   ///< Set while apply latency is reported on its flushes
+      uint32_t                         statsd_flush_callback = 0;
 };
 
 struct write_request_visitor
@@ -129,6 +165,17 @@ struct write_request_visitor
 
    typedef bool result_type;
 
+   void report_pending_reapply()
+   {
+      const auto& stats = db->_last_pending_reapply_stats;
+      STATSD_TIMER( "chain", "write_time", "pending_reapply", stats.duration, 1.0f )
+      STATSD_GAUGE( "chain", "pending_reapply", "applied", stats.applied, 1.0f )
+      STATSD_GAUGE( "chain", "pending_reapply", "known", stats.known, 1.0f )
+      STATSD_GAUGE( "chain", "pending_reapply", "expired", stats.expired, 1.0f )
+      STATSD_GAUGE( "chain", "pending_reapply", "failed", stats.failed, 1.0f )
+      STATSD_GAUGE( "chain", "pending_reapply", "postponed", stats.postponed, 1.0f )
+   }
+
    bool operator()( const signed_block* block )
    {
       bool result = false;
@@ -138,6 +185,7 @@ struct write_request_visitor
          STATSD_START_TIMER( "chain", "write_time", "push_block", 1.0f )
          result = db->push_block( *block, skip );
          STATSD_STOP_TIMER( "chain", "write_time", "push_block" )
+         report_pending_reapply();
       }
       catch( fc::exception& e )
       {
@@ -152,29 +200,17 @@ struct write_request_visitor
       return result;
    }
 
-   bool operator()( const signed_transaction* trx )
+   bool operator()( prepared_transaction* trx )
    {
-      bool result = false;
+      // Transactions are normally pushed in batches by the write loop
+      vector< optional< fc::exception > > results;
 
-      try
-      {
-         STATSD_START_TIMER( "chain", "write_time", "push_transaction", 1.0f )
-         db->push_transaction( *trx );
-         STATSD_STOP_TIMER( "chain", "write_time", "push_transaction" )
-
-         result = true;
-      }
-      catch( fc::exception& e )
-      {
-         *except = e;
-      }
-      catch( ... )
-      {
-         *except = fc::unhandled_exception( FC_LOG_MESSAGE( warn, "Unexpected exception while pushing block." ),
-                                           std::current_exception() );
-      }
+      STATSD_START_TIMER( "chain", "write_time", "push_transaction", 1.0f )
+      db->push_transactions( { trx }, results, skip );
+      STATSD_STOP_TIMER( "chain", "write_time", "push_transaction" )
 
-      return result;
+      *except = results.front();
+      return !results.front().valid();
    }
 
    bool operator()( generate_block_request* req )
@@ -194,6 +230,7 @@ struct write_request_visitor
             req->skip
             );
          STATSD_STOP_TIMER( "chain", "write_time", "generate_block" )
+         report_pending_reapply();
 
          result = true;
       }
@@ -211,6 +248,16 @@ struct write_request_visitor
    }
 };
 
+struct prepared_transaction_visitor
+{
+   typedef prepared_transaction* result_type;
+
+   prepared_transaction* operator()( prepared_transaction* trx ) { return trx; }
+
+   template< typename T >
+   prepared_transaction* operator()( T* ) { return nullptr; }
+};
+
 struct request_promise_visitor
 {
    request_promise_visitor(){}
@@ -236,6 +283,32 @@ void chain_plugin_impl::start_write_processing()
       req_visitor.block_generator = block_generator;
 
       request_promise_visitor prom_visitor;
+      prepared_transaction_visitor trx_visitor;
+
+      vector< write_context* > trx_batch;
+      vector< prepared_transaction* > batch_trxs;
+      vector< optional< fc::exception > > batch_results;
+
+      auto push_transaction_batch = [&]()
+      {
+         if( trx_batch.empty() )
+            return;
+
+         STATSD_START_TIMER( "chain", "write_time", "push_transactions", 1.0f )
+         db.push_transactions( batch_trxs, batch_results );
+         STATSD_STOP_TIMER( "chain", "write_time", "push_transactions" )
+         STATSD_COUNT( "chain", "write_batch", "transactions", batch_trxs.size(), 1.0f )
+
+         for( size_t i = 0; i < trx_batch.size(); ++i )
+         {
+            trx_batch[i]->except = batch_results[i];
+            trx_batch[i]->success = !batch_results[i].valid();
+            trx_batch[i]->prom_ptr.visit( prom_visitor );
+         }
+
+         trx_batch.clear();
+         batch_trxs.clear();
+      };
 
       /* This loop monitors the write request queue and performs writes to the database. These
        * can be blocks or pending transactions. Because the caller needs to know the success of
@@ -255,23 +328,41 @@ void chain_plugin_impl::start_write_processing()
        * 10ms. This allows time for readers to access the database as well as more writes to come
        * in. When the node is live the rate at which writes come in is slower and busy waiting is
        * not an optimal use of system resources when we could give CPU time to read threads.
+       *
+       * Consecutive transactions are collected and pushed together, up to transaction_batch_size
+       * at a time, to share the per push setup. Signature recovery and stateless validation were
+       * already done by the caller in accept_transaction, outside of the lock. A batch is always
+       * pushed before any other write so writes are still applied in the order they were dequeued.
        */
       while( running )
       {
          if( !is_syncing )
             start = fc::time_point::now();
 
-         if( write_queue.pop( cxt ) )
+         if( pop_write_request( cxt ) )
          {
             db.with_write_lock( [&]()
             {
                STATSD_START_TIMER( "chain", "lock_time", "write_lock", 1.0f )
                while( running )
                {
-                  req_visitor.skip = cxt->skip;
-                  req_visitor.except = &(cxt->except);
-                  cxt->success = cxt->req_ptr.visit( req_visitor );
-                  cxt->prom_ptr.visit( prom_visitor );
+                  if( auto trx = cxt->req_ptr.visit( trx_visitor ) )
+                  {
+                     trx_batch.push_back( cxt );
+                     batch_trxs.push_back( trx );
+
+                     if( trx_batch.size() >= transaction_batch_size )
+                        push_transaction_batch();
+                  }
+                  else
+                  {
+                     push_transaction_batch();
+
+                     req_visitor.skip = cxt->skip;
+                     req_visitor.except = &(cxt->except);
+                     cxt->success = cxt->req_ptr.visit( req_visitor );
+                     cxt->prom_ptr.visit( prom_visitor );
+                  }
 
                   if( is_syncing && start - db.head_block_time() < fc::minutes(1) )
                   {
@@ -284,20 +375,78 @@ void chain_plugin_impl::start_write_processing()
                      break;
                   }
 
-                  if( !write_queue.pop( cxt ) )
+                  if( !pop_write_request( cxt ) )
                   {
                      break;
                   }
                }
+
+               push_transaction_batch();
             });
          }
 
-         if( !is_syncing )
+         // Give readers their window, unless a block is already waiting
+         if( !is_syncing && !has_pending_blocks() )
             boost::this_thread::sleep_for( boost::chrono::milliseconds( 10 ) );
       }
    });
 }
 
+void chain_plugin_impl::push_write_request( write_priority priority, write_context* cxt )
+{
+   write_lane& lane = *write_lanes[ priority ];
+
+   uint32_t queued = ++lane.size;
+   if( lane.admission_limit && queued > lane.admission_limit )
+   {
+      --lane.size;
+      STATSD_INCREMENT( "chain", "write_queue_rejected", write_lane_names[ priority ], 1.0f )
+      FC_ASSERT( false, "The ${lane} write queue is full, try again later.", ("lane", write_lane_names[ priority ])("limit", lane.admission_limit) );
+   }
+
+   STATSD_GAUGE( "chain", "write_queue_size", write_lane_names[ priority ], queued, 1.0f )
+   lane.queue.push( cxt );
+}
+
+bool chain_plugin_impl::pop_write_request( write_priority priority, write_context*& cxt )
+{
+   write_lane& lane = *write_lanes[ priority ];
+
+   if( !lane.queue.pop( cxt ) )
+      return false;
+
+   --lane.size;
+   return true;
+}
+
+bool chain_plugin_impl::pop_write_request( write_context*& cxt )
+{
+   // Blocks from the network come first, then blocks we are producing
+   if( pop_write_request( block_write_priority, cxt ) || pop_write_request( produced_block_write_priority, cxt ) )
+      return true;
+
+   // Transaction lanes take turns, each serving up to its weight before passing to the next
+   for( int i = api_transaction_write_priority; i <= NUM_WRITE_PRIORITIES; ++i )
+   {
+      if( transaction_lane_turns_left > 0 && pop_write_request( current_transaction_lane, cxt ) )
+      {
+         --transaction_lane_turns_left;
+         return true;
+      }
+
+      current_transaction_lane = current_transaction_lane + 1 < NUM_WRITE_PRIORITIES ?
+         write_priority( current_transaction_lane + 1 ) : api_transaction_write_priority;
+      transaction_lane_turns_left = write_lanes[ current_transaction_lane ]->weight;
+   }
+
+   return false;
+}
+
+bool chain_plugin_impl::has_pending_blocks() const
+{
+   return write_lanes[ block_write_priority ]->size.load() || write_lanes[ produced_block_write_priority ]->size.load();
+}
+
 void chain_plugin_impl::stop_write_processing()
 {
    running = false;
@@ -323,10 +472,44 @@ void chain_plugin_impl::post_block( const block_notification& note )
    }
 }
 
+void chain_plugin_impl::report_latency( const char* stat, const std::string& name, const steem::chain::util::latency_summary& summary )
+{
+   if( summary.count == 0 )
+      return;
+
+   STATSD_COUNT( "chain", stat, name + ".count", summary.count, 1.0f )
+   STATSD_GAUGE( "chain", stat, name + ".p50", summary.p50, 1.0f )
+   STATSD_GAUGE( "chain", stat, name + ".p99", summary.p99, 1.0f )
+   STATSD_GAUGE( "chain", stat, name + ".max", summary.max, 1.0f )
+}
+
+/// Publishes operation and plugin handler latencies (in microseconds) recorded since the previous statsd flush
+void chain_plugin_impl::report_apply_latency()
+{
+   auto& tracker = db.get_apply_latency_tracker();
+
+   tracker.for_each_operation( [&]( steem::chain::util::apply_latency_tracker::entry& e )
+   {
+      report_latency( "operation_latency", e.name, e.histogram.summarize_since( e.reported ) );
+   });
+
+   tracker.for_each_handler( [&]( steem::chain::util::apply_latency_tracker::entry& e )
+   {
+      // i.e. "tags->operation" is reported as "tags.pre_operation", "webserver=>block" as "webserver.async_block"
+      std::string name = boost::replace_all_copy( e.name, "->", ".pre_" );
+      boost::replace_all( name, "<-", ".post_" );
+      boost::replace_all( name, "=>", ".async_" );
+      report_latency( "handler_latency", name, e.histogram.summarize_since( e.reported ) );
+   });
+}
+
 } // detail
 
 
-chain_plugin::chain_plugin() : my( new detail::chain_plugin_impl() ) {}
+chain_plugin::chain_plugin() : my( new detail::chain_plugin_impl() )
+{
+   my->changes = std::make_unique< change_stream >( my->db, *this );
+}
 chain_plugin::~chain_plugin(){}
 
 database& chain_plugin::db() { return my->db; }
@@ -354,6 +537,14 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("from-state", bpo::value<string>()->default_value(""), "Load from state, then replay subsequent blocks")
          ("to-state", bpo::value<string>()->default_value(""), "File to save state to on shutdown")
          ("state-format", bpo::value<string>()->default_value("binary"), "State file save format (binary|json)")
+         ("api-transaction-queue-limit", bpo::value<uint32_t>()->default_value( 1000 ),
+            "Maximum number of API broadcast transactions waiting for the write thread before new ones are rejected. 0 is unlimited.")
+         ("p2p-transaction-queue-limit", bpo::value<uint32_t>()->default_value( 1000 ),
+            "Maximum number of P2P transactions waiting for the write thread before new ones are rejected. 0 is unlimited.")
+         ("transaction-batch-size", bpo::value<uint32_t>()->default_value( 100 ),
+            "Maximum number of queued transactions the write thread pushes together in one batch.")
+         ("change-stream-queue-limit", bpo::value<uint32_t>()->default_value( 1000 ),
+            "Maximum number of blocks waiting for asynchronous block handlers before the write thread waits for them. 0 is unlimited.")
 #ifdef ENABLE_MIRA
          ("memory-replay-indices", bpo::value<vector<string>>()->multitoken()->composing(), "Specify which indices should be in memory during replay")
 #endif
@@ -420,6 +611,11 @@ void chain_plugin::plugin_initialize(const variables_map& options)
    else
       my->flush_interval = 10000;
 
+   my->write_lanes[ api_transaction_write_priority ]->admission_limit = options.at( "api-transaction-queue-limit" ).as< uint32_t >();
+   my->write_lanes[ p2p_transaction_write_priority ]->admission_limit = options.at( "p2p-transaction-queue-limit" ).as< uint32_t >();
+   my->transaction_batch_size = std::max( options.at( "transaction-batch-size" ).as< uint32_t >(), uint32_t( 1 ) );
+   my->changes->set_max_queue_size( options.at( "change-stream-queue-limit" ).as< uint32_t >() );
+
    if( options.at( "state-format" ).as<string>() == "binary" )
    {
       my->state_format.is_binary = true;
@@ -495,13 +691,14 @@ void chain_plugin::plugin_initialize(const variables_map& options)
 
 void chain_plugin::plugin_startup()
 {
-   if( my->statsd_on_replay )
+   my->statsd = appbase::app().find_plugin< steem::plugins::statsd::statsd_plugin >();
+   if( my->statsd != nullptr )
    {
-      auto statsd = appbase::app().find_plugin< steem::plugins::statsd::statsd_plugin >();
-      if( statsd != nullptr )
-      {
-         statsd->start_logging();
-      }
+      if( my->statsd_on_replay )
+         my->statsd->start_logging();
+
+      // Apply latency histograms are summarized on the statsd flush thread, not by the write thread under the lock
+      my->statsd_flush_callback = my->statsd->add_flush_callback( [this]() { my->report_apply_latency(); } );
    }
 
    ilog( "Starting chain with shared_file_size: ${n} bytes", ("n", my->shared_memory_size) );
@@ -679,7 +876,14 @@ void chain_plugin::plugin_startup()
 void chain_plugin::plugin_shutdown()
 {
    ilog("closing chain database");
+   if( my->statsd != nullptr )
+   {
+      my->statsd->remove_flush_callback( my->statsd_flush_callback );
+      my->statsd = nullptr;
+   }
+
    my->stop_write_processing();
+   my->changes->stop();
 
    if( my->to_state != "" )
    {
@@ -731,7 +935,7 @@ bool chain_plugin::accept_block( const steem::chain::signed_block& block, bool c
    cxt.skip = skip;
    cxt.prom_ptr = &prom;
 
-   my->write_queue.push( &cxt );
+   my->push_write_request( block_write_priority, &cxt );
 
    prom.get_future().get();
 
@@ -740,14 +944,21 @@ bool chain_plugin::accept_block( const steem::chain::signed_block& block, bool c
    return cxt.success;
 }
 
-void chain_plugin::accept_transaction( const steem::chain::signed_transaction& trx )
+void chain_plugin::accept_transaction( const steem::chain::signed_transaction& trx, write_priority priority )
 {
+   FC_ASSERT( priority == api_transaction_write_priority || priority == p2p_transaction_write_priority,
+      "Transactions must be queued in a transaction lane." );
+
+   // Validation and signature recovery do not need the write lock, do them on the calling thread
+   prepared_transaction ptrx( trx );
+   my->db.prepare_transaction( ptrx );
+
    boost::promise< void > prom;
    write_context cxt;
-   cxt.req_ptr = &trx;
+   cxt.req_ptr = &ptrx;
    cxt.prom_ptr = &prom;
 
-   my->write_queue.push( &cxt );
+   my->push_write_request( priority, &cxt );
 
    prom.get_future().get();
 
@@ -768,7 +979,7 @@ steem::chain::signed_block chain_plugin::generate_block(
    cxt.req_ptr = &req;
    cxt.prom_ptr = &prom;
 
-   my->write_queue.push( &cxt );
+   my->push_write_request( produced_block_write_priority, &cxt );
 
    prom.get_future().get();
 
@@ -789,6 +1000,22 @@ int16_t chain_plugin::set_write_lock_hold_time( int16_t new_time )
    return old_time;
 }
 
+change_stream::consumer_id chain_plugin::add_async_block_handler( const abstract_plugin& plugin, const async_block_handler_t& on_block,
+   const async_irreversible_block_handler_t& on_irreversible, const async_block_filter_t& filter )
+{
+   return my->changes->add_consumer( plugin, on_block, on_irreversible, filter );
+}
+
+void chain_plugin::remove_async_block_handler( change_stream::consumer_id id )
+{
+   my->changes->remove_consumer( id );
+}
+
+uint32_t chain_plugin::async_block_backlog() const
+{
+   return my->changes->backlog();
+}
+
 bool chain_plugin::block_is_on_preferred_chain(const steem::chain::block_id_type& block_id )
 {
    // If it's not known, it's not preferred.
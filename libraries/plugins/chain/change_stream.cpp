@@ -0,0 +1,198 @@
+#include <steem/plugins/chain/change_stream.hpp>
+
+#include <steem/chain/util/signal.hpp>
+
+#include <steem/plugins/statsd/utility.hpp>
+
+#include <algorithm>
+
+namespace steem { namespace plugins { namespace chain {
+
+change_stream::consumer_id change_stream::add_consumer( const appbase::abstract_plugin& plugin, const async_block_handler_t& on_block,
+   const async_irreversible_block_handler_t& on_irreversible, const async_block_filter_t& filter )
+{
+   auto& tracker = _db.get_apply_latency_tracker();
+
+   consumer c;
+   c.on_block = on_block;
+   c.on_irreversible = on_irreversible;
+   c.filter = filter;
+   c.block_latency = &tracker.register_handler( plugin.get_name() + "=>block" );
+   c.irreversible_latency = &tracker.register_handler( plugin.get_name() + "=>irreversible" );
+
+   std::lock_guard< std::mutex > lock( _consumers_mutex );
+   c.id = _next_id++;
+   _consumers.push_back( c );
+
+   if( !_connected )
+      connect();
+
+   return c.id;
+}
+
+void change_stream::remove_consumer( consumer_id id )
+{
+   {
+      std::lock_guard< std::mutex > lock( _consumers_mutex );
+      _consumers.erase( std::remove_if( _consumers.begin(), _consumers.end(),
+         [id]( const consumer& c ) { return c.id == id; } ), _consumers.end() );
+   }
+
+   // Wait for an event being dispatched with the previous consumer list
+   std::lock_guard< std::mutex > lock( _dispatch_mutex );
+}
+
+void change_stream::stop()
+{
+   steem::chain::util::disconnect_signal( _pre_apply_block_conn );
+   steem::chain::util::disconnect_signal( _post_apply_operation_conn );
+   steem::chain::util::disconnect_signal( _post_apply_block_conn );
+   steem::chain::util::disconnect_signal( _irreversible_block_conn );
+
+   if( _dispatch_thread.joinable() )
+   {
+      {
+         std::lock_guard< std::mutex > lock( _queue_mutex );
+         _stopping = true;
+      }
+      _queue_cv.notify_all();
+      _queue_space_cv.notify_all();
+      _dispatch_thread.join();
+   }
+}
+
+void change_stream::connect()
+{
+   // Operations are only collected between pre and post apply block, so those of pending
+   // transactions are not part of the stream.
+   _pre_apply_block_conn = _db.add_pre_apply_block_handler( [this]( const steem::chain::block_notification& )
+   {
+      _collecting = wants_block();
+      if( _collecting )
+         _current = std::make_shared< applied_block >();
+   }, _owner );
+
+   _post_apply_operation_conn = _db.add_post_apply_operation_handler( [this]( const steem::chain::operation_notification& note )
+   {
+      if( _collecting )
+         _current->ops.emplace_back( note );
+   }, _owner );
+
+   _post_apply_block_conn = _db.add_post_apply_block_handler( [this]( const steem::chain::block_notification& note )
+   {
+      if( !_collecting )
+         return;
+
+      _collecting = false;
+      _current->block = note.block;
+      _current->block_id = note.block_id;
+      _current->block_num = note.block_num;
+
+      event_type e;
+      e.block = std::move( _current );
+      post( std::move( e ) );
+   }, _owner );
+
+   _irreversible_block_conn = _db.add_irreversible_block_handler( [this]( uint32_t block_num )
+   {
+      event_type e;
+      e.irreversible_block_num = block_num;
+      post( std::move( e ) );
+   }, _owner );
+
+   _dispatch_thread = std::thread( [this]() { dispatch_thread_main(); } );
+   _connected = true;
+}
+
+bool change_stream::wants_block()
+{
+   std::lock_guard< std::mutex > lock( _consumers_mutex );
+
+   for( const auto& c : _consumers )
+      if( c.on_block && ( !c.filter || c.filter() ) )
+         return true;
+
+   return false;
+}
+
+void change_stream::post( event_type&& event )
+{
+   {
+      std::unique_lock< std::mutex > lock( _queue_mutex );
+
+      // Back pressure on the write thread. Once stopping, nothing may be left to drain the queue.
+      if( _max_queue_size != 0 && _queue.size() >= _max_queue_size && !_stopping )
+      {
+         STATSD_INCREMENT( "chain", "change_stream", "queue_full", 1.0f )
+         _queue_space_cv.wait( lock, [this]() { return _stopping || _queue.size() < _max_queue_size; } );
+      }
+
+      _queue.emplace_back( std::move( event ) );
+   }
+
+   _backlog.fetch_add( 1, std::memory_order_relaxed );
+   _queue_cv.notify_one();
+}
+
+void change_stream::dispatch( const event_type& event )
+{
+   std::lock_guard< std::mutex > dispatch_lock( _dispatch_mutex );
+
+   // Consumers are called on a copy of the list, so the write thread never waits for them
+   std::vector< consumer > consumers;
+   {
+      std::lock_guard< std::mutex > lock( _consumers_mutex );
+      consumers = _consumers;
+   }
+
+   for( const auto& c : consumers )
+   {
+      try
+      {
+         fc::time_point start = fc::time_point::now();
+
+         if( event.block && c.on_block )
+         {
+            c.on_block( event.block );
+            c.block_latency->histogram.record( ( fc::time_point::now() - start ).count() );
+         }
+         else if( !event.block && c.on_irreversible )
+         {
+            c.on_irreversible( event.irreversible_block_num );
+            c.irreversible_latency->histogram.record( ( fc::time_point::now() - start ).count() );
+         }
+      }
+      catch( const fc::exception& e )
+      {
+         elog( "Caught exception in change stream consumer: ${e}", ("e", e.to_detail_string()) );
+      }
+      catch( const std::exception& e )
+      {
+         elog( "Caught exception in change stream consumer: ${e}", ("e", e.what()) );
+      }
+   }
+}
+
+void change_stream::dispatch_thread_main()
+{
+   std::unique_lock< std::mutex > lock( _queue_mutex );
+
+   while( true )
+   {
+      _queue_cv.wait( lock, [this]() { return _stopping || !_queue.empty(); } );
+
+      if( _queue.empty() )
+         break;
+
+      event_type event = std::move( _queue.front() );
+      _queue.pop_front();
+      _queue_space_cv.notify_one();
+
+      lock.unlock();
+      dispatch( event );
+      _backlog.fetch_sub( 1, std::memory_order_relaxed );
+      lock.lock();
+   }
+}
+
+} } } // steem::plugins::chain
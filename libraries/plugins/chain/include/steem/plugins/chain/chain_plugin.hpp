@@ -3,6 +3,7 @@
 #include <appbase/application.hpp>
 #include <steem/chain/database.hpp>
 #include <steem/plugins/chain/abstract_block_producer.hpp>
+#include <steem/plugins/chain/change_stream.hpp>
 
 #include <boost/signals2.hpp>
 
@@ -18,6 +19,20 @@ using namespace steem::chain;
 
 namespace bfs = boost::filesystem;
 
+/**
+ * Writes are queued for the write thread in one lane per priority. Blocks are always
+ * applied before anything else is dequeued; the transaction lanes share what is left
+ * by weight so neither source can starve the other.
+ */
+enum write_priority
+{
+   block_write_priority,            ///< Blocks received from the network or the block APIs
+   produced_block_write_priority,   ///< Blocks generated locally by a registered block producer
+   api_transaction_write_priority,  ///< Transactions broadcast through the API
+   p2p_transaction_write_priority,  ///< Transactions relayed by P2P peers
+   NUM_WRITE_PRIORITIES
+};
+
 class chain_plugin : public plugin< chain_plugin >
 {
 public:
@@ -39,7 +54,7 @@ public:
    flat_map< string, fc::variant_object >& get_state_options() const;
 
    bool accept_block( const steem::chain::signed_block& block, bool currently_syncing, uint32_t skip );
-   void accept_transaction( const steem::chain::signed_transaction& trx );
+   void accept_transaction( const steem::chain::signed_transaction& trx, write_priority priority = api_transaction_write_priority );
    steem::chain::signed_block generate_block(
       const fc::time_point_sec when,
       const account_name_type& witness_owner,
@@ -69,6 +84,22 @@ public:
     */
    int16_t set_write_lock_hold_time( int16_t new_time );
 
+   /**
+    * Opt-in alternative to database signals for plugins that keep no consensus state. Applied blocks, with their
+    * operations, and irreversible block numbers are delivered in order on the change stream thread, outside of
+    * the write lock. See change_stream for what consumers may do.
+    *
+    * The filter, if any, is called on the write thread at the start of every block and skips collecting it when
+    * no consumer wants it. Consumers must be removed before they are destroyed.
+    */
+   change_stream::consumer_id add_async_block_handler( const abstract_plugin& plugin, const async_block_handler_t& on_block,
+      const async_irreversible_block_handler_t& on_irreversible = async_irreversible_block_handler_t(),
+      const async_block_filter_t& filter = async_block_filter_t() );
+   void remove_async_block_handler( change_stream::consumer_id id );
+
+   /// Number of change stream events not yet delivered to every consumer
+   uint32_t async_block_backlog() const;
+
    bool block_is_on_preferred_chain( const steem::chain::block_id_type& block_id );
 
    void check_time_in_block( const steem::chain::signed_block& block );
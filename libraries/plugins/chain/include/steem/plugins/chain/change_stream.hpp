@@ -0,0 +1,138 @@
+#pragma once
+#include <steem/chain/database.hpp>
+
+#include <appbase/application.hpp>
+
+#include <boost/signals2.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace steem { namespace plugins { namespace chain {
+
+using steem::chain::database;
+
+struct applied_operation
+{
+   applied_operation( const steem::chain::operation_notification& note ) :
+      trx_id( note.trx_id ),
+      trx_in_block( note.trx_in_block ),
+      op_in_trx( note.op_in_trx ),
+      virtual_op( note.virtual_op ),
+      op( note.op )
+   {}
+
+   protocol::transaction_id_type trx_id;
+   uint32_t                      trx_in_block;
+   uint32_t                      op_in_trx;
+   uint32_t                      virtual_op;
+   protocol::operation           op;
+};
+
+/// A block as applied to the database, along with every operation (virtual ones included) it produced
+struct applied_block
+{
+   protocol::signed_block              block;
+   protocol::block_id_type             block_id;
+   uint32_t                            block_num = 0;
+   std::vector< applied_operation >    ops;
+};
+
+typedef std::function< void( const std::shared_ptr< const applied_block >& ) > async_block_handler_t;
+typedef std::function< void( uint32_t ) >                                       async_irreversible_block_handler_t;
+/// Consulted at the start of every block, the block is only collected when some consumer wants it
+typedef std::function< bool() >                                                async_block_filter_t;
+
+/**
+ * Ordered stream of applied and irreversible blocks for plugins that keep no consensus state.
+ *
+ * Database signal handlers run on the write thread while the write lock is held, so each of them extends every
+ * block. Consumers of this stream are instead called on a thread of its own, in the order blocks were applied,
+ * and must not access the database. A block number applied again after a fork replaces the block it displaced.
+ *
+ * Nothing is collected until a consumer registers, the time spent in each consumer is tracked like database
+ * handlers are (i.e. "webserver=>block").
+ *
+ * The queue between the write thread and consumers is bounded. When consumers fall that far behind, the write
+ * thread waits for room rather than dropping events, so a slow consumer slows the chain down but never misses
+ * or reorders blocks.
+ */
+class change_stream
+{
+   public:
+      typedef uint64_t consumer_id;
+
+      change_stream( database& db, const appbase::abstract_plugin& owner ) : _db( db ), _owner( owner ) {}
+      ~change_stream() { stop(); }
+
+      consumer_id add_consumer( const appbase::abstract_plugin& plugin, const async_block_handler_t& on_block,
+         const async_irreversible_block_handler_t& on_irreversible, const async_block_filter_t& filter );
+
+      /// Returns once the consumer is no longer being called
+      void remove_consumer( consumer_id id );
+
+      /// Delivers what is already queued and joins the dispatch thread
+      void stop();
+
+      uint32_t backlog()const { return _backlog.load( std::memory_order_relaxed ); }
+
+      /// Events queued before the write thread waits for consumers, 0 is unlimited. Set before blocks are applied.
+      void set_max_queue_size( uint32_t max_queue_size ) { _max_queue_size = max_queue_size; }
+
+   private:
+      struct consumer
+      {
+         consumer_id                                     id = 0;
+         async_block_handler_t                           on_block;
+         async_irreversible_block_handler_t              on_irreversible;
+         async_block_filter_t                            filter;
+         steem::chain::util::apply_latency_tracker::entry* block_latency = nullptr;
+         steem::chain::util::apply_latency_tracker::entry* irreversible_latency = nullptr;
+      };
+
+      struct event_type
+      {
+         std::shared_ptr< const applied_block > block;        ///< Set for applied blocks
+         uint32_t                               irreversible_block_num = 0;
+      };
+
+      void connect();
+      bool wants_block();
+      void post( event_type&& event );
+      void dispatch( const event_type& event );
+      void dispatch_thread_main();
+
+      database&                              _db;
+      const appbase::abstract_plugin&        _owner;
+
+      std::mutex                             _consumers_mutex;
+      std::vector< consumer >                _consumers;
+      consumer_id                            _next_id = 1;
+      std::mutex                             _dispatch_mutex;     ///< Held while an event is being dispatched
+
+      std::mutex                             _queue_mutex;
+      std::condition_variable                _queue_cv;
+      std::condition_variable                _queue_space_cv;
+      std::deque< event_type >               _queue;
+      uint32_t                               _max_queue_size = 1000;
+      std::atomic< uint32_t >                _backlog = { 0 };
+      bool                                   _stopping = false;
+      std::thread                            _dispatch_thread;
+      bool                                   _connected = false;
+
+      /// Written by the chain write thread only
+      bool                                   _collecting = false;
+      std::shared_ptr< applied_block >       _current;
+
+      boost::signals2::connection            _pre_apply_block_conn;
+      boost::signals2::connection            _post_apply_operation_conn;
+      boost::signals2::connection            _post_apply_block_conn;
+      boost::signals2::connection            _irreversible_block_conn;
+};
+
+} } } // steem::plugins::chain
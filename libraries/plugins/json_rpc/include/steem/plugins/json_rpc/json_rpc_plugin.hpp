@@ -7,6 +7,8 @@
 #include <fc/reflect/variant.hpp>
 #include <fc/exception/exception.hpp>
 
+#include <steem/plugins/json_rpc/utility.hpp>
+
 #include <boost/config.hpp>
 #include <boost/any.hpp>
 
@@ -61,9 +63,19 @@ using namespace appbase;
  * @brief Internal type used to bind api methods
  * to names.
  *
- * Arguments: Variant object of propert arg type
+ * Arguments: Variant object of propert arg type, read in place from the parsed request
+ * Result: The return struct serialized to JSON, spliced into the response as is
+ */
+typedef std::function< void(const fc::variant&, std::string&) > api_method;
+
+/**
+ * @brief Decides from a call's arguments whether its result can never change,
+ * e.g. because the block it reads is irreversible. Evaluated before the call.
+ *
+ * Results of calls it accepts are kept in the response cache, keyed on the normalized
+ * arguments it writes to its second parameter (see add_immutable_api_method< Args >).
  */
-typedef std::function< fc::variant(const fc::variant&) > api_method;
+typedef std::function< bool(const fc::variant&, std::string&) > api_immutable_predicate;
 
 /**
  * @brief An API, containing APIs and Methods
@@ -101,6 +113,27 @@ class json_rpc_plugin : public appbase::plugin< json_rpc_plugin >
       virtual void plugin_shutdown() override;
 
       void add_api_method( const string& api_name, const string& method_name, const api_method& api, const api_method_signature& sig );
+      void add_immutable_api_method( const string& api_name, const string& method_name, const api_immutable_predicate& is_immutable );
+
+      /**
+       * Arguments are converted to the method's Args type before is_immutable( const Args& ) is asked,
+       * and re-serialized from it to key the cache, so field order and formatting of a request do not matter.
+       */
+      template< typename Args, typename Predicate >
+      void add_immutable_api_method( const string& api_name, const string& method_name, Predicate is_immutable )
+      {
+         add_immutable_api_method( api_name, method_name, api_immutable_predicate(
+            [is_immutable]( const fc::variant& v, std::string& normalized_args )
+            {
+               Args args = v.as< Args >();
+               if( !is_immutable( args ) )
+                  return false;
+
+               normalized_args = fc::json::to_string( fc::variant( args ) );
+               return true;
+            }) );
+      }
+
       string call( const string& body );
 
    private:
@@ -109,6 +142,97 @@ class json_rpc_plugin : public appbase::plugin< json_rpc_plugin >
 
 namespace detail {
 
+   /// Writes the members of a streamed result, skipping unset optionals the way to_variant does
+   template< typename T >
+   class streamed_member_writer
+   {
+      public:
+         streamed_member_writer( const T& obj, std::string& out ) : _obj( obj ), _out( out ) {}
+
+         template< typename Member, class Class, Member (Class::*member) >
+         void operator()( const char* name )const
+         {
+            add( name, _obj.*member );
+         }
+
+         void write()
+         {
+            _out += '{';
+            fc::reflector< T >::visit( *this );
+            _out += '}';
+         }
+
+      private:
+         template< typename M >
+         void add( const char* name, const fc::optional< M >& v )const
+         {
+            if( v.valid() )
+               add( name, *v );
+         }
+
+         template< typename M >
+         void add( const char* name, const M& v )const
+         {
+            begin_member( name );
+            _out += fc::json::to_string( fc::variant( v ) );
+         }
+
+         template< typename E >
+         void add( const char* name, const std::vector< E >& v )const
+         {
+            begin_member( name );
+            write_elements( v, typename fc::reflector< E >::is_defined() );
+         }
+
+         void begin_member( const char* name )const
+         {
+            if( !_first )
+               _out += ',';
+            _first = false;
+
+            _out += '"';
+            _out += name;
+            _out += "\":";
+         }
+
+         template< typename E >
+         void write_elements( const std::vector< E >& v, fc::true_type )const
+         {
+            _out += '[';
+            for( size_t i = 0; i < v.size(); ++i )
+            {
+               if( i )
+                  _out += ',';
+               _out += fc::json::to_string( fc::variant( v[i] ) );
+            }
+            _out += ']';
+         }
+
+         /// Vectors of types that are not reflected structs, e.g. bytes, keep their own to_variant
+         template< typename E >
+         void write_elements( const std::vector< E >& v, fc::false_type )const
+         {
+            _out += fc::json::to_string( fc::variant( v ) );
+         }
+
+         const T&       _obj;
+         std::string&   _out;
+         mutable bool   _first = true;
+   };
+
+   template< typename Ret >
+   void write_result( const Ret& ret, std::string& result, std::false_type )
+   {
+      result = fc::json::to_string( ret );
+   }
+
+   template< typename Ret >
+   void write_result( const Ret& ret, std::string& result, std::true_type )
+   {
+      result.clear();
+      streamed_member_writer< Ret >( ret, result ).write();
+   }
+
    class register_api_method_visitor
    {
       public:
@@ -126,9 +250,9 @@ namespace detail {
             Ret* ret )
          {
             _json_rpc_plugin.add_api_method( _api_name, method_name,
-               [&plugin,method]( const fc::variant& args ) -> fc::variant
+               [&plugin,method]( const fc::variant& args, std::string& result )
                {
-                  return fc::variant( (plugin.*method)( args.as< Args >(), true ) );
+                  write_result( (plugin.*method)( args.as< Args >(), true ), result, is_streamed_result< Ret >() );
                },
                api_method_signature{ fc::variant( Args() ), fc::variant( Ret() ) } );
          }
@@ -5,6 +5,8 @@
 #include <fc/reflect/reflect.hpp>
 #include <fc/macros.hpp>
 
+#include <chainbase/chainbase.hpp>
+
 #include <boost/preprocessor/seq/for_each.hpp>
 #include <boost/preprocessor/cat.hpp>
 
@@ -72,6 +74,8 @@ BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _a
 BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args, bool lock ) \
 {                                                                                                        \
    FC_UNUSED( lock );                                                                                     \
+   /* Lockless methods lock on their own or wait on the writer, neither works under a held read lock */  \
+   chainbase::read_context::release_current();                                                           \
    return my->method( args );                                                                            \
 }
 
@@ -88,6 +92,19 @@ namespace steem { namespace plugins { namespace json_rpc {
 
 struct void_type {};
 
+/**
+ * Return types marked with JSON_RPC_STREAMED_RESULT are written to JSON one field at a time and
+ * their vector fields one element at a time, so a large page of results never exists as a single
+ * variant tree. Only plain FC_REFLECT structs without a custom to_variant may be marked.
+ */
+template< typename T >
+struct is_streamed_result : std::false_type {};
+
 } } } // steem::plugins::json_rpc
 
+#define JSON_RPC_STREAMED_RESULT( TYPE )                                                  \
+namespace steem { namespace plugins { namespace json_rpc {                                \
+   template<> struct is_streamed_result< TYPE > : std::true_type {};                      \
+} } }
+
 FC_REFLECT( steem::plugins::json_rpc::void_type, )
@@ -12,6 +12,15 @@
 
 #include <chainbase/chainbase.hpp>
 
+#include <boost/asio/io_service.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 #define ENABLE_JSON_RPC_LOG
 
 namespace steem { namespace plugins { namespace json_rpc {
@@ -37,8 +46,37 @@ namespace detail
       fc::optional< fc::variant >      result;
       fc::optional< json_rpc_error >   error;
       fc::variant                      id;
+
+      /// Result of a successful call, already serialized. Not reflected, see write_response.
+      std::string                      result_json;
    };
 
+   /**
+    * Appends the JSON for a response to out. A successful call's result was serialized straight from
+    * its return struct, so it is spliced in rather than parsed back into a variant to build the envelope.
+    */
+   void write_response( const json_rpc_response& response, std::string& out )
+   {
+      if( response.error.valid() || response.result_json.empty() )
+      {
+         out += fc::json::to_string( response );
+         return;
+      }
+
+      // Same layout as the reflected json_rpc_response: jsonrpc, result, id
+      out += "{\"jsonrpc\":\"2.0\",\"result\":";
+      out += response.result_json;
+      out += ",\"id\":";
+      out += fc::json::to_string( response.id );
+      out += '}';
+   }
+
+   const fc::variant& empty_args()
+   {
+      static const fc::variant empty = fc::variant( fc::variant_object() );
+      return empty;
+   }
+
    typedef void_type             get_methods_args;
    typedef vector< string >      get_methods_return;
 
@@ -114,6 +152,8 @@ namespace detail
 
          if (error)
             fc::json::save_to_file(response.error, file);
+         else if (response.result_json.size())
+            fc::json::save_to_file(fc::json::from_string(response.result_json), file);
          else
             fc::json::save_to_file(response.result, file);
       }
@@ -127,6 +167,65 @@ namespace detail
       uint32_t errors = 0;
    };
 
+   /**
+    * Serialized results of immutable calls, keyed on the canonical method name and normalized arguments.
+    * Least recently used entries are evicted to stay under the memory cap.
+    */
+   class response_cache
+   {
+      public:
+         void set_capacity( size_t bytes ) { _capacity = bytes; }
+         bool enabled()const { return _capacity > 0; }
+
+         bool get( const string& key, string& result )
+         {
+            std::lock_guard< std::mutex > guard( _mutex );
+
+            auto itr = _index.find( key );
+            if( itr == _index.end() )
+               return false;
+
+            _entries.splice( _entries.begin(), _entries, itr->second );
+            result = itr->second->second;
+            return true;
+         }
+
+         void put( const string& key, const string& result )
+         {
+            size_t entry_size = key.size() * 2 + result.size();
+            if( entry_size > _capacity )
+               return;
+
+            std::lock_guard< std::mutex > guard( _mutex );
+
+            if( _index.count( key ) )
+               return;
+
+            while( _size + entry_size > _capacity && _entries.size() )
+            {
+               auto& last = _entries.back();
+               _size -= last.first.size() * 2 + last.second.size();
+               _index.erase( last.first );
+               _entries.pop_back();
+            }
+
+            _entries.emplace_front( key, result );
+            _index[ key ] = _entries.begin();
+            _size += entry_size;
+
+            STATSD_GAUGE( "jsonrpc", "response_cache", "size", _size, 1.0f );
+         }
+
+      private:
+         typedef std::list< std::pair< string, string > > entry_list;
+
+         std::mutex                                            _mutex;
+         entry_list                                            _entries;   ///< Most recently used first
+         std::unordered_map< string, entry_list::iterator >    _index;
+         size_t                                                _size = 0;
+         size_t                                                _capacity = 0;
+   };
+
    class json_rpc_plugin_impl
    {
       public:
@@ -134,12 +233,19 @@ namespace detail
          ~json_rpc_plugin_impl();
 
          void add_api_method( const string& api_name, const string& method_name, const api_method& api, const api_method_signature& sig );
+         void add_immutable_api_method( const string& api_name, const string& method_name, const api_immutable_predicate& is_immutable );
+
+         void call_api_method( const api_method& call, const string& method_name, const fc::variant& func_args, json_rpc_response& response );
 
          api_method* find_api_method( std::string api, std::string method );
-         api_method* process_params( string method, const fc::variant_object& request, fc::variant& func_args, string* method_name );
+         api_method* process_params( string method, const fc::variant_object& request, const fc::variant*& func_args, string* method_name );
          void rpc_id( const fc::variant_object& request, json_rpc_response& response );
          void rpc_jsonrpc( const fc::variant_object& request, json_rpc_response& response );
          json_rpc_response rpc( const fc::variant& message );
+         void rpc_batch( const fc::variants& messages, vector< json_rpc_response >& responses );
+
+         void start_batch_threads( uint32_t thread_count );
+         void stop_batch_threads();
 
          void initialize();
 
@@ -157,10 +263,36 @@ namespace detail
          vector< string >                                   _methods;
          map< string, map< string, api_method_signature > > _method_sigs;
          std::unique_ptr< json_rpc_logger >                 _logger;
+         map< string, api_immutable_predicate >             _immutable_methods;
+         response_cache                                     _response_cache;
+
+         boost::asio::io_service                            _batch_ios;
+         std::unique_ptr< boost::asio::io_service::work >   _batch_work;
+         vector< std::thread >                              _batch_threads;
+         uint32_t                                           _batch_parallelism = 1;
    };
 
    json_rpc_plugin_impl::json_rpc_plugin_impl() {}
-   json_rpc_plugin_impl::~json_rpc_plugin_impl() {}
+   json_rpc_plugin_impl::~json_rpc_plugin_impl() { stop_batch_threads(); }
+
+   void json_rpc_plugin_impl::start_batch_threads( uint32_t thread_count )
+   {
+      _batch_work.reset( new boost::asio::io_service::work( _batch_ios ) );
+
+      for( uint32_t i = 0; i < thread_count; ++i )
+         _batch_threads.emplace_back( [this]() { _batch_ios.run(); } );
+   }
+
+   void json_rpc_plugin_impl::stop_batch_threads()
+   {
+      _batch_work.reset();
+      _batch_ios.stop();
+
+      for( auto& t : _batch_threads )
+         t.join();
+
+      _batch_threads.clear();
+   }
 
    void json_rpc_plugin_impl::add_api_method( const string& api_name, const string& method_name, const api_method& api, const api_method_signature& sig )
    {
@@ -172,6 +304,54 @@ namespace detail
       _methods.push_back( canonical_name.str() );
    }
 
+   void json_rpc_plugin_impl::add_immutable_api_method( const string& api_name, const string& method_name, const api_immutable_predicate& is_immutable )
+   {
+      auto api_itr = _registered_apis.find( api_name );
+      FC_ASSERT( api_itr != _registered_apis.end() && api_itr->second.count( method_name ),
+         "Method ${api}.${method} does not exist.", ("api", api_name)("method", method_name) );
+      _immutable_methods[ api_name + "." + method_name ] = is_immutable;
+   }
+
+   void json_rpc_plugin_impl::call_api_method( const api_method& call, const string& method_name, const fc::variant& func_args, json_rpc_response& response )
+   {
+      string cache_key;
+
+      if( _response_cache.enabled() )
+      {
+         auto itr = _immutable_methods.find( method_name );
+
+         // Ask before calling. A result read while its block was still reversible must never be cached.
+         bool immutable = false;
+         string normalized_args;
+         if( itr != _immutable_methods.end() )
+         {
+            try
+            {
+               immutable = itr->second( func_args, normalized_args );
+            }
+            catch( ... ) {} // Malformed args or lock timeout, treat as mutable and let the call report errors
+         }
+
+         if( immutable )
+         {
+            cache_key = method_name + ' ' + normalized_args;
+
+            if( _response_cache.get( cache_key, response.result_json ) )
+            {
+               STATSD_INCREMENT( "jsonrpc", "response_cache", "hit", 1.0f );
+               return;
+            }
+
+            STATSD_INCREMENT( "jsonrpc", "response_cache", "miss", 1.0f );
+         }
+      }
+
+      call( func_args, response.result_json );
+
+      if( cache_key.size() )
+         _response_cache.put( cache_key, response.result_json );
+   }
+
    void json_rpc_plugin_impl::initialize()
    {
       JSON_RPC_REGISTER_API( "jsonrpc" );
@@ -211,19 +391,18 @@ namespace detail
       return &(method_itr->second);
    }
 
-   api_method* json_rpc_plugin_impl::process_params( string method, const fc::variant_object& request, fc::variant& func_args, string* method_name )
+   api_method* json_rpc_plugin_impl::process_params( string method, const fc::variant_object& request, const fc::variant*& func_args, string* method_name )
    {
       STATSD_START_TIMER( "jsonrpc", "overhead", "process_params", 1.0f );
       api_method* ret = nullptr;
 
+      // Arguments are read in place from the request rather than copied out of it
       if( method == "call" )
       {
          FC_ASSERT( request.contains( "params" ) );
 
-         std::vector< fc::variant > v;
-
-         if( request[ "params" ].is_array() )
-            v = request[ "params" ].as< std::vector< fc::variant > >();
+         static const fc::variants no_params;
+         const fc::variants& v = request[ "params" ].is_array() ? request[ "params" ].get_array() : no_params;
 
          FC_ASSERT( v.size() == 2 || v.size() == 3, "params should be {\"api\", \"method\", \"args\"" );
 
@@ -234,7 +413,7 @@ namespace detail
 
          *method_name = api + "." + method;
 
-         func_args = ( v.size() == 3 ) ? v[2] : fc::json::from_string( "{}" );
+         func_args = ( v.size() == 3 ) ? &v[2] : &empty_args();
       }
       else
       {
@@ -247,7 +426,7 @@ namespace detail
 
          *method_name = method;
 
-         func_args = request.contains( "params" ) ? request[ "params" ] : fc::json::from_string( "{}" );
+         func_args = request.contains( "params" ) ? &request[ "params" ] : &empty_args();
       }
 
       return ret;
@@ -288,7 +467,7 @@ namespace detail
                // This is to maintain backwards compatibility with existing call structure.
                if( ( method == "call" && request.contains( "params" ) ) || method != "call" )
                {
-                  fc::variant func_args;
+                  const fc::variant* func_args = nullptr;
                   api_method* call = nullptr;
                   string method_name;
 
@@ -306,7 +485,7 @@ namespace detail
                      if( call )
                      {
                         STATSD_START_TIMER( "jsonrpc", "api", method_name, 1.0f );
-                        response.result = (*call)( func_args );
+                        call_api_method( *call, method_name, *func_args, response );
                      }
                   }
                   catch( chainbase::lock_exception& e )
@@ -397,6 +576,96 @@ namespace detail
 
       return response;
    }
+
+   /**
+    * Reports how a request scope used its read_context: time spent waiting for the chainbase read lock
+    * against time spent running calls, and how many reads were served by the lock already held.
+    */
+   static void report_read_context( const chainbase::read_context& ctx, const fc::time_point& start )
+   {
+      fc::microseconds lock_wait( ctx.lock_wait_micros() );
+      fc::microseconds execution = ( fc::time_point::now() - start ) - lock_wait;
+
+      STATSD_TIMER( "jsonrpc", "read_context", "lock_wait", lock_wait, 1.0f )
+      STATSD_TIMER( "jsonrpc", "read_context", "execution", execution, 1.0f )
+      STATSD_COUNT( "jsonrpc", "read_context", "acquisitions", ctx.acquisitions(), 1.0f )
+      STATSD_COUNT( "jsonrpc", "read_context", "reuses", ctx.reuses(), 1.0f )
+   }
+
+   /**
+    * Runs the elements of a batch concurrently. The calling thread always works through the batch
+    * itself and up to _batch_parallelism - 1 helpers from the batch pool join in, each taking the
+    * next unclaimed element. A batch therefore completes even when every helper is busy, and no
+    * element runs twice. Responses keep the order of the requests.
+    *
+    * Every participating thread reads under a single read_context, so it takes the chainbase read lock
+    * once for all the elements it runs instead of once per API call, unless the writer waits for it.
+    */
+   void json_rpc_plugin_impl::rpc_batch( const fc::variants& messages, vector< json_rpc_response >& responses )
+   {
+      const size_t count = messages.size();
+      responses.resize( count );
+
+      size_t helpers = _batch_threads.size() ? std::min< size_t >( _batch_parallelism - 1, count - 1 ) : 0;
+
+      if( helpers == 0 )
+      {
+         auto start = fc::time_point::now();
+         chainbase::read_context ctx;
+
+         for( size_t i = 0; i < count; ++i )
+         {
+            responses[i] = rpc( messages[i] );
+            ctx.yield();
+         }
+
+         report_read_context( ctx, start );
+         return;
+      }
+
+      struct batch_state
+      {
+         std::atomic< size_t >      next{ 0 };
+         size_t                     done = 0;
+         std::mutex                 mutex;
+         std::condition_variable    all_done;
+      };
+
+      // A helper that is scheduled after the batch finished claims no element and only touches the shared state
+      auto state = std::make_shared< batch_state >();
+      const fc::variants* msgs = &messages;
+      vector< json_rpc_response >* resps = &responses;
+
+      auto work = [this, state, count, msgs, resps]()
+      {
+         if( state->next >= count )
+            return;
+
+         auto start = fc::time_point::now();
+         chainbase::read_context ctx;
+
+         size_t i;
+         while( ( i = state->next++ ) < count )
+         {
+            (*resps)[i] = rpc( (*msgs)[i] );
+            ctx.yield();
+
+            std::lock_guard< std::mutex > guard( state->mutex );
+            if( ++state->done == count )
+               state->all_done.notify_one();
+         }
+
+         report_read_context( ctx, start );
+      };
+
+      for( size_t i = 0; i < helpers; ++i )
+         _batch_ios.post( work );
+
+      work();
+
+      std::unique_lock< std::mutex > lock( state->mutex );
+      state->all_done.wait( lock, [&]() { return state->done == count; } );
+   }
 }
 
 using detail::json_rpc_error;
@@ -410,6 +679,12 @@ void json_rpc_plugin::set_program_options( options_description& , options_descri
 {
    cfg.add_options()
       ("log-json-rpc", bpo::value< string >(), "json-rpc log directory name.")
+      ("rpc-batch-thread-pool-size", bpo::value< uint32_t >()->default_value( 8 ),
+         "Number of threads shared by all batch requests to run batch elements concurrently. 0 runs batches sequentially.")
+      ("rpc-batch-parallelism", bpo::value< uint32_t >()->default_value( 4 ),
+         "Maximum number of elements of a single batch request that run at the same time, including the calling thread.")
+      ("api-response-cache-mb", bpo::value< uint32_t >()->default_value( 64 ),
+         "Memory cap in MiB for cached responses of calls that can never change, such as reads of irreversible blocks. 0 disables the cache.")
       ;
 }
 
@@ -417,6 +692,11 @@ void json_rpc_plugin::plugin_initialize( const variables_map& options )
 {
    my->initialize();
 
+   my->_response_cache.set_capacity( size_t( options.at( "api-response-cache-mb" ).as< uint32_t >() ) * 1024 * 1024 );
+
+   my->_batch_parallelism = std::max< uint32_t >( options.at( "rpc-batch-parallelism" ).as< uint32_t >(), 1 );
+   my->start_batch_threads( options.at( "rpc-batch-thread-pool-size" ).as< uint32_t >() );
+
    if( options.count( "log-json-rpc" ) )
    {
       auto dir_name = options.at( "log-json-rpc" ).as< string >();
@@ -435,13 +715,21 @@ void json_rpc_plugin::plugin_startup()
    std::sort( my->_methods.begin(), my->_methods.end() );
 }
 
-void json_rpc_plugin::plugin_shutdown() {}
+void json_rpc_plugin::plugin_shutdown()
+{
+   my->stop_batch_threads();
+}
 
 void json_rpc_plugin::add_api_method( const string& api_name, const string& method_name, const api_method& api, const api_method_signature& sig )
 {
    my->add_api_method( api_name, method_name, api, sig );
 }
 
+void json_rpc_plugin::add_immutable_api_method( const string& api_name, const string& method_name, const api_immutable_predicate& is_immutable )
+{
+   my->add_immutable_api_method( api_name, method_name, is_immutable );
+}
+
 string json_rpc_plugin::call( const string& message )
 {
    STATSD_START_TIMER( "jsonrpc", "overhead", "call", 1.0f );
@@ -451,17 +739,22 @@ string json_rpc_plugin::call( const string& message )
 
       if( v.is_array() )
       {
-         vector< fc::variant > messages = v.as< vector< fc::variant > >();
+         const fc::variants& messages = v.get_array();
          vector< json_rpc_response > responses;
 
          if( messages.size() )
          {
-            responses.reserve( messages.size() );
+            my->rpc_batch( messages, responses );
 
-            for( auto& m : messages )
-               responses.push_back( my->rpc( m ) );
+            string result = "[";
+            for( size_t i = 0; i < responses.size(); ++i )
+            {
+               if( i ) result += ',';
+               detail::write_response( responses[i], result );
+            }
+            result += ']';
 
-            return fc::json::to_string( responses );
+            return result;
          }
          else
          {
@@ -473,7 +766,16 @@ string json_rpc_plugin::call( const string& message )
       }
       else
       {
-         return fc::json::to_string( my->rpc( v ) );
+         string result;
+         auto start = fc::time_point::now();
+         chainbase::read_context ctx;
+
+         detail::json_rpc_response response = my->rpc( v );
+         ctx.release();
+         detail::report_read_context( ctx, start );
+
+         detail::write_response( response, result );
+         return result;
       }
    }
    catch( fc::exception& e )
@@ -253,7 +253,7 @@ void p2p_plugin_impl::handle_transaction( const graphene::net::trx_message& trx_
       {
          shutdown_helper helper(*this, activeHandleTx, handleTxFinished);
 
-         chain.accept_transaction( trx_msg.trx );
+         chain.accept_transaction( trx_msg.trx, plugins::chain::p2p_transaction_write_priority );
 
       } FC_CAPTURE_AND_RETHROW( (trx_msg) )
    }
@@ -41,6 +41,8 @@ struct exp_rc_data
    virtual ~exp_rc_data();
 
    virtual void to_variant( fc::variant& v )const override;
+   virtual void to_binary( std::vector< char >& data )const override;
+   virtual std::string binary_type_name()const override;
 
    rc_block_info                          block_info;
    std::vector< rc_transaction_info >     tx_info;
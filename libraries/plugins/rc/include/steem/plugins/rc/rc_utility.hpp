@@ -2,7 +2,11 @@
 
 #include <steem/chain/util/rd_dynamics.hpp>
 
+#include <steem/plugins/rc/resource_count.hpp>
+
+#include <fc/int_array.hpp>
 #include <fc/reflect/reflect.hpp>
+#include <fc/uint128.hpp>
 
 namespace steem { namespace plugins { namespace rc {
 
@@ -29,6 +33,38 @@ int64_t compute_rc_cost_of_resource(
    int64_t resource_count,
    int64_t rc_regen );
 
+typedef fc::int_array< rc_resource_params, STEEM_NUM_RESOURCE_TYPES > rc_resource_param_array_type;
+
+/**
+ * Computes the RC cost of every resource type of a transaction or action in one pass, with the same results as
+ * calling compute_rc_cost_of_resource() per resource.
+ *
+ * The price numerator ((rc_regen * coeff_a) >> shift) + 1 only depends on rc_regen and the price curves, which
+ * rarely change between transactions, so it is kept for all resource types until either of them changes.
+ */
+class rc_cost_calculator
+{
+   public:
+      /**
+       * Scales resource_count by each resource unit and fills cost, returning the total cost.
+       * rc_regen must be positive.
+       */
+      int64_t compute_costs(
+         const rc_resource_param_array_type& params,
+         const resource_count_type& pools,
+         resource_count_type& resource_count,
+         int64_t rc_regen,
+         resource_count_type& cost );
+
+   private:
+      void update_numerators( const rc_resource_param_array_type& params, int64_t rc_regen );
+
+      bool                    _valid = false;
+      int64_t                 _rc_regen = 0;
+      rc_price_curve_params   _curves[ STEEM_NUM_RESOURCE_TYPES ];
+      fc::uint128_t           _numerators[ STEEM_NUM_RESOURCE_TYPES ];
+};
+
 } } } // steem::plugins::rc
 
 FC_REFLECT( steem::plugins::rc::rc_price_curve_params, (coeff_a)(coeff_b)(shift) )
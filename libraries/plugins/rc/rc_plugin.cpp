@@ -58,6 +58,7 @@ class rc_plugin_impl
 
       void on_pre_reindex( const reindex_notification& node );
       void on_post_reindex( const reindex_notification& note );
+      void on_pre_apply_block( const block_notification& note );
       void on_post_apply_block( const block_notification& note );
       //void on_pre_apply_transaction( const transaction_notification& note );
       void on_post_apply_transaction( const transaction_notification& note );
@@ -90,6 +91,13 @@ class rc_plugin_impl
       std::map< account_name_type, int64_t > _account_to_max_rc;
       uint32_t                      _enable_at_block = 1;
 
+      rc_cost_calculator            _cost_calculator;
+
+      /// Resources counted by on_post_apply_transaction for the block being applied, reused by on_post_apply_block
+      count_resources_result        _block_usage;
+      uint32_t                      _block_usage_transactions = 0;
+      bool                          _applying_block = false;
+
       std::shared_ptr< generic_custom_operation_interpreter< steem::plugins::rc::rc_plugin_operation > >
                                     _custom_operation_interpreter;
 
@@ -99,6 +107,7 @@ class rc_plugin_impl
 
       boost::signals2::connection   _pre_reindex_conn;
       boost::signals2::connection   _post_reindex_conn;
+      boost::signals2::connection   _pre_apply_block_conn;
       boost::signals2::connection   _post_apply_block_conn;
       boost::signals2::connection   _pre_apply_transaction_conn;
       boost::signals2::connection   _post_apply_transaction_conn;
@@ -410,6 +419,13 @@ void rc_plugin_impl::on_post_apply_transaction( const transaction_notification&
    // How many resources does the transaction use?
    count_resources( note.transaction, tx_info.usage );
 
+   if( _applying_block )
+   {
+      for( size_t i=0; i<STEEM_NUM_RESOURCE_TYPES; i++ )
+         _block_usage.resource_count[i] += tx_info.usage.resource_count[i];
+      ++_block_usage_transactions;
+   }
+
    // How many RC does this transaction cost?
    const rc_resource_param_object& params_obj = _db.get< rc_resource_param_object, by_id >( rc_resource_param_object::id_type() );
    const rc_pool_object& pool_obj = _db.get< rc_pool_object, by_id >( rc_pool_object::id_type() );
@@ -419,16 +435,8 @@ void rc_plugin_impl::on_post_apply_transaction( const transaction_notification&
    // When rc_regen is 0, everything is free
    if( rc_regen > 0 )
    {
-      for( size_t i=0; i<STEEM_NUM_RESOURCE_TYPES; i++ )
-      {
-         const rc_resource_params& params = params_obj.resource_param_array[i];
-         int64_t pool = pool_obj.pool_array[i];
-
-         // TODO:  Move this multiplication to resource_count.cpp
-         tx_info.usage.resource_count[i] *= int64_t( params.resource_dynamics_params.resource_unit );
-         tx_info.cost[i] = compute_rc_cost_of_resource( params.price_curve_params, pool, tx_info.usage.resource_count[i], rc_regen );
-         total_cost += tx_info.cost[i];
-      }
+      total_cost = _cost_calculator.compute_costs( params_obj.resource_param_array, pool_obj.pool_array,
+         tx_info.usage.resource_count, rc_regen, tx_info.cost );
    }
 
    tx_info.resource_user = get_resource_user( note.transaction );
@@ -472,8 +480,17 @@ struct block_extensions_count_resources_visitor
    void operator()( const T& ) {}
 };
 
+void rc_plugin_impl::on_pre_apply_block( const block_notification& note )
+{
+   _block_usage = count_resources_result();
+   _block_usage_transactions = 0;
+   _applying_block = true;
+}
+
 void rc_plugin_impl::on_post_apply_block( const block_notification& note )
 { try{
+   _applying_block = false;
+
    const dynamic_global_property_object& gpo = _db.get_dynamic_global_properties();
    if( before_first_block() )
    {
@@ -515,11 +532,19 @@ void rc_plugin_impl::on_post_apply_block( const block_notification& note )
       return;
    }
 
-   // How many resources did transactions use?
+   // How many resources did transactions use? They were counted as they were applied, unless some were
+   // skipped (i.e. before the first RC block).
    count_resources_result count;
-   for( const signed_transaction& tx : note.block.transactions )
+   if( _block_usage_transactions == note.block.transactions.size() )
    {
-      count_resources( tx, count );
+      count = _block_usage;
+   }
+   else
+   {
+      for( const signed_transaction& tx : note.block.transactions )
+      {
+         count_resources( tx, count );
+      }
    }
 
    block_extensions_count_resources_visitor ext_visitor( count );
@@ -1388,16 +1413,8 @@ void rc_plugin_impl::on_post_apply_optional_action( const optional_action_notifi
    // When rc_regen is 0, everything is free
    if( rc_regen > 0 )
    {
-      for( size_t i=0; i<STEEM_NUM_RESOURCE_TYPES; i++ )
-      {
-         const rc_resource_params& params = params_obj.resource_param_array[i];
-         int64_t pool = pool_obj.pool_array[i];
-
-         // TODO:  Move this multiplication to resource_count.cpp
-         opt_action_info.usage.resource_count[i] *= int64_t( params.resource_dynamics_params.resource_unit );
-         opt_action_info.cost[i] = compute_rc_cost_of_resource( params.price_curve_params, pool, opt_action_info.usage.resource_count[i], rc_regen );
-         total_cost += opt_action_info.cost[i];
-      }
+      total_cost = _cost_calculator.compute_costs( params_obj.resource_param_array, pool_obj.pool_array,
+         opt_action_info.usage.resource_count, rc_regen, opt_action_info.cost );
    }
 
    opt_action_info.resource_user = get_resource_user( note.action );
@@ -1479,6 +1496,8 @@ void rc_plugin::plugin_initialize( const boost::program_options::variables_map&
 
       chain::database& db = appbase::app().get_plugin< steem::plugins::chain::chain_plugin >().db();
 
+      my->_pre_apply_block_conn = db.add_pre_apply_block_handler( [&]( const block_notification& note )
+         { try { my->on_pre_apply_block( note ); } FC_LOG_AND_RETHROW() }, *this, 0 );
       my->_post_apply_block_conn = db.add_post_apply_block_handler( [&]( const block_notification& note )
          { try { my->on_post_apply_block( note ); } FC_LOG_AND_RETHROW() }, *this, 0 );
       //my->_pre_apply_transaction_conn = db.add_pre_apply_transaction_handler( [&]( const transaction_notification& note )
@@ -1565,6 +1584,7 @@ void rc_plugin::plugin_shutdown()
 {
    chain::util::disconnect_signal( my->_pre_reindex_conn );
    chain::util::disconnect_signal( my->_post_reindex_conn );
+   chain::util::disconnect_signal( my->_pre_apply_block_conn );
    chain::util::disconnect_signal( my->_post_apply_block_conn );
    // chain::util::disconnect_signal( my->_pre_apply_transaction_conn );
    chain::util::disconnect_signal( my->_post_apply_transaction_conn );
@@ -1598,6 +1618,16 @@ void exp_rc_data::to_variant( fc::variant& v )const
    fc::to_variant( *this, v );
 }
 
+void exp_rc_data::to_binary( std::vector< char >& data )const
+{
+   data = fc::raw::pack_to_vector( *this );
+}
+
+std::string exp_rc_data::binary_type_name()const
+{
+   return fc::get_typename< exp_rc_data >::name();
+}
+
 int64_t get_maximum_rc( const account_object& account, const rc_account_object& rc_account )
 {
    int64_t result = account.vesting_shares.amount.value;
@@ -51,4 +51,72 @@ int64_t compute_rc_cost_of_resource(
    return num_denom.to_uint64()+1;
 }
 
+void rc_cost_calculator::update_numerators( const rc_resource_param_array_type& params, int64_t rc_regen )
+{
+   bool changed = !_valid || (_rc_regen != rc_regen);
+
+   for( size_t i=0; i<STEEM_NUM_RESOURCE_TYPES && !changed; i++ )
+   {
+      const rc_price_curve_params& curve = params[i].price_curve_params;
+      changed = (curve.coeff_a != _curves[i].coeff_a) || (curve.coeff_b != _curves[i].coeff_b) || (curve.shift != _curves[i].shift);
+   }
+
+   if( !changed )
+      return;
+
+   for( size_t i=0; i<STEEM_NUM_RESOURCE_TYPES; i++ )
+   {
+      const rc_price_curve_params& curve = params[i].price_curve_params;
+      _curves[i] = curve;
+
+      // Same rounding as compute_rc_cost_of_resource()
+      uint128_t num = uint128_t( rc_regen );
+      num *= curve.coeff_a;
+      num >>= curve.shift;
+      num += 1;
+      _numerators[i] = num;
+   }
+
+   _rc_regen = rc_regen;
+   _valid = true;
+}
+
+int64_t rc_cost_calculator::compute_costs(
+   const rc_resource_param_array_type& params,
+   const resource_count_type& pools,
+   resource_count_type& resource_count,
+   int64_t rc_regen,
+   resource_count_type& cost )
+{
+   FC_ASSERT( rc_regen > 0 );
+
+   update_numerators( params, rc_regen );
+
+   int64_t total_cost = 0;
+
+   for( size_t i=0; i<STEEM_NUM_RESOURCE_TYPES; i++ )
+   {
+      int64_t count = resource_count[i] * int64_t( params[i].resource_dynamics_params.resource_unit );
+      resource_count[i] = count;
+
+      if( count == 0 )
+      {
+         cost[i] = 0;
+         continue;
+      }
+
+      uint128_t num = _numerators[i];
+      num *= uint64_t( count < 0 ? -count : count );
+
+      uint128_t denom = uint128_t( _curves[i].coeff_b );
+      denom += (pools[i] > 0) ? uint64_t( pools[i] ) : uint64_t( 0 );
+
+      int64_t c = int64_t( (num / denom).to_uint64() ) + 1;
+      cost[i] = count < 0 ? -c : c;
+      total_cost += cost[i];
+   }
+
+   return total_cost;
+}
+
 } } }
@@ -48,6 +48,13 @@ class api_stats_export_data_object
          fc::to_variant( *this, v );
       }
 
+      virtual void to_binary( std::vector< char >& data )const override
+      {
+         data = fc::raw::pack_to_vector( *this );
+      }
+
+      virtual std::string binary_type_name()const override;
+
       dynamic_global_property_object                        global_properties;
       std::vector< api_stats_transaction_data_object >      transaction_stats;
       uint64_t                                              free_memory = 0;
@@ -60,6 +67,11 @@ FC_REFLECT( steem::plugins::stats_export::detail::api_stats_export_data_object,
 
 namespace steem { namespace plugins { namespace stats_export { namespace detail {
 
+std::string api_stats_export_data_object::binary_type_name()const
+{
+   return fc::get_typename< api_stats_export_data_object >::name();
+}
+
 class stats_export_plugin_impl
 {
    public:
@@ -80,6 +80,9 @@ public:
     //! Records a timing for a key, at a given frequency
     inline void timing(const std::string &key, const unsigned int ms, const float frequency = 1.0f) const noexcept;
 
+    //! Records `samples' timings of the same value for a key as one message, sent unconditionally at the rate 1/samples
+    inline void timingSamples(const std::string &key, const unsigned int ms, const uint64_t samples) const noexcept;
+
     //! Send a value for a key, according to its type, at a given frequency
     void send(const std::string &key, const int value, const std::string &type, const float frequency = 1.0f) const
         noexcept;
@@ -132,6 +135,17 @@ void StatsdClient::timing(const std::string &key, const unsigned int ms, const f
     return send(key, ms, "ms", frequency);
 }
 
+void StatsdClient::timingSamples(const std::string &key, const unsigned int ms, const uint64_t samples) const noexcept {
+    if (samples <= 1) {
+        return timing(key, ms);
+    }
+
+    // The server counts the message as 1/rate samples, so the rate needs more digits than send() gives it
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer), "%s%s:%u|ms|@%.9g", m_prefix.c_str(), key.c_str(), ms, 1.0 / samples);
+    m_sender.send(buffer);
+}
+
 void StatsdClient::send(const std::string &key, const int value, const std::string &type, const float frequency) const
     noexcept {
     const auto isFrequencyOne = [](const float frequency) noexcept {
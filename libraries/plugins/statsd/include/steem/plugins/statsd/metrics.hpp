@@ -0,0 +1,262 @@
+#pragma once
+#include <steem/chain/util/latency_histogram.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace steem { namespace plugins { namespace statsd {
+
+enum class metric_type : uint8_t
+{
+   counter,
+   gauge,
+   timer
+};
+
+/**
+ * A metric aggregated in process and flushed to statsd on an interval.
+ *
+ * Counters are striped over cache lines so that threads recording the same counter do not contend, gauges keep
+ * the last value set and timers accumulate a latency histogram (in microseconds). Recording never locks or
+ * allocates, metrics filtered out by the white/blacklist are interned like the others but ignore samples.
+ */
+class metric
+{
+   public:
+      static const uint32_t COUNTER_STRIPES = 16;
+
+      metric( const std::string& ns, const std::string& stat, const std::string& key, metric_type type, bool enabled ) :
+         _ns( ns ), _stat( stat ), _key( key ), _type( type ), _enabled( enabled )
+      {
+         for( auto& s : _stripes )
+            s.value.store( 0, std::memory_order_relaxed );
+
+         if( _type == metric_type::timer )
+            _histogram.reset( new steem::chain::util::latency_histogram() );
+      }
+
+      void count( int64_t delta )
+      {
+         if( !_enabled ) return;
+         _stripes[ thread_stripe() ].value.fetch_add( delta, std::memory_order_relaxed );
+      }
+
+      void gauge( uint64_t value )
+      {
+         if( !_enabled ) return;
+         _gauge.store( value, std::memory_order_relaxed );
+         _gauge_set.store( true, std::memory_order_release );
+      }
+
+      void timing( uint64_t us )
+      {
+         if( !_enabled || !_histogram ) return;
+         _histogram->record( us );
+      }
+
+      /// Collects the counter delta since the previous call
+      int64_t take_count()
+      {
+         int64_t total = 0;
+         for( auto& s : _stripes )
+            total += s.value.exchange( 0, std::memory_order_relaxed );
+         return total;
+      }
+
+      /// Returns true and the last value if the gauge was set since the previous call
+      bool take_gauge( uint64_t& value )
+      {
+         if( !_gauge_set.exchange( false, std::memory_order_acquire ) )
+            return false;
+         value = _gauge.load( std::memory_order_relaxed );
+         return true;
+      }
+
+      /// Summarizes the timings since the previous call, optionally copying out their histogram buckets
+      steem::chain::util::latency_summary take_timing( std::vector< uint64_t >* bucket_counts = nullptr )
+      {
+         return _histogram ? _histogram->summarize( true, bucket_counts ) : steem::chain::util::latency_summary();
+      }
+
+      template< typename NS, typename Stat, typename Key >
+      bool matches( const NS& ns, const Stat& stat, const Key& key, metric_type type )const
+      {
+         return _type == type && equals( _key, key ) && equals( _stat, stat ) && equals( _ns, ns );
+      }
+
+      const std::string& ns()const      { return _ns; }
+      const std::string& stat()const    { return _stat; }
+      const std::string& key()const     { return _key; }
+      metric_type        type()const    { return _type; }
+      bool               enabled()const { return _enabled; }
+
+   private:
+      static bool equals( const std::string& a, const std::string& b ) { return a == b; }
+      static bool equals( const std::string& a, const char* b ) { return std::strcmp( a.c_str(), b ) == 0; }
+
+      static uint32_t thread_stripe()
+      {
+         static std::atomic< uint32_t > next_stripe( 0 );
+         thread_local uint32_t stripe = next_stripe.fetch_add( 1, std::memory_order_relaxed ) % COUNTER_STRIPES;
+         return stripe;
+      }
+
+      struct counter_stripe
+      {
+         std::atomic< int64_t > value;
+         char                   padding[ 64 - sizeof( std::atomic< int64_t > ) ];
+      };
+
+      const std::string                                       _ns;
+      const std::string                                       _stat;
+      const std::string                                       _key;
+      const metric_type                                       _type;
+      const bool                                              _enabled;
+
+      counter_stripe                                          _stripes[ COUNTER_STRIPES ];
+      std::atomic< uint64_t >                                 _gauge = { 0 };
+      std::atomic< bool >                                     _gauge_set = { false };
+      std::unique_ptr< steem::chain::util::latency_histogram > _histogram;
+};
+
+/**
+ * Owns every metric ever recorded. Metrics are never removed, so pointers handed out stay valid for the
+ * lifetime of the process and call sites may cache them.
+ */
+class metric_registry
+{
+   public:
+      typedef std::function< bool( const std::string&, const std::string& ) > filter_type;
+
+      template< typename NS, typename Stat, typename Key >
+      metric* get( const NS& ns, const Stat& stat, const Key& key, metric_type type )
+      {
+         {
+            std::shared_lock< std::shared_timed_mutex > lock( _mutex );
+            auto itr = _metrics.find( std::forward_as_tuple( ns, stat, key, type ) );
+            if( itr != _metrics.end() )
+               return itr->second.get();
+         }
+
+         std::unique_lock< std::shared_timed_mutex > lock( _mutex );
+         auto itr = _metrics.find( std::forward_as_tuple( ns, stat, key, type ) );
+         if( itr != _metrics.end() )
+            return itr->second.get();
+
+         std::string ns_str( ns ), stat_str( stat ), key_str( key );
+         bool enabled = !_filter || _filter( ns_str, stat_str );
+         std::unique_ptr< metric > m( new metric( ns_str, stat_str, key_str, type, enabled ) );
+         metric* result = m.get();
+         _metrics.emplace( std::make_tuple( ns_str, stat_str, key_str, type ), std::move( m ) );
+         return result;
+      }
+
+      /// The filter is applied to metrics interned afterwards, so it must be set before the first sample.
+      void set_filter( filter_type filter )
+      {
+         std::unique_lock< std::shared_timed_mutex > lock( _mutex );
+         _filter = filter;
+      }
+
+      template< typename Lambda >
+      void for_each( Lambda&& l )
+      {
+         std::shared_lock< std::shared_timed_mutex > lock( _mutex );
+         for( auto& entry : _metrics )
+            l( *entry.second );
+      }
+
+   private:
+      typedef std::tuple< std::string, std::string, std::string, metric_type > metric_id;
+
+      std::shared_timed_mutex                                      _mutex;
+      std::map< metric_id, std::unique_ptr< metric >, std::less<> > _metrics;
+      filter_type                                                  _filter;
+};
+
+metric_registry& get_metric_registry();
+
+/**
+ * Per call site cache of the metrics recorded there. Sites with constant names resolve their metric once and keep
+ * hitting the first one. Sites with dynamic keys (API methods, write lanes) additionally keep a hashed slot array,
+ * allocated when the second key shows up, so they only fall back to the registry when two keys share a slot.
+ */
+class metric_site
+{
+   public:
+      static const uint32_t KEY_SLOTS = 256;
+
+      ~metric_site()
+      {
+         delete[] _slots.load( std::memory_order_relaxed );
+      }
+
+      template< typename NS, typename Stat, typename Key >
+      metric& get( const NS& ns, const Stat& stat, const Key& key, metric_type type )
+      {
+         metric* m = _first.load( std::memory_order_acquire );
+         if( m != nullptr && m->matches( ns, stat, key, type ) )
+            return *m;
+
+         if( m == nullptr )
+         {
+            m = get_metric_registry().get( ns, stat, key, type );
+            _first.store( m, std::memory_order_release );
+            return *m;
+         }
+
+         auto& slot = slots()[ hash( hash( hash( FNV_OFFSET, ns ), stat ), key ) % KEY_SLOTS ];
+         m = slot.load( std::memory_order_acquire );
+         if( m == nullptr || !m->matches( ns, stat, key, type ) )
+         {
+            m = get_metric_registry().get( ns, stat, key, type );
+            slot.store( m, std::memory_order_release );
+         }
+         return *m;
+      }
+
+   private:
+      static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+      static const uint64_t FNV_PRIME  = 1099511628211ull;
+
+      /// FNV-1a over the characters and the terminating zero, so ("ab","c") and ("a","bc") differ
+      static uint64_t hash( uint64_t h, const char* s )
+      {
+         do
+         {
+            h = ( h ^ uint8_t( *s ) ) * FNV_PRIME;
+         } while( *s++ );
+         return h;
+      }
+
+      static uint64_t hash( uint64_t h, const std::string& s ) { return hash( h, s.c_str() ); }
+
+      std::atomic< metric* >* slots()
+      {
+         std::atomic< metric* >* s = _slots.load( std::memory_order_acquire );
+         if( s != nullptr )
+            return s;
+
+         std::unique_ptr< std::atomic< metric* >[] > fresh( new std::atomic< metric* >[ KEY_SLOTS ] );
+         for( uint32_t i = 0; i < KEY_SLOTS; ++i )
+            fresh[i].store( nullptr, std::memory_order_relaxed );
+
+         // Another thread may have allocated the slots meanwhile, its array wins
+         if( _slots.compare_exchange_strong( s, fresh.get(), std::memory_order_acq_rel ) )
+            s = fresh.release();
+         return s;
+      }
+
+      std::atomic< metric* >                 _first = { nullptr };
+      std::atomic< std::atomic< metric* >* > _slots = { nullptr };
+};
+
+} } } // steem::plugins::statsd
@@ -4,6 +4,8 @@
 
 #include <boost/config.hpp>
 
+#include <functional>
+
 #define STEEM_STATSD_PLUGIN_NAME "statsd"
 
 namespace steem { namespace plugins { namespace statsd {
@@ -40,6 +42,13 @@ class statsd_plugin : public appbase::plugin< statsd_plugin >
       void gauge(     const std::string& ns, const std::string& stat, const std::string& key, const uint64_t value, const float frequency = 1.0f ) const noexcept;
       void timing(    const std::string& ns, const std::string& stat, const std::string& key, const uint32_t ms,    const float frequency = 1.0f ) const noexcept;
 
+      /**
+       * Runs `callback' on the flush thread right before every flush, for metrics that are too costly to collect
+       * where they are recorded. Once remove_flush_callback() returns, the callback is not running and never will.
+       */
+      uint32_t add_flush_callback( std::function< void() > callback );
+      void remove_flush_callback( uint32_t id );
+
    private:
       std::unique_ptr< detail::statsd_plugin_impl > my;
 };
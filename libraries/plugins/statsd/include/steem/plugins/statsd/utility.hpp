@@ -1,12 +1,16 @@
 #pragma once
 #include <steem/plugins/statsd/statsd_plugin.hpp>
+#include <steem/plugins/statsd/metrics.hpp>
 
 #include <fc/optional.hpp>
 #include <fc/time.hpp>
 
+#include <algorithm>
+
 namespace steem { namespace plugins { namespace statsd { namespace util {
 
 using steem::plugins::statsd::statsd_plugin;
+using steem::plugins::statsd::metric;
 
 bool statsd_enabled();
 const statsd_plugin& get_statsd();
@@ -14,12 +18,8 @@ const statsd_plugin& get_statsd();
 class statsd_timer_helper
 {
    public:
-      statsd_timer_helper( const std::string& ns, const std::string& stat, const std::string& key, float freq, const statsd_plugin& statsd ) :
-         _ns( ns ),
-         _stat( stat ),
-         _key( key ),
-         _freq( freq ),
-         _statsd( statsd )
+      statsd_timer_helper( metric& timer ) :
+         _timer( &timer )
       {
          _start = fc::time_point::now();
       }
@@ -34,18 +34,14 @@ class statsd_timer_helper
          fc::time_point stop = fc::time_point::now();
          if( !_recorded )
          {
-            _statsd.timing( _ns, _stat, _key, (stop - _start).count() / 1000 , _freq );
+            _timer->timing( (stop - _start).count() );
             _recorded = true;
          }
       }
 
    private:
-      std::string          _ns;
-      std::string          _stat;
-      std::string          _key;
-      float                _freq = 1.0f;
+      metric*              _timer;
       fc::time_point       _start;
-      const statsd_plugin& _statsd;
       bool                 _recorded = false;
 };
 
@@ -54,47 +50,47 @@ inline uint32_t timing_helper( const fc::time_point& time ) { return time.time_s
 inline uint32_t timing_helper( const fc::time_point_sec& time ) { return time.sec_since_epoch() * 1000; }
 inline uint32_t timing_helper( uint32_t time ) { return time; }
 
+// Timers are aggregated in microseconds, negative durations (i.e. clock skew) are recorded as zero
+inline uint64_t timing_micros( const fc::microseconds& time ) { return std::max< int64_t >( time.count(), 0 ); }
+inline uint64_t timing_micros( const fc::time_point& time ) { return std::max< int64_t >( time.time_since_epoch().count(), 0 ); }
+inline uint64_t timing_micros( const fc::time_point_sec& time ) { return uint64_t( time.sec_since_epoch() ) * 1000000; }
+inline uint64_t timing_micros( uint32_t ms ) { return uint64_t( ms ) * 1000; }
+
 } } } } // steem::plugins::statsd::util
 
-#define STATSD_INCREMENT( NAMESPACE, STAT, KEY, FREQ )   \
-if( steem::plugins::statsd::util::statsd_enabled() )     \
-{                                                        \
-   steem::plugins::statsd::util::get_statsd().increment( \
-      NAMESPACE, STAT, KEY, FREQ                         \
-   );                                                    \
+/*
+ * Samples are aggregated in process and flushed by the statsd plugin on an interval (see statsd-flush-interval-ms),
+ * so FREQ is only kept for compatibility, every sample is recorded. Each call site caches its interned metric.
+ */
+
+#define STATSD_RECORD( NAMESPACE, STAT, KEY, TYPE, ACTION )                                    \
+if( steem::plugins::statsd::util::statsd_enabled() )                                           \
+{                                                                                              \
+   static steem::plugins::statsd::metric_site statsd_site;                                     \
+   statsd_site.get( NAMESPACE, STAT, KEY, steem::plugins::statsd::metric_type::TYPE ).ACTION;  \
 }
 
+#define STATSD_INCREMENT( NAMESPACE, STAT, KEY, FREQ )   \
+   STATSD_RECORD( NAMESPACE, STAT, KEY, counter, count( 1 ) )
+
 #define STATSD_DECREMENT( NAMESPACE, STAT, KEY, FREQ )   \
-if( steem::plugins::statsd::util::statsd_enabled() )     \
-{                                                        \
-   steem::plugins::statsd::util::get_statsd().decrement( \
-      NAMESPACE, STAT, KEY, FREQ                         \
-   );                                                    \
-}
+   STATSD_RECORD( NAMESPACE, STAT, KEY, counter, count( -1 ) )
 
 #define STATSD_COUNT( NAMESPACE, STAT, KEY, VAL, FREQ )  \
-if( steem::plugins::statsd::util::statsd_enabled() )     \
-{                                                        \
-   steem::plugins::statsd::util::get_statsd().count(     \
-      NAMESPACE, STAT, KEY, VAL, FREQ                    \
-   );                                                    \
-}
+   STATSD_RECORD( NAMESPACE, STAT, KEY, counter, count( VAL ) )
 
 #define STATSD_GAUGE( NAMESPACE, STAT, KEY, VAL, FREQ )  \
-if( steem::plugins::statsd::util::statsd_enabled() )     \
-{                                                        \
-   steem::plugins::statsd::util::get_statsd().gauge(     \
-      NAMESPACE, STAT, KEY, VAL, FREQ                    \
-   );                                                    \
-}
+   STATSD_RECORD( NAMESPACE, STAT, KEY, gauge, gauge( VAL ) )
 
 // You can only have one statsd timer in the current scope at a time
 #define STATSD_START_TIMER( NAMESPACE, STAT, KEY, FREQ )                         \
 fc::optional< steem::plugins::statsd::util::statsd_timer_helper > statsd_timer;  \
 if( steem::plugins::statsd::util::statsd_enabled() )                             \
 {                                                                                \
+   static steem::plugins::statsd::metric_site statsd_timer_site;                 \
    statsd_timer = steem::plugins::statsd::util::statsd_timer_helper(             \
-      NAMESPACE, STAT, KEY, FREQ, steem::plugins::statsd::util::get_statsd()     \
+      statsd_timer_site.get( NAMESPACE, STAT, KEY,                               \
+         steem::plugins::statsd::metric_type::timer )                            \
    );                                                                            \
 }
 
@@ -102,11 +98,4 @@ if( steem::plugins::statsd::util::statsd_enabled() )
    statsd_timer.reset();
 
 #define STATSD_TIMER( NAMESPACE, STAT, KEY, VAL, FREQ )  \
-if( steem::plugins::statsd::util::statsd_enabled() )     \
-{                                                        \
-   steem::plugins::statsd::util::get_statsd().timing(    \
-      NAMESPACE, STAT, KEY,                              \
-      steem::plugins::statsd::util::timing_helper( VAL ),\
-      FREQ                                               \
-   );                                                    \
-}
+   STATSD_RECORD( NAMESPACE, STAT, KEY, timer, timing( steem::plugins::statsd::util::timing_micros( VAL ) ) )
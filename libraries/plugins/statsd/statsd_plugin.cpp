@@ -1,10 +1,15 @@
 #include <steem/plugins/statsd/statsd_plugin.hpp>
+#include <steem/plugins/statsd/metrics.hpp>
 
 #include <fc/network/resolve.hpp>
 
 #include <boost/algorithm/string.hpp>
 
+#include <condition_variable>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #include "StatsdClient.hpp"
 
@@ -30,26 +35,34 @@ namespace detail
          void start();
          void shutdown();
 
-         bool filter_by_namespace( const std::string& ns, const std::string& stat ) const;
+         void flush_thread_main();
+         void flush() const;
 
-         void increment( const std::string& ns, const std::string& stat, const std::string& key,                       const float frequency ) const noexcept;
-         void decrement( const std::string& ns, const std::string& stat, const std::string& key,                       const float frequency ) const noexcept;
-         void count(     const std::string& ns, const std::string& stat, const std::string& key, const int64_t delta,  const float frequency ) const noexcept;
-         void gauge(     const std::string& ns, const std::string& stat, const std::string& key, const uint64_t value, const float frequency ) const noexcept;
-         void timing(    const std::string& ns, const std::string& stat, const std::string& key, const uint32_t ms,    const float frequency ) const noexcept;
+         bool filter_by_namespace( const std::string& ns, const std::string& stat ) const;
 
 
          bool                                               _filter_stats = false;
          bool                                               _blacklist    = false;
          bool                                               _started      = false;
+         bool                                               _timer_samples = true;
 
          std::set< std::string >                            _stat_namespaces;
          std::map< std::string, std::set< std::string > >   _stat_list;
 
          fc::optional< fc::ip::endpoint >                   _statsd_endpoint;
          uint32_t                                           _statsd_batchsize = 1;
+         uint32_t                                           _flush_interval_ms = 1000;
 
          std::unique_ptr< StatsdClient >                    _statsd;
+
+         /// Guarded by _flush_mutex, which the flush thread holds while flushing
+         std::map< uint32_t, std::function< void() > >      _flush_callbacks;
+         uint32_t                                           _next_flush_callback = 0;
+
+         std::thread                                        _flush_thread;
+         std::mutex                                         _flush_mutex;
+         std::condition_variable                            _flush_cv;
+         bool                                               _stopping     = false;
    };
 
    void statsd_plugin_impl::start()
@@ -69,14 +82,109 @@ namespace detail
       }
 
       _statsd.reset( new StatsdClient( host, port, "steemd.", _statsd_batchsize ) );
+      _flush_thread = std::thread( [this]() { flush_thread_main(); } );
       _started = true;
    }
 
    void statsd_plugin_impl::shutdown()
    {
+      if( _flush_thread.joinable() )
+      {
+         {
+            std::lock_guard< std::mutex > lock( _flush_mutex );
+            _stopping = true;
+         }
+         _flush_cv.notify_all();
+         _flush_thread.join();
+      }
+
       _statsd.reset();
    }
 
+   void statsd_plugin_impl::flush_thread_main()
+   {
+      std::unique_lock< std::mutex > lock( _flush_mutex );
+      while( true )
+      {
+         _flush_cv.wait_for( lock, std::chrono::milliseconds( _flush_interval_ms ), [this]() { return _stopping; } );
+
+         // Samples recorded since the last interval are sent on shutdown as well
+         flush();
+
+         if( _stopping )
+            break;
+      }
+   }
+
+   /**
+    * Sends the samples aggregated since the previous flush, after the flush callbacks have recorded theirs. Counters
+    * are sent as their delta, gauges as their last value and timers as gauges of their percentiles and maximum
+    * (in ms) along with a counter of samples.
+    *
+    * Unless statsd-timer-samples is off, timers are also sent with the timer type as before, at histogram bucket
+    * precision, so statsd aggregates relying on it keep working. Each non-empty bucket is one message carrying
+    * the sample rate 1/n, which statsd counts as n timings, so the traffic does not grow with the timing rate.
+    */
+   void statsd_plugin_impl::flush() const
+   {
+      for( const auto& callback : _flush_callbacks )
+         callback.second();
+
+      std::vector< uint64_t > buckets;
+
+      get_metric_registry().for_each( [this, &buckets]( metric& m )
+      {
+         if( !m.enabled() )
+            return;
+
+         std::string name = compose_key( m.ns(), m.stat(), m.key() );
+
+         switch( m.type() )
+         {
+            case metric_type::counter:
+            {
+               int64_t delta = m.take_count();
+               if( delta != 0 )
+                  _statsd->count( name, delta );
+               break;
+            }
+            case metric_type::gauge:
+            {
+               uint64_t value = 0;
+               if( m.take_gauge( value ) )
+                  _statsd->gauge( name, value );
+               break;
+            }
+            case metric_type::timer:
+            {
+               auto summary = m.take_timing( _timer_samples ? &buckets : nullptr );
+               if( summary.count == 0 )
+                  break;
+
+               _statsd->count( name + ".count", summary.count );
+               _statsd->gauge( name + ".p50", summary.p50 / 1000 );
+               _statsd->gauge( name + ".p90", summary.p90 / 1000 );
+               _statsd->gauge( name + ".p99", summary.p99 / 1000 );
+               _statsd->gauge( name + ".max", summary.max / 1000 );
+
+               if( _timer_samples )
+               {
+                  for( uint32_t i = 0; i < buckets.size(); ++i )
+                  {
+                     if( buckets[i] == 0 )
+                        continue;
+
+                     // Buckets hold lower bounds, the exact maximum caps them like it caps the percentiles
+                     uint32_t ms = std::min( steem::chain::util::latency_histogram::bucket_value( i ), summary.max ) / 1000;
+                     _statsd->timingSamples( name, ms, buckets[i] );
+                  }
+               }
+               break;
+            }
+         }
+      });
+   }
+
    bool statsd_plugin_impl::filter_by_namespace( const std::string& ns, const std::string& stat ) const
    {
       if( !_filter_stats )
@@ -105,36 +213,6 @@ namespace detail
 
       return _blacklist != found;
    }
-
-   void statsd_plugin_impl::increment( const std::string& ns, const std::string& stat, const std::string& key, const float frequency ) const noexcept
-   {
-      if( !filter_by_namespace( ns, stat ) ) return;
-      _statsd->increment( compose_key( ns, stat, key ), frequency );
-   }
-
-   void statsd_plugin_impl::decrement( const std::string& ns, const std::string& stat, const std::string& key, const float frequency ) const noexcept
-   {
-      if( !filter_by_namespace( ns, stat ) ) return;
-      _statsd->decrement( compose_key( ns, stat, key ), frequency );
-   }
-
-   void statsd_plugin_impl::count( const std::string& ns, const std::string& stat, const std::string& key, const int64_t delta, const float frequency ) const noexcept
-   {
-      if( !filter_by_namespace( ns, stat ) ) return;
-      _statsd->count( compose_key( ns, stat, key ), delta, frequency );
-   }
-
-   void statsd_plugin_impl::gauge( const std::string& ns, const std::string& stat, const std::string& key, const uint64_t value, const float frequency ) const noexcept
-   {
-      if( !filter_by_namespace( ns, stat ) ) return;
-      _statsd->gauge( compose_key( ns, stat, key ), value, frequency );
-   }
-
-   void statsd_plugin_impl::timing( const std::string& ns, const std::string& stat, const std::string& key, const uint32_t ms, const float frequency ) const noexcept
-   {
-      if( !filter_by_namespace( ns, stat ) ) return;
-      _statsd->timing( compose_key( ns, stat, key ), ms, frequency );
-   }
 }
 
 statsd_plugin::statsd_plugin() : my( new detail::statsd_plugin_impl() ) {}
@@ -148,6 +226,8 @@ void statsd_plugin::set_program_options( options_description& cli, options_descr
    cfg.add_options()
       ("statsd-endpoint", bpo::value< std::string >(), "Endpoint to send statsd messages to.")
       ("statsd-batchsize", bpo::value< uint32_t >()->default_value( 1 ), "Size to batch statsd messages." )
+      ("statsd-flush-interval-ms", bpo::value< uint32_t >()->default_value( 1000 ), "Interval in milliseconds at which aggregated statistics are sent." )
+      ("statsd-timer-samples", bpo::value< bool >()->default_value( true ), "Also send timers with the statsd timer type (|ms), one sampled message per histogram bucket, next to their percentile gauges." )
       ("statsd-whitelist", bpo::value< vector< std::string > >()->composing(), "Whitelist of statistics to capture.")
       ("statsd-blacklist", bpo::value< vector< std::string > >()->composing(), "Blacklist of statistics to capture.");
 }
@@ -163,6 +243,14 @@ void statsd_plugin::plugin_initialize( const boost::program_options::variables_m
       ilog( "Configured statsd to send to ${ep}", ("ep", endpoints[0]) );
    }
 
+   if( options.count( "statsd-batchsize" ) )
+      my->_statsd_batchsize = options.at( "statsd-batchsize" ).as< uint32_t >();
+
+   my->_flush_interval_ms = options.at( "statsd-flush-interval-ms" ).as< uint32_t >();
+   FC_ASSERT( my->_flush_interval_ms > 0, "statsd-flush-interval-ms must be positive" );
+
+   my->_timer_samples = options.at( "statsd-timer-samples" ).as< bool >();
+
    if( options.count( "statsd-whitelist" ) )
    {
       my->_filter_stats = true;
@@ -218,6 +306,11 @@ void statsd_plugin::plugin_initialize( const boost::program_options::variables_m
          }
       }
    }
+
+   get_metric_registry().set_filter( [this]( const std::string& ns, const std::string& stat )
+   {
+      return my->filter_by_namespace( ns, stat );
+   });
 }
 
 void statsd_plugin::plugin_startup()
@@ -237,27 +330,41 @@ void statsd_plugin::start_logging()
 
 void statsd_plugin::increment( const std::string& ns, const std::string& stat, const std::string& key, const float frequency ) const noexcept
 {
-   my->increment( ns, stat, key, frequency );
+   get_metric_registry().get( ns, stat, key, metric_type::counter )->count( 1 );
 }
 
 void statsd_plugin::decrement( const std::string& ns, const std::string& stat, const std::string& key, const float frequency ) const noexcept
 {
-   my->decrement( ns, stat, key, frequency );
+   get_metric_registry().get( ns, stat, key, metric_type::counter )->count( -1 );
 }
 
 void statsd_plugin::count( const std::string& ns, const std::string& stat, const std::string& key, const int64_t delta, const float frequency ) const noexcept
 {
-   my->count( ns, stat, key, delta, frequency );
+   get_metric_registry().get( ns, stat, key, metric_type::counter )->count( delta );
 }
 
 void statsd_plugin::gauge( const std::string& ns, const std::string& stat, const std::string& key, const uint64_t value, const float frequency ) const noexcept
 {
-   my->gauge( ns, stat, key, value, frequency );
+   get_metric_registry().get( ns, stat, key, metric_type::gauge )->gauge( value );
 }
 
 void statsd_plugin::timing( const std::string& ns, const std::string& stat, const std::string& key, const uint32_t ms, const float frequency ) const noexcept
 {
-   my->timing( ns, stat, key, ms, frequency );
+   get_metric_registry().get( ns, stat, key, metric_type::timer )->timing( uint64_t( ms ) * 1000 );
+}
+
+uint32_t statsd_plugin::add_flush_callback( std::function< void() > callback )
+{
+   std::lock_guard< std::mutex > lock( my->_flush_mutex );
+   uint32_t id = my->_next_flush_callback++;
+   my->_flush_callbacks[ id ] = std::move( callback );
+   return id;
+}
+
+void statsd_plugin::remove_flush_callback( uint32_t id )
+{
+   std::lock_guard< std::mutex > lock( my->_flush_mutex );
+   my->_flush_callbacks.erase( id );
 }
 
 } } } // steem::plugins::statsd
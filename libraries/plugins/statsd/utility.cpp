@@ -1,6 +1,14 @@
 #include <steem/plugins/statsd/utility.hpp>
 
-namespace steem { namespace plugins{ namespace statsd { namespace util {
+namespace steem { namespace plugins{ namespace statsd {
+
+metric_registry& get_metric_registry()
+{
+   static metric_registry registry;
+   return registry;
+}
+
+namespace util {
 
 bool statsd_enabled()
 {
@@ -14,4 +22,4 @@ const statsd_plugin& get_statsd()
    return statsd;
 }
 
-} } } } // steem::plugins::statsd::util
\ No newline at end of file
+} } } } // steem::plugins::statsd::util
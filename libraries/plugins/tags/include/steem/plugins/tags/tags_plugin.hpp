@@ -14,6 +14,7 @@ using namespace appbase;
 using chainbase::object;
 using chainbase::oid;
 using chainbase::allocator;
+using chainbase::t_vector;
 
 //
 // Plugins should #define their SPACE_ID's so plugins with
@@ -42,7 +43,8 @@ enum
    tag_object_type              = ( STEEM_TAG_SPACE_ID << 8 ),
    tag_stats_object_type        = ( STEEM_TAG_SPACE_ID << 8 ) + 1,
    peer_stats_object_type       = ( STEEM_TAG_SPACE_ID << 8 ) + 2,
-   author_tag_stats_object_type = ( STEEM_TAG_SPACE_ID << 8 ) + 3
+   author_tag_stats_object_type = ( STEEM_TAG_SPACE_ID << 8 ) + 3,
+   tag_feed_object_type         = ( STEEM_TAG_SPACE_ID << 8 ) + 4
 };
 
 namespace detail { class tags_plugin_impl; }
@@ -330,6 +332,65 @@ typedef multi_index_container<
   allocator< author_tag_stats_object >
 > author_tag_stats_index;
 
+/**
+ *  The top level post orderings of tag_index that are kept precomputed per tag.
+ */
+enum tag_feed_type
+{
+   trending_feed,
+   hot_feed,
+   created_feed,
+   promoted_feed,
+   tag_feed_type_count
+};
+
+/**
+ *  Holds the head of one top level post ordering of a tag, i.e. the comments the corresponding
+ *  get_discussions_by_* call walks tag_index for, with the posts that call would filter out already
+ *  dropped. The plugin refreshes it whenever a tag_object in the tag changes, so the list is always
+ *  a prefix of what the index walk returns. When complete is set the list holds every qualifying
+ *  post in the tag, otherwise there may be more past its end.
+ */
+class tag_feed_object : public object< tag_feed_object_type, tag_feed_object >
+{
+   STEEM_STD_ALLOCATOR_CONSTRUCTOR( tag_feed_object );
+
+   public:
+      typedef t_vector< comment_id_type > t_comments;
+
+      template< typename Constructor, typename Allocator >
+      tag_feed_object( Constructor&& c, allocator< Allocator > a )
+      :comments( a )
+      {
+         c( *this );
+      }
+
+      id_type           id;
+
+      tag_name_type     tag;
+      tag_feed_type     type = trending_feed;
+      t_comments        comments;
+      bool              complete = false;
+};
+
+typedef oid< tag_feed_object > tag_feed_id_type;
+
+struct by_tag_type;
+
+typedef multi_index_container<
+   tag_feed_object,
+   indexed_by<
+      ordered_unique< tag< by_id >, member< tag_feed_object, tag_feed_id_type, &tag_feed_object::id > >,
+      ordered_unique< tag< by_tag_type >,
+         composite_key< tag_feed_object,
+            member< tag_feed_object, tag_name_type, &tag_feed_object::tag >,
+            member< tag_feed_object, tag_feed_type, &tag_feed_object::type >
+         >
+      >
+   >,
+   allocator< tag_feed_object >
+> tag_feed_index;
+
 /**
  * Used to parse the metadata from the comment json_meta field.
  */
@@ -396,3 +457,8 @@ FC_REFLECT( steem::plugins::tags::comment_metadata, (tags) );
 
 FC_REFLECT( steem::plugins::tags::author_tag_stats_object, (id)(author)(tag)(total_posts)(total_rewards) )
 CHAINBASE_SET_INDEX_TYPE( steem::plugins::tags::author_tag_stats_object, steem::plugins::tags::author_tag_stats_index )
+
+FC_REFLECT_ENUM( steem::plugins::tags::tag_feed_type, (trending_feed)(hot_feed)(created_feed)(promoted_feed)(tag_feed_type_count) )
+
+FC_REFLECT( steem::plugins::tags::tag_feed_object, (id)(tag)(type)(comments)(complete) )
+CHAINBASE_SET_INDEX_TYPE( steem::plugins::tags::tag_feed_object, steem::plugins::tags::tag_feed_index )
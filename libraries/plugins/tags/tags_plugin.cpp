@@ -52,6 +52,12 @@ namespace detail {
 
 using namespace steem::protocol;
 
+/// Masks of tag_feed_type bits, telling update_feeds which orderings a change can affect
+const uint32_t all_feeds      = ( 1 << tag_feed_type_count ) - 1;
+const uint32_t promoted_feeds = 1 << promoted_feed;
+/// Votes and payouts change rshares, hot and trending, never the creation time the created feed sorts on
+const uint32_t vote_feeds     = ( 1 << trending_feed ) | ( 1 << hot_feed );
+
 class tags_plugin_impl
 {
    public:
@@ -63,6 +69,7 @@ class tags_plugin_impl
 
       chain::database&     _db;
       fc::time_point_sec   _promoted_start_time;
+      uint32_t             _feed_size = 100;
       bool                 _started = false;
       boost::signals2::connection   _pre_apply_operation_conn;
       boost::signals2::connection   _post_apply_operation_conn;
@@ -76,6 +83,16 @@ class tags_plugin_impl
       void update_tag( const tag_object& current, const comment_object& comment, double hot, double trending )const;
       void create_tag( const string& tag, const comment_object& comment, double hot, double trending )const;
       void update_tags( const comment_object& c, bool parse_tags = false )const;
+
+      const tag_object* find_tag( comment_id_type comment, const tag_name_type& tag )const;
+      void update_feeds( const tag_name_type& tag, comment_id_type comment, comment_id_type parent, uint32_t feeds = all_feeds )const;
+      void update_feed( const tag_feed_object& feed, const tag_object* changed, comment_id_type comment, bool rebuild )const;
+
+      template< typename SortTag, typename Qualifies >
+      void update_feed( const tag_feed_object& feed, const tag_object* changed, comment_id_type comment, bool rebuild, Qualifies&& qualifies, bool stop_on_miss )const;
+
+      template< typename SortTag, typename Qualifies >
+      void fill_feed( const tag_name_type& tag, vector< comment_id_type >& comments, bool& complete, Qualifies&& qualifies, bool stop_on_miss )const;
 };
 
 tags_plugin_impl::tags_plugin_impl() :
@@ -130,7 +147,11 @@ void tags_plugin_impl::remove_tag( const tag_object& tag )const
    }
 
    /// TODO: update tag stats object
+   tag_name_type name = tag.tag;
+   comment_id_type comment = tag.comment;
+   comment_id_type parent = tag.parent;
    _db.remove(tag);
+   update_feeds( name, comment, parent );
 }
 
 const tag_stats_object& tags_plugin_impl::get_stats( const string& tag )const
@@ -196,6 +217,7 @@ void tags_plugin_impl::update_tag( const tag_object& current, const comment_obje
     remove_stats( current, stats );
 
     if( comment.cashout_time != fc::time_point_sec::maximum() ) {
+       share_type promoted_balance = current.promoted_balance;
        _db.modify( current, [&]( tag_object& obj ) {
           obj.active            = comment.active;
           obj.cashout           = _db.calculate_discussion_payout_time( comment );
@@ -208,8 +230,13 @@ void tags_plugin_impl::update_tag( const tag_object& current, const comment_obje
             obj.promoted_balance = 0;
       });
       add_stats( current, stats );
+      update_feeds( current.tag, current.comment, current.parent,
+         vote_feeds | ( current.promoted_balance != promoted_balance ? promoted_feeds : 0 ) );
     } else {
+       tag_name_type name = current.tag;
+       comment_id_type parent = current.parent;
        _db.remove( current );
+       update_feeds( name, comment.id, parent );
     }
 }
 
@@ -237,6 +264,7 @@ void tags_plugin_impl::create_tag( const string& tag, const comment_object& comm
        obj.trending          = trending;
    });
    add_stats( tag_obj, get_stats( tag ) );
+   update_feeds( tag_obj.tag, tag_obj.comment, tag_obj.parent );
 
 
    const auto& idx = _db.get_index<author_tag_stats_index>().indices().get<by_author_tag_posts>();
@@ -259,6 +287,208 @@ void tags_plugin_impl::create_tag( const string& tag, const comment_object& comm
    }
 }
 
+const tag_object* tags_plugin_impl::find_tag( comment_id_type comment, const tag_name_type& tag )const
+{
+   const auto& comment_idx = _db.get_index< tag_index >().indices().get< by_comment >();
+   auto itr = comment_idx.lower_bound( comment );
+
+   while( itr != comment_idx.end() && itr->comment == comment )
+   {
+      if( itr->tag == tag )
+         return &*itr;
+      ++itr;
+   }
+
+   return nullptr;
+}
+
+/**
+ *  Called after the tag_object for comment in tag was created, modified or removed. Feeds only
+ *  cover top level posts, so replies never touch them. Only the feeds in the feeds mask, those
+ *  whose ordering or filter the change can affect, are looked at.
+ */
+void tags_plugin_impl::update_feeds( const tag_name_type& tag, comment_id_type comment, comment_id_type parent, uint32_t feeds )const
+{
+   if( parent != comment_id_type() )
+      return;
+
+   const tag_object* changed = find_tag( comment, tag );
+
+   for( int type = 0; type < tag_feed_type_count; ++type )
+   {
+      if( !( feeds & ( 1 << type ) ) )
+         continue;
+
+      const auto* feed = _db.find< tag_feed_object, by_tag_type >( boost::make_tuple( tag, tag_feed_type( type ) ) );
+      bool rebuild = false;
+
+      if( feed == nullptr )
+      {
+         if( _feed_size == 0 || changed == nullptr )
+            continue;
+
+         feed = &_db.create< tag_feed_object >( [&]( tag_feed_object& f )
+         {
+            f.tag = tag;
+            f.type = tag_feed_type( type );
+         });
+         rebuild = true;
+      }
+      else if( _feed_size == 0 )
+      {
+         // Feeds are only correct while every change is applied to them, so drop them rather than let them go stale
+         _db.remove( *feed );
+         continue;
+      }
+
+      update_feed( *feed, changed, comment, rebuild );
+   }
+}
+
+void tags_plugin_impl::update_feed( const tag_feed_object& feed, const tag_object* changed, comment_id_type comment, bool rebuild )const
+{
+   // These mirror the filters the tags_api get_discussions_by_* calls apply while walking the index
+   switch( feed.type )
+   {
+      case trending_feed:
+         update_feed< by_parent_trending >( feed, changed, comment, rebuild, []( const tag_object& t ){ return t.net_rshares > 0; }, false );
+         break;
+      case hot_feed:
+         update_feed< by_parent_hot >( feed, changed, comment, rebuild, []( const tag_object& t ){ return t.net_rshares > 0; }, false );
+         break;
+      case created_feed:
+         update_feed< by_parent_created >( feed, changed, comment, rebuild, []( const tag_object& t ){ return true; }, false );
+         break;
+      case promoted_feed:
+         update_feed< by_parent_promoted >( feed, changed, comment, rebuild, []( const tag_object& t ){ return t.promoted_balance > 0; }, true );
+         break;
+      default:
+         break;
+   }
+}
+
+/**
+ *  The feed is a prefix of the qualifying posts in SortTag order. Only the changed post moves, so it
+ *  is taken out and, if it still qualifies, put back at its new place found by binary search over the
+ *  listed posts. A post that is not listed and does not sort ahead of the last listed post leaves the
+ *  prefix intact. When the list gets shorter, it is topped up from the index past its last post.
+ */
+template< typename SortTag, typename Qualifies >
+void tags_plugin_impl::update_feed( const tag_feed_object& feed, const tag_object* changed, comment_id_type comment, bool rebuild, Qualifies&& qualifies, bool stop_on_miss )const
+{
+   const auto& idx = _db.get_index< tag_index >().indices().get< SortTag >();
+
+   vector< comment_id_type > comments;
+   bool complete = false;
+
+   if( !rebuild )
+   {
+      auto listed = std::find( feed.comments.begin(), feed.comments.end(), comment );
+      bool qualified = changed != nullptr && qualifies( *changed );
+
+      if( listed == feed.comments.end() )
+      {
+         if( !qualified )
+            return;
+
+         if( !feed.complete && feed.comments.size() )
+         {
+            const tag_object* last = find_tag( feed.comments.back(), feed.tag );
+            if( last != nullptr && !idx.value_comp()( *changed, *last ) )
+               return;
+         }
+      }
+
+      comments.reserve( feed.comments.size() + 1 );
+      for( const auto& c : feed.comments )
+      {
+         if( c != comment )
+            comments.push_back( c );
+      }
+      complete = feed.complete;
+
+      if( qualified )
+      {
+         // The other listed posts did not change, so they are still sorted
+         auto pos = std::partition_point( comments.begin(), comments.end(), [&]( comment_id_type c )
+         {
+            const tag_object* t = find_tag( c, feed.tag );
+            return t != nullptr && idx.value_comp()( *t, *changed );
+         });
+
+         // Past the end of an incomplete list, unlisted posts may sort ahead of it
+         if( pos != comments.end() || complete )
+            comments.insert( pos, comment );
+
+         if( comments.size() > _feed_size )
+         {
+            comments.resize( _feed_size );
+            complete = false;
+         }
+      }
+   }
+
+   fill_feed< SortTag >( feed.tag, comments, complete, qualifies, stop_on_miss );
+
+   if( comments.empty() && complete )
+   {
+      _db.remove( feed );
+      return;
+   }
+
+   _db.modify( feed, [&]( tag_feed_object& f )
+   {
+      f.comments.assign( comments.begin(), comments.end() );
+      f.complete = complete;
+   });
+}
+
+/**
+ *  Appends the qualifying posts that follow the last listed one in SortTag order, until the list is
+ *  full or the top level posts of the tag run out, which makes it complete.
+ */
+template< typename SortTag, typename Qualifies >
+void tags_plugin_impl::fill_feed( const tag_name_type& tag, vector< comment_id_type >& comments, bool& complete, Qualifies&& qualifies, bool stop_on_miss )const
+{
+   if( complete || comments.size() >= _feed_size )
+      return;
+
+   const auto& idx = _db.get_index< tag_index >().indices().get< SortTag >();
+   auto itr = idx.lower_bound( tag );
+
+   if( comments.size() )
+   {
+      const tag_object* last = find_tag( comments.back(), tag );
+      if( last != nullptr )
+         itr = ++idx.iterator_to( *last );
+      else
+         comments.clear();
+   }
+
+   uint64_t itr_count = 0;
+   uint64_t max_itr_count = 10 * uint64_t( _feed_size - comments.size() );
+
+   for( ; comments.size() < _feed_size && itr_count < max_itr_count; ++itr, ++itr_count )
+   {
+      // Top level posts sort ahead of the replies in each tag
+      if( itr == idx.end() || itr->tag != tag || itr->parent != comment_id_type() )
+      {
+         complete = true;
+         break;
+      }
+
+      if( qualifies( *itr ) )
+      {
+         comments.push_back( itr->comment );
+      }
+      else if( stop_on_miss )
+      {
+         complete = true;
+         break;
+      }
+   }
+}
+
 /** finds tags that have been added or removed or updated */
 void tags_plugin_impl::update_tags( const comment_object& c, bool parse_tags )const
 {
@@ -331,9 +561,10 @@ void tags_plugin_impl::update_tags( const comment_object& c, bool parse_tags )co
 
 struct pre_apply_operation_visitor
 {
-   pre_apply_operation_visitor( database& db ) : _db( db ) {};
+   pre_apply_operation_visitor( tags_plugin_impl& my ) : _my( my ), _db( my._db ) {};
    typedef void result_type;
 
+   tags_plugin_impl& _my;
    database& _db;
 
    void operator()( const delete_comment_operation& op )const
@@ -357,7 +588,10 @@ struct pre_apply_operation_visitor
 
       for( const auto* tag_ptr : to_remove )
       {
+         tag_name_type name = tag_ptr->tag;
+         comment_id_type parent = tag_ptr->parent;
          _db.remove( *tag_ptr );
+         _my.update_feeds( name, comment->id, parent );
       }
    }
 
@@ -401,12 +635,15 @@ struct operation_visitor
                auto citr = comment_idx.lower_bound( c->id );
                while( citr != comment_idx.end() && citr->comment == c->id )
                {
-                  _my._db.modify( *citr, [&]( tag_object& t )
+                  const tag_object& tag = *citr;
+                  ++citr;
+
+                  _my._db.modify( tag, [&]( tag_object& t )
                   {
                       if( t.cashout != fc::time_point_sec::maximum() )
                           t.promoted_balance += op.amount.amount;
                   });
-                  ++citr;
+                  _my.update_feeds( tag.tag, tag.comment, tag.parent, promoted_feeds );
                }
             }
             else
@@ -458,7 +695,7 @@ void tags_plugin_impl::on_pre_apply_operation( const operation_notification& not
    try
    {
       /// plugins shouldn't ever throw
-      note.op.visit( pre_apply_operation_visitor( _db ) );
+      note.op.visit( pre_apply_operation_visitor( *this ) );
    }
    catch ( const fc::exception& e )
    {
@@ -500,6 +737,7 @@ void tags_plugin::set_program_options(
    cfg.add_options()
       ("tags-start-promoted", boost::program_options::value< uint32_t >()->default_value( 0 ), "Block time (in epoch seconds) when to start calculating promoted content. Should be 1 week prior to current time." )
       ("tags-skip-startup-update", bpo::value<bool>()->default_value(false), "Skip updating tags on startup. Can safely be skipped when starting a previously running node. Should not be skipped when reindexing.")
+      ("tags-feed-size", bpo::value< uint32_t >()->default_value( 100 ), "Number of top level posts per tag kept precomputed for the trending, hot, created and promoted discussion queries. 0 disables the precomputed lists." )
       ;
    cli.add_options()
       ("tags-skip-startup-update", bpo::bool_switch()->default_value(false), "Skip updating tags on startup. Can safely be skipped when starting a previously running node. Should not be skipped when reindexing." )
@@ -534,6 +772,10 @@ void tags_plugin::plugin_initialize(const boost::program_options::variables_map&
    STEEM_ADD_PLUGIN_INDEX(my->_db, tag_index);
    STEEM_ADD_PLUGIN_INDEX(my->_db, tag_stats_index);
    STEEM_ADD_PLUGIN_INDEX(my->_db, author_tag_stats_index);
+   STEEM_ADD_PLUGIN_INDEX(my->_db, tag_feed_index);
+
+   if( options.count( "tags-feed-size" ) )
+      my->_feed_size = options.at( "tags-feed-size" ).as< uint32_t >();
 
    fc::mutable_variant_object state_opts;
 
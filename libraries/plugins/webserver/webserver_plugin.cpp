@@ -2,12 +2,17 @@
 #include <steem/plugins/webserver/local_endpoint.hpp>
 
 #include <steem/plugins/chain/chain_plugin.hpp>
+#include <steem/plugins/statsd/utility.hpp>
+
+#include <steem/chain/util/signal.hpp>
 
 #include <fc/network/ip.hpp>
 #include <fc/log/logger_config.hpp>
 #include <fc/io/json.hpp>
 #include <fc/network/resolve.hpp>
+#include <fc/compress/zlib.hpp>
 
+#include <boost/algorithm/string.hpp>
 #include <boost/asio.hpp>
 #include <boost/optional.hpp>
 #include <boost/bind.hpp>
@@ -21,8 +26,11 @@
 #include <websocketpp/logger/stub.hpp>
 #include <websocketpp/logger/syslog.hpp>
 
+#include <atomic>
 #include <thread>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <iostream>
 
 namespace steem { namespace plugins { namespace webserver {
@@ -112,19 +120,296 @@ namespace detail {
 using websocket_server_type = websocketpp::server< detail::asio_with_stub_log >;
 using websocket_local_server_type = websocketpp::server<detail::asio_local_with_stub_log>;
 
+/**
+ * Threads serving one class of requests. Each pool has its own queue limit, so a spike of
+ * expensive calls fills up its own pool and is pushed back on while cheap calls keep flowing.
+ */
+class request_pool
+{
+   public:
+      request_pool( const string& n, thread_pool_size_t size, uint32_t limit ) :
+         name( n ),
+         work( ios ),
+         queue_limit( limit )
+      {
+         for( uint32_t i = 0; i < size; ++i )
+            threads.create_thread( boost::bind( &asio::io_service::run, &ios ) );
+      }
+
+      /// Queues the callback, or returns false without queueing when the pool is at its limit
+      template< typename Callback >
+      bool post( Callback&& callback )
+      {
+         uint32_t waiting = ++queued;
+         if( queue_limit && waiting > queue_limit )
+         {
+            --queued;
+            STATSD_INCREMENT( "webserver", "rejected", name, 1.0f );
+            return false;
+         }
+
+         STATSD_GAUGE( "webserver", "queued", name, waiting, 1.0f );
+         ios.post( [this, callback]()
+         {
+            --queued;
+            callback();
+         });
+         return true;
+      }
+
+      void stop()
+      {
+         ios.stop();
+         threads.join_all();
+      }
+
+      const string                  name;
+      asio::io_service              ios;
+      asio::io_service::work        work;
+      boost::thread_group           threads;
+      std::atomic< uint32_t >       queued{ 0 };
+      const uint32_t                queue_limit;   ///< 0 is unlimited
+};
+
+/**
+ * Pushes every applied block, and again every block once it becomes irreversible, to the WebSocket
+ * connections subscribed to it. A block and its operations are serialized once, on a publishing
+ * thread of their own, and the same prepared frame is queued on every subscriber. A subscriber whose
+ * send buffer grows past the limit is disconnected rather than left to pile up blocks in memory.
+ */
+class subscription_manager
+{
+   public:
+      enum topic_type
+      {
+         new_block_topic,
+         irreversible_block_topic,
+         topic_count
+      };
+
+      subscription_manager( websocket_server_type& server, size_t buffer_limit ) :
+         _server( server ),
+         _buffer_limit( buffer_limit ),
+         _publisher( "subscription", 1, 0 )
+      {}
+
+      static optional< topic_type > topic_from_string( const string& name );
+      static const char* topic_name( topic_type topic );
+
+      void subscribe( connection_hdl hdl, topic_type topic );
+      void unsubscribe( connection_hdl hdl, topic_type topic );
+      void remove( connection_hdl hdl );
+
+      void connect( plugins::chain::chain_plugin& chain, const abstract_plugin& plugin );
+      void disconnect();
+      void stop() { _publisher.stop(); }
+
+   private:
+      typedef plugins::chain::applied_block applied_block;
+
+      typedef std::set< connection_hdl, std::owner_less< connection_hdl > > subscriber_set;
+
+      void publish_block( const applied_block& data );
+      void publish_irreversible( uint32_t block_num );
+      void publish( topic_type topic, const string& data );
+
+      websocket_server_type&                    _server;
+      const size_t                              _buffer_limit;
+
+      std::mutex                                _mutex;
+      std::array< subscriber_set, topic_count > _subscribers;
+      std::atomic< uint32_t >                   _subscription_count{ 0 };
+
+      /// Used on the publisher thread only, serialized blocks that are not yet irreversible
+      std::map< uint32_t, shared_ptr< const string > > _reversible;
+
+      request_pool                              _publisher;
+
+      plugins::chain::chain_plugin*                _chain = nullptr;
+      plugins::chain::change_stream::consumer_id   _consumer = 0;
+};
+
+optional< subscription_manager::topic_type > subscription_manager::topic_from_string( const string& name )
+{
+   for( int t = 0; t < topic_count; ++t )
+      if( name == topic_name( topic_type( t ) ) )
+         return topic_type( t );
+
+   return optional< topic_type >();
+}
+
+const char* subscription_manager::topic_name( topic_type topic )
+{
+   switch( topic )
+   {
+      case new_block_topic:          return "new_block";
+      case irreversible_block_topic: return "irreversible_block";
+      default:                       return "";
+   }
+}
+
+void subscription_manager::subscribe( connection_hdl hdl, topic_type topic )
+{
+   std::lock_guard< std::mutex > guard( _mutex );
+   if( _subscribers[ topic ].insert( hdl ).second )
+      ++_subscription_count;
+}
+
+void subscription_manager::unsubscribe( connection_hdl hdl, topic_type topic )
+{
+   std::lock_guard< std::mutex > guard( _mutex );
+   if( _subscribers[ topic ].erase( hdl ) )
+      --_subscription_count;
+}
+
+void subscription_manager::remove( connection_hdl hdl )
+{
+   std::lock_guard< std::mutex > guard( _mutex );
+   for( auto& subscribers : _subscribers )
+      if( subscribers.erase( hdl ) )
+         --_subscription_count;
+}
+
+void subscription_manager::connect( plugins::chain::chain_plugin& chain, const abstract_plugin& plugin )
+{
+   // Blocks are only collected by the chain plugin while somebody is subscribed
+   _chain = &chain;
+   _consumer = chain.add_async_block_handler( plugin,
+      [this]( const std::shared_ptr< const applied_block >& data )
+      {
+         _publisher.post( [this, data]() { publish_block( *data ); } );
+      },
+      [this]( uint32_t block_num )
+      {
+         if( _subscription_count > 0 )
+            _publisher.post( [this, block_num]() { publish_irreversible( block_num ); } );
+      },
+      [this]() { return _subscription_count > 0; } );
+}
+
+void subscription_manager::disconnect()
+{
+   if( _chain )
+      _chain->remove_async_block_handler( _consumer );
+   _chain = nullptr;
+}
+
+void subscription_manager::publish_block( const applied_block& data )
+{
+   fc::variants ops;
+   ops.reserve( data.ops.size() );
+
+   for( const auto& o : data.ops )
+   {
+      ops.emplace_back( fc::mutable_variant_object()
+         ( "trx_id", o.trx_id )
+         ( "trx_in_block", o.trx_in_block )
+         ( "op_in_trx", o.op_in_trx )
+         ( "virtual_op", o.virtual_op )
+         ( "op", o.op ) );
+   }
+
+   const auto& block_id = data.block_id;
+   uint32_t block_num = data.block_num;
+
+   auto serialized = std::make_shared< const string >( fc::json::to_string( fc::mutable_variant_object()
+      ( "block_num", block_num )
+      ( "block_id", block_id )
+      ( "block", data.block )
+      ( "operations", ops ) ) );
+
+   // A block applied again after a fork replaces the one it displaced
+   _reversible[ block_num ] = serialized;
+   while( _reversible.size() > STEEM_MAX_WITNESSES * 10 )
+      _reversible.erase( _reversible.begin() );
+
+   publish( new_block_topic, *serialized );
+}
+
+void subscription_manager::publish_irreversible( uint32_t block_num )
+{
+   auto itr = _reversible.find( block_num );
+
+   // Blocks applied while nobody was subscribed were never serialized
+   if( itr != _reversible.end() )
+      publish( irreversible_block_topic, *itr->second );
+
+   _reversible.erase( _reversible.begin(), _reversible.upper_bound( block_num ) );
+}
+
+void subscription_manager::publish( topic_type topic, const string& data )
+{
+   vector< connection_hdl > subscribers;
+   {
+      std::lock_guard< std::mutex > guard( _mutex );
+      subscribers.assign( _subscribers[ topic ].begin(), _subscribers[ topic ].end() );
+   }
+
+   if( subscribers.empty() )
+      return;
+
+   typedef asio_with_stub_log::message_type message_type;
+
+   // Server to client frames are not masked, so one prepared frame is valid on every connection
+   auto msg = websocketpp::lib::make_shared< message_type >( message_type::con_msg_man_ptr(), websocketpp::frame::opcode::text, 0 );
+   string& payload = msg->get_raw_payload();
+   payload.reserve( data.size() + 96 );
+   payload += "{\"jsonrpc\":\"2.0\",\"method\":\"webserver.notice\",\"params\":{\"topic\":\"";
+   payload += topic_name( topic );
+   payload += "\",\"data\":";
+   payload += data;
+   payload += "}}";
+
+   websocketpp::frame::basic_header header( websocketpp::frame::opcode::text, payload.size(), true, false );
+   msg->set_header( websocketpp::frame::prepare_header( header, websocketpp::frame::extended_header( payload.size() ) ) );
+   msg->set_prepared( true );
+
+   for( const auto& hdl : subscribers )
+   {
+      websocketpp::lib::error_code ec;
+      auto con = _server.get_con_from_hdl( hdl, ec );
+
+      if( ec )
+      {
+         remove( hdl );
+         continue;
+      }
+
+      if( con->get_buffered_amount() > _buffer_limit )
+      {
+         remove( hdl );
+         con->close( websocketpp::close::status::try_again_later, "Subscriber is too slow", ec );
+         STATSD_INCREMENT( "webserver", "subscription", "slow_consumer_disconnects", 1.0f )
+         continue;
+      }
+
+      if( con->send( msg ) )
+         remove( hdl );
+   }
+
+   STATSD_COUNT( "webserver", "subscription", topic_name( topic ), subscribers.size(), 1.0f )
+}
+
 class webserver_plugin_impl
 {
    public:
-      webserver_plugin_impl(thread_pool_size_t thread_pool_size) :
-         thread_pool_work( this->thread_pool_ios )
+      webserver_plugin_impl( thread_pool_size_t thread_pool_size, thread_pool_size_t heavy_thread_pool_size, uint32_t queue_limit ) :
+         default_pool( "default", thread_pool_size, queue_limit )
       {
-         for( uint32_t i = 0; i < thread_pool_size; ++i )
-            thread_pool.create_thread( boost::bind( &asio::io_service::run, &thread_pool_ios ) );
+         if( heavy_thread_pool_size )
+            heavy_pool = std::make_unique< request_pool >( "heavy", heavy_thread_pool_size, queue_limit );
       }
 
       void start_webserver();
       void stop_webserver();
 
+      request_pool& select_pool( const string& body );
+      bool is_heavy_method( const string& method )const;
+
+      template< typename Connection >
+      void send_json_response( const Connection& con, string&& body );
+
+      bool handle_subscription_request( connection_hdl hdl, const string& payload, string& reply );
       void handle_ws_message( websocket_server_type*, connection_hdl, detail::websocket_server_type::message_ptr );
       void handle_http_message( websocket_server_type*, connection_hdl );
       void handle_http_request( websocket_local_server_type*, connection_hdl );
@@ -144,9 +429,16 @@ class webserver_plugin_impl
       optional< tcp::endpoint >  ws_endpoint;
       websocket_server_type      ws_server;
 
-      boost::thread_group        thread_pool;
-      asio::io_service           thread_pool_ios;
-      asio::io_service::work     thread_pool_work;
+      request_pool                     default_pool;
+      std::unique_ptr< request_pool >  heavy_pool;
+      vector< string >                 heavy_methods;   ///< api.method names, a trailing '*' matches any suffix
+
+      std::unique_ptr< subscription_manager > subscriptions;   ///< Set when serving WebSockets
+
+      long                             http_keep_alive_timeout = 0;   ///< ms, 0 closes after every response
+      uint32_t                         compression_level = 0;         ///< 0 disables compression
+      size_t                           compression_min_size = 0;
+      std::unique_ptr< request_pool >  compression_pool;              ///< Set when compression is enabled
 
       plugins::json_rpc::json_rpc_plugin* api;
       boost::signals2::connection         chain_sync_con;
@@ -165,9 +457,13 @@ void webserver_plugin_impl::start_webserver()
             ws_server.clear_error_channels( websocketpp::log::elevel::all );
             ws_server.init_asio( &ws_ios );
             ws_server.set_reuse_addr( true );
+            ws_server.set_http_keep_alive_timeout( http_keep_alive_timeout );
 
             ws_server.set_message_handler( boost::bind( &webserver_plugin_impl::handle_ws_message, this, &ws_server, _1, _2 ) );
 
+            if( subscriptions )
+               ws_server.set_close_handler( [this]( connection_hdl hdl ) { subscriptions->remove( hdl ); } );
+
             if( http_endpoint && http_endpoint == ws_endpoint )
             {
                ws_server.set_http_handler( boost::bind( &webserver_plugin_impl::handle_http_message, this, &ws_server, _1 ) );
@@ -199,6 +495,7 @@ void webserver_plugin_impl::start_webserver()
             http_server.clear_error_channels( websocketpp::log::elevel::all );
             http_server.init_asio( &http_ios );
             http_server.set_reuse_addr( true );
+            http_server.set_http_keep_alive_timeout( http_keep_alive_timeout );
 
             http_server.set_http_handler( boost::bind( &webserver_plugin_impl::handle_http_message, this, &http_server, _1 ) );
 
@@ -223,6 +520,7 @@ void webserver_plugin_impl::start_webserver()
           unix_server.clear_access_channels( websocketpp::log::alevel::all );
           unix_server.clear_error_channels( websocketpp::log::elevel::all );
           unix_server.init_asio( &http_ios );
+          unix_server.set_http_keep_alive_timeout( http_keep_alive_timeout );
 
           unix_server.set_http_handler( boost::bind( &webserver_plugin_impl::handle_http_request, this, &unix_server, _1 ) );
           //unix_server.set_http_handler([&](connection_hdl hdl) {
@@ -255,8 +553,17 @@ void webserver_plugin_impl::stop_webserver()
    if( unix_server.is_listening() )
       unix_server.stop_listening();
 
-   thread_pool_ios.stop();
-   thread_pool.join_all();
+   default_pool.stop();
+   if( heavy_pool )
+      heavy_pool->stop();
+   if( compression_pool )
+      compression_pool->stop();
+
+   if( subscriptions )
+   {
+      subscriptions->disconnect();
+      subscriptions->stop();
+   }
 
    if( ws_thread )
    {
@@ -280,18 +587,332 @@ void webserver_plugin_impl::stop_webserver()
    }
 }
 
+namespace {
+
+   const string busy_response = "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":" + std::to_string( JSON_RPC_SERVER_ERROR ) +
+      ",\"message\":\"Server is busy, try again later\"},\"id\":null}";
+
+   void skip_white_space( const string& s, size_t& pos )
+   {
+      while( pos < s.size() && ( s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n' || s[pos] == '\r' ) )
+         ++pos;
+   }
+
+   bool expect_char( const string& s, size_t& pos, char c )
+   {
+      skip_white_space( s, pos );
+      if( pos >= s.size() || s[pos] != c )
+         return false;
+      ++pos;
+      return true;
+   }
+
+   /// Reads a simple quoted string. Method names never need escapes, so any escape gives up.
+   bool read_string( const string& s, size_t& pos, string& out )
+   {
+      if( !expect_char( s, pos, '"' ) )
+         return false;
+
+      size_t end = s.find_first_of( "\"\\", pos );
+      if( end == string::npos || s[end] != '"' )
+         return false;
+
+      out.assign( s, pos, end - pos );
+      pos = end + 1;
+      return true;
+   }
+
+   /**
+    * Calls l( method_pos, params_pos ) for each request object of a body, i.e. the top level object or each
+    * element of a batch. Positions are just past the "method" and "params" member names of that object,
+    * string::npos when it has no such member. Members of nested values are never reported.
+    */
+   template< typename Lambda >
+   void for_each_request( const string& s, Lambda&& l )
+   {
+      size_t pos = 0;
+      skip_white_space( s, pos );
+      const size_t request_depth = ( pos < s.size() && s[pos] == '[' ) ? 2 : 1;
+
+      size_t depth = 0;
+      size_t method_pos = string::npos;
+      size_t params_pos = string::npos;
+
+      for( ; pos < s.size(); ++pos )
+      {
+         switch( s[pos] )
+         {
+            case '"':
+            {
+               size_t begin = ++pos;
+               for( ; pos < s.size() && s[pos] != '"'; ++pos )
+               {
+                  if( s[pos] == '\\' )
+                     ++pos;
+               }
+               if( pos >= s.size() )
+                  return;
+
+               size_t after = pos + 1;
+               if( depth == request_depth && expect_char( s, after, ':' ) )
+               {
+                  if( s.compare( begin, pos - begin, "method" ) == 0 )
+                     method_pos = pos + 1;
+                  else if( s.compare( begin, pos - begin, "params" ) == 0 )
+                     params_pos = pos + 1;
+               }
+               break;
+            }
+            case '{':
+            case '[':
+               if( ++depth == request_depth )
+               {
+                  method_pos = string::npos;
+                  params_pos = string::npos;
+               }
+               break;
+            case '}':
+            case ']':
+               if( depth == request_depth )
+                  l( method_pos, params_pos );
+               if( depth == 0 )
+                  return;
+               --depth;
+               break;
+            default:
+               break;
+         }
+      }
+   }
+
+   enum class content_coding { identity, gzip, deflate };
+
+   /// Picks a response coding from an Accept-Encoding header, gzip first. Codings given q=0 are refused.
+   content_coding select_content_coding( const string& accept_encoding )
+   {
+      bool gzip = false;
+      bool deflate = false;
+
+      vector< string > codings;
+      boost::split( codings, accept_encoding, boost::is_any_of( "," ) );
+
+      for( const auto& c : codings )
+      {
+         size_t semi = c.find( ';' );
+         string name = boost::algorithm::to_lower_copy( boost::algorithm::trim_copy( c.substr( 0, semi ) ) );
+
+         if( semi != string::npos )
+         {
+            size_t q = c.find( "q=", semi );
+            if( q != string::npos && std::strtod( c.c_str() + q + 2, nullptr ) <= 0 )
+               continue;
+         }
+
+         if( name == "gzip" || name == "x-gzip" || name == "*" )
+            gzip = true;
+         else if( name == "deflate" )
+            deflate = true;
+      }
+
+      if( gzip )
+         return content_coding::gzip;
+      if( deflate )
+         return content_coding::deflate;
+      return content_coding::identity;
+   }
+
+}
+
+/**
+ * Sends a JSON-RPC reply as a successful HTTP response. A reply large enough to be worth it is
+ * compressed for clients that accept it, on the compression pool rather than on the pool thread
+ * that made the call, so API threads go back to serving calls as soon as they have a reply.
+ */
+template< typename Connection >
+void webserver_plugin_impl::send_json_response( const Connection& con, string&& body )
+{
+   con->append_header( "Content-Type", "application/json" );
+   con->set_status( websocketpp::http::status_code::ok );
+
+   content_coding coding = content_coding::identity;
+   if( compression_pool && body.size() >= compression_min_size )
+   {
+      coding = select_content_coding( con->get_request_header( "Accept-Encoding" ) );
+      con->append_header( "Vary", "Accept-Encoding" );
+   }
+
+   if( coding == content_coding::identity )
+   {
+      con->set_body( body );
+      con->send_http_response();
+      return;
+   }
+
+   auto reply = std::make_shared< string >( std::move( body ) );
+   compression_pool->post( [con, reply, coding, this]()
+   {
+      try
+      {
+         string compressed = coding == content_coding::gzip ?
+            fc::gzip_compress( *reply, compression_level ) : fc::zlib_compress( *reply, compression_level );
+
+         con->append_header( "Content-Encoding", coding == content_coding::gzip ? "gzip" : "deflate" );
+         con->set_body( compressed );
+
+         STATSD_COUNT( "webserver", "compression", "bytes_in", reply->size(), 1.0f )
+         STATSD_COUNT( "webserver", "compression", "bytes_out", compressed.size(), 1.0f )
+      }
+      catch( ... )
+      {
+         con->set_body( *reply );
+      }
+
+      con->send_http_response();
+   });
+}
+
+bool webserver_plugin_impl::is_heavy_method( const string& method )const
+{
+   for( const auto& pattern : heavy_methods )
+   {
+      if( pattern.size() && pattern.back() == '*' )
+      {
+         if( method.compare( 0, pattern.size() - 1, pattern, 0, pattern.size() - 1 ) == 0 )
+            return true;
+      }
+      else if( method == pattern )
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+/**
+ * Picks the pool for a request from the methods it names. The body is only scanned, not parsed,
+ * so this stays cheap on the io thread. Anything it cannot make sense of goes to the default pool,
+ * where the JSON-RPC plugin reports the error as usual. A batch naming any heavy method is heavy.
+ */
+request_pool& webserver_plugin_impl::select_pool( const string& body )
+{
+   if( !heavy_pool )
+      return default_pool;
+
+   bool heavy = false;
+
+   for_each_request( body, [&]( size_t method_pos, size_t params_pos )
+   {
+      string method;
+      if( heavy || method_pos == string::npos
+         || !expect_char( body, method_pos, ':' ) || !read_string( body, method_pos, method ) )
+         return;
+
+      if( method == "call" )
+      {
+         // {"method":"call","params":["api","method",args]}, params of the same request only
+         string api;
+         if( params_pos == string::npos
+            || !expect_char( body, params_pos, ':' ) || !expect_char( body, params_pos, '[' )
+            || !read_string( body, params_pos, api ) || !expect_char( body, params_pos, ',' )
+            || !read_string( body, params_pos, method ) )
+            return;
+
+         method = api + "." + method;
+      }
+
+      heavy = is_heavy_method( method );
+   });
+
+   return heavy ? *heavy_pool : default_pool;
+}
+
+/**
+ * Answers webserver.subscribe and webserver.unsubscribe, which only exist on WebSocket connections
+ * and so never reach the JSON-RPC plugin. Params are {"topic":"new_block"} or
+ * {"topic":"irreversible_block"}. Returns false for any other message.
+ */
+bool webserver_plugin_impl::handle_subscription_request( connection_hdl hdl, const string& payload, string& reply )
+{
+   static const string subscribe_method = "\"webserver.subscribe\"";
+   static const string unsubscribe_method = "\"webserver.unsubscribe\"";
+
+   bool subscribe = payload.find( subscribe_method ) != string::npos;
+   if( !subscribe && payload.find( unsubscribe_method ) == string::npos )
+      return false;
+
+   fc::variant request;
+   try
+   {
+      request = fc::json::from_string( payload );
+   }
+   catch( const fc::exception& )
+   {
+      return false;
+   }
+
+   if( !request.is_object() || !request.get_object().contains( "method" ) )
+      return false;
+
+   const auto& obj = request.get_object();
+   const auto& method = obj[ "method" ];
+   if( !method.is_string() || ( method.get_string() != "webserver.subscribe" && method.get_string() != "webserver.unsubscribe" ) )
+      return false;
+
+   subscribe = method.get_string() == "webserver.subscribe";
+
+   fc::mutable_variant_object response;
+   response( "jsonrpc", "2.0" );
+
+   optional< subscription_manager::topic_type > topic;
+   if( obj.contains( "params" ) && obj[ "params" ].is_object() && obj[ "params" ].get_object().contains( "topic" ) )
+   {
+      const auto& name = obj[ "params" ].get_object()[ "topic" ];
+      if( name.is_string() )
+         topic = subscription_manager::topic_from_string( name.get_string() );
+   }
+
+   if( !topic )
+   {
+      response( "error", fc::mutable_variant_object()
+         ( "code", JSON_RPC_INVALID_PARAMS )
+         ( "message", "Expected params {\"topic\": \"new_block\" | \"irreversible_block\"}" ) );
+   }
+   else
+   {
+      if( subscribe )
+         subscriptions->subscribe( hdl, *topic );
+      else
+         subscriptions->unsubscribe( hdl, *topic );
+
+      response( "result", fc::mutable_variant_object()
+         ( "topic", subscription_manager::topic_name( *topic ) )
+         ( "subscribed", subscribe ) );
+   }
+
+   response( "id", obj.contains( "id" ) ? obj[ "id" ] : fc::variant() );
+
+   reply = fc::json::to_string( response );
+   return true;
+}
+
 void webserver_plugin_impl::handle_ws_message( websocket_server_type* server, connection_hdl hdl, detail::websocket_server_type::message_ptr msg )
 {
    auto con = server->get_con_from_hdl( hdl );
 
-   thread_pool_ios.post( [con, msg, this]()
+   auto& pool = select_pool( msg->get_payload() );
+   bool queued = pool.post( [con, hdl, msg, this]()
    {
       try
       {
-         if( msg->get_opcode() == websocketpp::frame::opcode::text )
-            con->send( api->call( msg->get_payload() ) );
-         else
+         string reply;
+
+         if( msg->get_opcode() != websocketpp::frame::opcode::text )
             con->send( "error: string payload expected" );
+         else if( subscriptions && handle_subscription_request( hdl, msg->get_payload(), reply ) )
+            con->send( reply );
+         else
+            con->send( api->call( msg->get_payload() ) );
       }
       catch( fc::exception& e )
       {
@@ -316,6 +937,9 @@ void webserver_plugin_impl::handle_ws_message( websocket_server_type* server, co
          }
       }
    });
+
+   if( !queued )
+      con->send( busy_response );
 }
 
 void webserver_plugin_impl::handle_http_message( websocket_server_type* server, connection_hdl hdl )
@@ -323,15 +947,15 @@ void webserver_plugin_impl::handle_http_message( websocket_server_type* server,
    auto con = server->get_con_from_hdl( hdl );
    con->defer_http_response();
 
-   thread_pool_ios.post( [con, this]()
+   auto& pool = select_pool( con->get_request_body() );
+   bool queued = pool.post( [con, this]()
    {
       auto body = con->get_request_body();
 
       try
       {
-         con->set_body( api->call( body ) );
-         con->append_header( "Content-Type", "application/json" );
-         con->set_status( websocketpp::http::status_code::ok );
+         send_json_response( con, api->call( body ) );
+         return;
       }
       catch( fc::exception& e )
       {
@@ -362,21 +986,29 @@ void webserver_plugin_impl::handle_http_message( websocket_server_type* server,
 
       con->send_http_response();
    });
+
+   if( !queued )
+   {
+      con->set_body( busy_response );
+      con->append_header( "Content-Type", "application/json" );
+      con->set_status( websocketpp::http::status_code::service_unavailable );
+      con->send_http_response();
+   }
 }
 
 void webserver_plugin_impl::handle_http_request(websocket_local_server_type* server, connection_hdl hdl ) {
    auto con = server->get_con_from_hdl( hdl );
    con->defer_http_response();
 
-   thread_pool_ios.post( [con, this]()
+   auto& pool = select_pool( con->get_request_body() );
+   bool queued = pool.post( [con, this]()
    {
       auto body = con->get_request_body();
 
       try
       {
-         con->set_body( api->call( body ) );
-         con->append_header( "Content-Type", "application/json" );
-         con->set_status( websocketpp::http::status_code::ok );
+         send_json_response( con, api->call( body ) );
+         return;
       }
       catch( fc::exception& e )
       {
@@ -407,6 +1039,14 @@ void webserver_plugin_impl::handle_http_request(websocket_local_server_type* ser
 
       con->send_http_response();
    });
+
+   if( !queued )
+   {
+      con->set_body( busy_response );
+      con->append_header( "Content-Type", "application/json" );
+      con->set_status( websocketpp::http::status_code::service_unavailable );
+      con->send_http_response();
+   }
 }
 
 } // detail
@@ -416,6 +1056,17 @@ webserver_plugin::~webserver_plugin() {}
 
 void webserver_plugin::set_program_options( options_description&, options_description& cfg )
 {
+   static const vector< string > default_heavy_methods =
+   {
+      "condenser_api.get_discussions_by_*",
+      "tags_api.get_discussions_by_*",
+      "condenser_api.get_account_history",
+      "account_history_api.get_account_history",
+      "account_history_api.enum_virtual_ops",
+      "condenser_api.get_state",
+      "database_api.list_*"
+   };
+
    cfg.add_options()
       ("webserver-http-endpoint", bpo::value< string >(), "Local http endpoint for webserver requests.")
       ("webserver-unix-endpoint", bpo::value< string >(), "Local unix http endpoint for webserver requests.")
@@ -423,6 +1074,22 @@ void webserver_plugin::set_program_options( options_description&, options_descri
       ("rpc-endpoint", bpo::value< string >(), "Local http and websocket endpoint for webserver requests. Deprecated in favor of webserver-http-endpoint and webserver-ws-endpoint" )
       ("webserver-thread-pool-size", bpo::value<thread_pool_size_t>()->default_value(32),
        "Number of threads used to handle queries. Default: 32.")
+      ("webserver-heavy-thread-pool-size", bpo::value<thread_pool_size_t>()->default_value(8),
+       "Number of threads used to handle queries to heavy methods, kept apart so they cannot starve cheap queries. 0 serves them from the main pool. Default: 8.")
+      ("webserver-heavy-method", bpo::value< vector< string > >()->composing()->default_value( default_heavy_methods, "condenser_api.get_discussions_by_* ..." ),
+       "An api.method served by the heavy thread pool, a trailing '*' matches any suffix. Can be specified multiple times.")
+      ("webserver-thread-pool-queue-limit", bpo::value<uint32_t>()->default_value(1000),
+       "Number of queries each thread pool holds waiting for a thread before new ones are answered as busy. 0 is unlimited. Default: 1000.")
+      ("webserver-http-keep-alive-timeout", bpo::value<uint32_t>()->default_value(5000),
+       "Milliseconds an idle HTTP connection is kept open for further, possibly pipelined, requests. 0 closes the connection after every response. Default: 5000.")
+      ("webserver-compression-level", bpo::value<uint32_t>()->default_value(1),
+       "Level (1-9) used to gzip or deflate HTTP responses for clients that accept it. 0 disables compression. Default: 1.")
+      ("webserver-compression-min-size", bpo::value<uint32_t>()->default_value(1024),
+       "Smallest HTTP response in bytes that is compressed. Default: 1024.")
+      ("webserver-compression-thread-pool-size", bpo::value<thread_pool_size_t>()->default_value(4),
+       "Number of threads used to compress HTTP responses, apart from the threads handling queries. Default: 4.")
+      ("webserver-subscription-buffer-limit-mb", bpo::value<uint32_t>()->default_value(32),
+       "Unsent data in MiB a WebSocket block subscriber may fall behind by before it is disconnected. Default: 32.")
       ;
 }
 
@@ -431,7 +1098,28 @@ void webserver_plugin::plugin_initialize( const variables_map& options )
    auto thread_pool_size = options.at("webserver-thread-pool-size").as<thread_pool_size_t>();
    FC_ASSERT(thread_pool_size > 0, "webserver-thread-pool-size must be greater than 0");
    ilog("configured with ${tps} thread pool size", ("tps", thread_pool_size));
-   my.reset(new detail::webserver_plugin_impl(thread_pool_size));
+
+   auto heavy_thread_pool_size = options.at("webserver-heavy-thread-pool-size").as<thread_pool_size_t>();
+   auto queue_limit = options.at("webserver-thread-pool-queue-limit").as<uint32_t>();
+   my.reset(new detail::webserver_plugin_impl(thread_pool_size, heavy_thread_pool_size, queue_limit));
+
+   my->http_keep_alive_timeout = options.at("webserver-http-keep-alive-timeout").as<uint32_t>();
+   my->compression_level = options.at("webserver-compression-level").as<uint32_t>();
+   FC_ASSERT(my->compression_level <= 9, "webserver-compression-level must be between 0 and 9");
+   my->compression_min_size = options.at("webserver-compression-min-size").as<uint32_t>();
+
+   if( my->compression_level )
+   {
+      auto compression_thread_pool_size = options.at("webserver-compression-thread-pool-size").as<thread_pool_size_t>();
+      FC_ASSERT(compression_thread_pool_size > 0, "webserver-compression-thread-pool-size must be greater than 0 while compression is enabled");
+      my->compression_pool = std::make_unique< detail::request_pool >( "compression", compression_thread_pool_size, 0 );
+   }
+
+   if( heavy_thread_pool_size )
+   {
+      my->heavy_methods = options.at("webserver-heavy-method").as< vector< string > >();
+      ilog("configured with ${tps} heavy thread pool size for ${m}", ("tps", heavy_thread_pool_size)("m", my->heavy_methods));
+   }
 
    if( options.count( "webserver-http-endpoint" ) )
    {
@@ -479,6 +1167,13 @@ void webserver_plugin::plugin_initialize( const variables_map& options )
          ilog( "configured ws to listen on ${ep}", ("ep", endpoints[0]) );
       }
    }
+
+   if( my->ws_endpoint )
+   {
+      size_t buffer_limit = size_t( options.at( "webserver-subscription-buffer-limit-mb" ).as< uint32_t >() ) * 1024 * 1024;
+      my->subscriptions = std::make_unique< detail::subscription_manager >( my->ws_server, buffer_limit );
+      my->subscriptions->connect( appbase::app().get_plugin< plugins::chain::chain_plugin >(), *this );
+   }
 }
 
 void webserver_plugin::plugin_startup()
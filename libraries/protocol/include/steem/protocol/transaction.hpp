@@ -82,6 +82,21 @@ using fc::ecc::canonical_signature_type;
          canonical_signature_type canon_type = fc::ecc::fc_canonical
          )const;
 
+      /**
+       * Verifies authority against signature keys that were already recovered, e.g. by
+       * get_signature_keys() on another thread. The caller is responsible for checking
+       * that the signatures are canonical.
+       */
+      void verify_authority(
+         const flat_set<public_key_type>& signature_keys,
+         const authority_getter& get_active,
+         const authority_getter& get_owner,
+         const authority_getter& get_posting,
+         uint32_t max_recursion/* = STEEM_MAX_SIG_CHECK_DEPTH*/,
+         uint32_t max_membership = STEEM_MAX_AUTHORITY_MEMBERSHIP,
+         uint32_t max_account_auths = STEEM_MAX_SIG_CHECK_ACCOUNTS
+         )const;
+
       set<public_key_type> minimize_required_signatures(
          const chain_id_type& chain_id,
          const flat_set<public_key_type>& available_keys,
@@ -231,4 +231,28 @@ void signed_transaction::verify_authority(
       flat_set< account_name_type >() );
 } FC_CAPTURE_AND_RETHROW( (*this) ) }
 
+void signed_transaction::verify_authority(
+   const flat_set<public_key_type>& signature_keys,
+   const authority_getter& get_active,
+   const authority_getter& get_owner,
+   const authority_getter& get_posting,
+   uint32_t max_recursion,
+   uint32_t max_membership,
+   uint32_t max_account_auths )const
+{ try {
+   steem::protocol::verify_authority(
+      operations,
+      signature_keys,
+      get_active,
+      get_owner,
+      get_posting,
+      max_recursion,
+      max_membership,
+      max_account_auths,
+      false,
+      flat_set< account_name_type >(),
+      flat_set< account_name_type >(),
+      flat_set< account_name_type >() );
+} FC_CAPTURE_AND_RETHROW( (*this) ) }
+
 } } // steem::protocol
@@ -0,0 +1,50 @@
+#include <steem/plugins/block_data_export/binary_export_format.hpp>
+#include <steem/plugins/rc/rc_export_objects.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace steem::plugins::block_data_export;
+
+/**
+ * Converts a binary block data export file back into the JSON format, one object per block.
+ * Raw payload of types unknown to the reader is printed in hex along with its type name.
+ */
+int main( int argc, char** argv, char** envp )
+{
+   if( argc < 2 )
+   {
+      std::cerr << "Usage: " << argv[0] << " <binary export file> [--schema]" << std::endl;
+      return 1;
+   }
+
+   try
+   {
+      std::ifstream input( argv[1], std::ios::binary );
+      FC_ASSERT( input, "Cannot open ${f}", ("f", argv[1]) );
+
+      binary_export_reader reader( input );
+
+      if( argc > 2 && std::string( argv[2] ) == "--schema" )
+      {
+         std::cout << fc::json::to_pretty_string( reader.get_header() ) << std::endl;
+         return 0;
+      }
+
+      reader.add_raw_decoder< steem::plugins::rc::exp_rc_data >();
+
+      fc::variant block;
+      while( reader.read_block( block ) )
+         std::cout << fc::json::to_string( block ) << '\n';
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << std::endl;
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,997 @@
+#ifdef IS_TEST_NET
+#include <boost/test/unit_test.hpp>
+
+#include <steem/chain/account_object.hpp>
+#include <steem/protocol/steem_operations.hpp>
+
+#include <steem/plugins/account_history_rocksdb/account_history_chunk.hpp>
+#include <steem/plugins/account_history_rocksdb/account_history_rocksdb_plugin.hpp>
+
+#include <steem/utilities/tempdir.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <rocksdb/options.h>
+
+#include <boost/container/flat_set.hpp>
+
+#include "../db_fixture/database_fixture.hpp"
+
+using namespace steem::chain;
+using namespace steem::protocol;
+using namespace steem::plugins::account_history_rocksdb;
+
+namespace {
+
+std::vector< int64_t > make_ids( int64_t first, size_t count, int64_t step = 1 )
+{
+   std::vector< int64_t > ids;
+   for( size_t i = 0; i < count; ++i )
+      ids.push_back( first + int64_t( i ) * step );
+   return ids;
+}
+
+std::string make_operand( uint16_t first_position, const std::vector< int64_t >& ids, size_t begin = 0, size_t end = std::string::npos )
+{
+   end = std::min( end, ids.size() );
+   return account_history_chunk::makeOperand( first_position, ids.data() + begin, end - begin );
+}
+
+std::vector< int64_t > decode_chunk( const std::string& value )
+{
+   std::vector< int64_t > ids;
+   BOOST_REQUIRE( account_history_chunk::decode( value, &ids ) );
+   return ids;
+}
+
+std::string make_bitmap( std::initializer_list< uint32_t > positions )
+{
+   std::string bitmap;
+   for( auto p : positions )
+      entry_bitmap_merge_operator::set( &bitmap, p );
+   return bitmap;
+}
+
+/// Applies operands one by one, the way FullMergeV2 gets them when no partial merge took place.
+bool full_merge( const std::string* existing, const std::vector< std::string >& operands, std::string* result )
+{
+   account_history_chunk_merge_operator merge_op;
+   std::vector< Slice > operand_list( operands.begin(), operands.end() );
+   Slice existing_value = existing != nullptr ? Slice( *existing ) : Slice();
+   Slice existing_operand;
+
+   ::rocksdb::MergeOperator::MergeOperationInput in( Slice(), existing != nullptr ? &existing_value : nullptr, operand_list, nullptr );
+   ::rocksdb::MergeOperator::MergeOperationOutput out( *result, existing_operand );
+   return merge_op.FullMergeV2( in, &out );
+}
+
+/// Temporary storage holding account history chunks in the default column and operations in the "ops" one.
+struct ah_storage_fixture
+{
+   ah_storage_fixture() : filter( state )
+   {
+      ::rocksdb::Options options;
+      options.create_if_missing = true;
+      options.merge_operator = std::make_shared< account_history_chunk_merge_operator >();
+      options.compaction_filter = &filter;
+
+      DB* db = nullptr;
+      BOOST_REQUIRE( DB::Open( options, dir.path().string(), &db ).ok() );
+      storage.reset( db );
+      BOOST_REQUIRE( storage->CreateColumnFamily( ::rocksdb::ColumnFamilyOptions(), "ops", &ops ).ok() );
+
+      state.attach( storage.get(), ops, storage->DefaultColumnFamily() );
+   }
+
+   ~ah_storage_fixture()
+   {
+      state.detach();
+      delete ops;
+   }
+
+   void put_op( int64_t id, const fc::time_point_sec& timestamp )
+   {
+      rocksdb_operation_object op;
+      op.id = id;
+      op.timestamp = timestamp;
+      auto buffer = dump( op );
+      BOOST_REQUIRE( storage->Put( ::rocksdb::WriteOptions(), ops, id_slice_t( id ), Slice( buffer.data(), buffer.size() ) ).ok() );
+   }
+
+   /// Stores a chunk of entries as is, bypassing the merge operator.
+   std::string put_chunk( int64_t ah_id, uint32_t chunk_no, const std::vector< int64_t >& ids )
+   {
+      std::string value;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 0, ids ) ) );
+      BOOST_REQUIRE( storage->Put( ::rocksdb::WriteOptions(), ah_chunk_slice_t( std::make_pair( ah_id, chunk_no ) ), value ).ok() );
+      return value;
+   }
+
+   bool has_chunk( int64_t ah_id, uint32_t chunk_no )
+   {
+      PinnableSlice buffer;
+      return storage->Get( ReadOptions(), storage->DefaultColumnFamily(), ah_chunk_slice_t( std::make_pair( ah_id, chunk_no ) ), &buffer ).ok();
+   }
+
+   /// Asks a fresh filter, which has not memoized any operation bounds yet.
+   bool is_pruned( int64_t ah_id, uint32_t chunk_no, const std::string& value )
+   {
+      ah_prune_filter f( state );
+      std::string new_value;
+      bool value_changed = false;
+      return f.Filter( 0, ah_chunk_slice_t( std::make_pair( ah_id, chunk_no ) ), value, &new_value, &value_changed );
+   }
+
+   bool is_bitmap_pruned( int64_t ah_id, uint32_t chunk_no )
+   {
+      ah_op_type_prune_filter f( state );
+      std::string new_value;
+      bool value_changed = false;
+      return f.Filter( 0, ah_op_type_chunk_slice_t( std::make_pair( std::make_pair( ah_id, 0u ), chunk_no ) ),
+         make_bitmap( { 0 } ), &new_value, &value_changed );
+   }
+
+   fc::temp_directory         dir{ steem::utilities::temp_directory_path() };
+   ah_retention_state         state;
+   ah_prune_filter            filter;
+   std::unique_ptr< DB >      storage;
+   ColumnFamilyHandle*        ops = nullptr;
+};
+
+const fc::time_point_sec NEWEST_TIME( 1500000000 );
+
+/// Storage directory of the plugin, a base of ah_rocksdb_fixture so that it outlives the plugin.
+struct ah_rocksdb_storage_dir
+{
+   fc::temp_directory ah_dir{ steem::utilities::temp_directory_path() };
+};
+
+/// Chain with account_history_rocksdb_plugin recording it, with pruning enabled.
+struct ah_rocksdb_fixture : public ah_rocksdb_storage_dir, public database_fixture
+{
+   struct history_entry
+   {
+      unsigned int   sequence = 0;
+      int64_t        op_id = 0;
+      uint32_t       op_type = 0;
+
+      bool operator==( const history_entry& o )const
+      {
+         return sequence == o.sequence && op_id == o.op_id && op_type == o.op_type;
+      }
+   };
+
+   typedef std::vector< history_entry > history_type;
+
+   /// With `import_later' the plugin stays uninitialized while the chain is built, see import_history().
+   explicit ah_rocksdb_fixture( bool import_later = false )
+   {
+      try
+      {
+         ah_plugin = &appbase::app().register_plugin< account_history_rocksdb_plugin >();
+         db_plugin = &appbase::app().register_plugin< steem::plugins::debug_node::debug_node_plugin >();
+         init_account_pub_key = init_account_priv_key.get_public_key();
+
+         std::string path_arg = "--account-history-rocksdb-path=" + ah_dir.path().string();
+         std::vector< const char* > test_argv = { boost::unit_test::framework::master_test_suite().argv[0],
+                                                  path_arg.c_str(),
+                                                  "--account-history-rocksdb-prune=true" };
+
+         db_plugin->logging = false;
+
+         if( import_later )
+         {
+            test_argv.push_back( "--account-history-rocksdb-immediate-import" );
+            test_argv.push_back( "--account-history-rocksdb-import-threads=4" );
+            appbase::app().initialize< steem::plugins::debug_node::debug_node_plugin >(
+               test_argv.size(), (char**)test_argv.data() );
+         }
+         else
+         {
+            appbase::app().initialize< account_history_rocksdb_plugin,
+               steem::plugins::debug_node::debug_node_plugin >( test_argv.size(), (char**)test_argv.data() );
+         }
+
+         db = &appbase::app().get_plugin< steem::plugins::chain::chain_plugin >().db();
+         BOOST_REQUIRE( db );
+
+         open_database();
+
+         generate_block();
+         db->set_hardfork( STEEM_NUM_HARDFORKS );
+         generate_block();
+
+         vest( STEEM_INIT_MINER_NAME, 10000 );
+
+         // Fill up the rest of the required miners, so that blocks become irreversible
+         for( int i = STEEM_NUM_INIT_MINERS; i < STEEM_MAX_WITNESSES; i++ )
+         {
+            account_create( STEEM_INIT_MINER_NAME + fc::to_string( i ), init_account_pub_key );
+            fund( STEEM_INIT_MINER_NAME + fc::to_string( i ), STEEM_MIN_PRODUCER_REWARD.amount.value );
+            witness_create( STEEM_INIT_MINER_NAME + fc::to_string( i ), init_account_priv_key, "foo.bar", init_account_pub_key, STEEM_MIN_PRODUCER_REWARD.amount );
+         }
+
+         generate_block();
+         validate_database();
+      }
+      catch( const fc::exception& e )
+      {
+         edump( (e.to_detail_string()) );
+         throw;
+      }
+   }
+
+   void push_op( const operation& op )
+   {
+      trx.operations.push_back( op );
+      trx.set_expiration( db->head_block_time() + STEEM_MAX_TIME_UNTIL_EXPIRATION );
+      db->push_transaction( trx, ~0 );
+      trx.clear();
+   }
+
+   /** Initializes the plugin left out by the constructor and starts it, which imports the block log in parallel.
+    *  The plugin indexes are not registered this late, so no more blocks may be generated afterwards.
+    */
+   void import_history()
+   {
+      ah_plugin->initialize( appbase::app().get_args() );
+      ah_plugin->plugin_startup();
+   }
+
+   /// Gives alice a history of several operation types, one block per round.
+   void make_history( uint32_t rounds )
+   {
+      for( uint32_t i = 0; i < rounds; ++i )
+      {
+         transfer_operation t;
+         t.from = "alice";
+         t.to = "bob";
+         t.amount = ASSET( "0.001 TESTS" );
+         if( i % 2 == 0 )
+            push_op( t );
+
+         std::swap( t.from, t.to );
+         if( i % 3 == 0 )
+            push_op( t );
+
+         transfer_to_vesting_operation v;
+         v.from = i % 2 ? "alice" : STEEM_INIT_MINER_NAME;
+         v.to = "alice";
+         v.amount = ASSET( "0.001 TESTS" );
+         if( i % 5 == 0 )
+            push_op( v );
+
+         custom_json_operation c;
+         c.required_posting_auths.insert( "alice" );
+         c.id = "test";
+         c.json = "{}";
+         if( i % 29 == 0 )
+            push_op( c );
+
+         generate_block();
+      }
+   }
+
+   void make_irreversible()
+   {
+      uint32_t head = db->head_block_num();
+      for( uint32_t i = 0; i < 100 && db->get_dynamic_global_properties().last_irreversible_block_num < head; ++i )
+         generate_block();
+      BOOST_REQUIRE_GE( db->get_dynamic_global_properties().last_irreversible_block_num, head );
+   }
+
+   history_type find_history( uint64_t start, uint32_t limit, const std::vector< uint32_t >* op_types = nullptr )const
+   {
+      history_type result;
+      auto processor = [&result]( unsigned int sequence, const rocksdb_operation_object& op )
+      {
+         result.push_back( { sequence, op.id, fc::raw::unpack_from_buffer< fc::unsigned_int >( op.serialized_op ).value } );
+      };
+
+      if( op_types == nullptr )
+         ah_plugin->find_account_history_data( "alice", start, limit, processor );
+      else
+         ah_plugin->find_account_history_data( "alice", start, limit, *op_types, processor );
+
+      return result;
+   }
+
+   /// The filtered walk has to return the newest `limit' entries not exceeding `start' of the whole history filtered in memory.
+   void check_filtered_history( const std::vector< uint32_t >& op_types, uint64_t start, uint32_t limit )const
+   {
+      boost::container::flat_set< uint32_t > types( op_types.begin(), op_types.end() );
+      history_type expected;
+
+      for( const auto& e : find_history( std::numeric_limits< uint64_t >::max(), std::numeric_limits< uint32_t >::max() ) )
+      {
+         if( expected.size() < limit && e.sequence <= start && types.count( e.op_type ) )
+            expected.push_back( e );
+      }
+
+      auto filtered = find_history( start, limit, &op_types );
+
+      BOOST_TEST_MESSAGE( "--- types " << fc::json::to_string( op_types ) << " start " << start << " limit " << limit << ": " << filtered.size() << " entries" );
+      BOOST_REQUIRE_EQUAL( filtered.size(), expected.size() );
+      BOOST_REQUIRE( filtered == expected );
+   }
+
+   /// Checks type selections over start values around chunk boundaries and limits around the number of matches.
+   void check_filtered_history()const
+   {
+      uint32_t transfer = operation::tag< transfer_operation >::value;
+      uint32_t vesting = operation::tag< transfer_to_vesting_operation >::value;
+      uint32_t custom = operation::tag< custom_json_operation >::value;
+      uint32_t vote = operation::tag< vote_operation >::value;
+
+      auto all = find_history( std::numeric_limits< uint64_t >::max(), std::numeric_limits< uint32_t >::max() );
+      BOOST_REQUIRE( all.empty() == false );
+      uint64_t newest = all.front().sequence;
+
+      std::vector< std::vector< uint32_t > > selections = { { transfer }, { vesting }, { custom }, { vote },
+         { custom, vesting }, { vesting, custom, custom }, { transfer, vesting, custom, vote } };
+      std::vector< uint64_t > starts = { 0, 1, AH_CHUNK_SIZE - 1, AH_CHUNK_SIZE, AH_CHUNK_SIZE + 1, 2 * AH_CHUNK_SIZE,
+         newest - 1, newest, newest + 1, std::numeric_limits< uint64_t >::max() };
+
+      for( const auto& types : selections )
+      {
+         uint32_t matches = 0;
+         for( const auto& e : all )
+            matches += std::count( types.begin(), types.end(), e.op_type ) ? 1 : 0;
+
+         std::vector< uint32_t > limits = { 0, 1, 2, 10, AH_CHUNK_SIZE, matches - 1, matches, matches + 1, 10000 };
+
+         for( auto start : starts )
+            for( auto limit : limits )
+               check_filtered_history( types, start, limit );
+      }
+   }
+
+   /// Crosses `count' orders of alice with a single order of bob, so the block gets a fill_order per match.
+   void make_fills( uint32_t count )
+   {
+      limit_order_create_operation o;
+      o.expiration = db->head_block_time() + fc::hours( 1 );
+
+      o.owner = "alice";
+      o.amount_to_sell = ASSET( "1.000 TESTS" );
+      o.min_to_receive = ASSET( "1.000 TBD" );
+      for( uint32_t i = 0; i < count; ++i )
+      {
+         o.orderid = next_order_id++;
+         push_op( o );
+      }
+
+      o.owner = "bob";
+      o.orderid = next_order_id++;
+      o.amount_to_sell = asset( count * 1000, SBD_SYMBOL );
+      o.min_to_receive = asset( count * 1000, STEEM_SYMBOL );
+      push_op( o );
+
+      generate_block();
+   }
+
+   typedef std::vector< int64_t > vop_ids_type;
+
+   /// Virtual operations of the block range taken from the operation_by_block index, which lists all operations.
+   vop_ids_type walk_virtual_ops( uint32_t begin, uint32_t end, const std::vector< uint32_t >& op_types )const
+   {
+      vop_ids_type result;
+      for( uint32_t block = begin; block < end; ++block )
+      {
+         ah_plugin->find_operations_by_block( block, [&]( const rocksdb_operation_object& op )
+         {
+            uint32_t type = fc::raw::unpack_from_buffer< fc::unsigned_int >( op.serialized_op ).value;
+            if( op.virtual_op > 0 && ( op_types.empty() || std::count( op_types.begin(), op_types.end(), type ) ) )
+               result.push_back( op.id );
+         } );
+      }
+      return result;
+   }
+
+   /// Pages over the block range with given limit, checking every cursor returned on the way.
+   vop_ids_type enum_virtual_ops( uint32_t begin, uint32_t end, const std::vector< uint32_t >& op_types, uint32_t limit,
+      bool* ended_mid_block = nullptr )const
+   {
+      vop_ids_type result;
+      uint64_t cursor = 0;
+
+      do
+      {
+         vop_ids_type page;
+         uint32_t next_block = ah_plugin->enum_virtual_operations( begin, end, cursor, limit, op_types,
+            [&]( const rocksdb_operation_object& op ) { page.push_back( op.id ); }, &cursor );
+
+         BOOST_REQUIRE( limit == 0 || page.size() <= limit );
+         result.insert( result.end(), page.begin(), page.end() );
+
+         if( cursor != 0 )
+         {
+            BOOST_REQUIRE_EQUAL( page.size(), limit );
+            BOOST_REQUIRE_EQUAL( next_block, uint32_t( cursor >> 32 ) );
+            BOOST_REQUIRE_LT( next_block, end );
+
+            rocksdb_operation_object last;
+            BOOST_REQUIRE( ah_plugin->find_operation_object( page.back(), &last ) );
+            if( last.block == next_block && ended_mid_block != nullptr )
+               *ended_mid_block = true;
+         }
+      }
+      while( cursor != 0 );
+
+      return result;
+   }
+
+   account_history_rocksdb_plugin* ah_plugin = nullptr;
+   uint32_t                        next_order_id = 1;
+};
+
+/// Chain built without the plugin, whose history is then imported from the block log.
+struct ah_rocksdb_import_fixture : public ah_rocksdb_fixture
+{
+   ah_rocksdb_import_fixture() : ah_rocksdb_fixture( true ) {}
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE( account_history_rocksdb )
+
+BOOST_AUTO_TEST_CASE( chunk_round_trip )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: account_history_chunk encoding round trip" );
+
+      std::vector< std::vector< int64_t > > cases =
+      {
+         { 0 },
+         { 1, 2, 3 },
+         { 127, 128, 16383, 16384 },
+         { 5, int64_t( 1 ) << 40, ( int64_t( 1 ) << 40 ) + 1, std::numeric_limits< int64_t >::max() },
+         make_ids( 1000000, AH_CHUNK_SIZE, 7 )
+      };
+
+      for( const auto& ids : cases )
+      {
+         std::string value;
+         BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 0, ids ) ) );
+
+         uint16_t count = 0;
+         int64_t last_op_id = 0;
+         BOOST_REQUIRE( account_history_chunk::unpackHeader( value, &count, &last_op_id ) );
+         BOOST_REQUIRE_EQUAL( count, ids.size() );
+         BOOST_REQUIRE_EQUAL( last_op_id, ids.back() );
+
+         auto decoded = decode_chunk( value );
+         BOOST_REQUIRE( decoded == ids );
+      }
+
+      BOOST_TEST_MESSAGE( "--- Appending entry by entry gives the same value" );
+      auto ids = make_ids( 300, 20, 1000 );
+      std::string whole, appended;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &whole, make_operand( 0, ids ) ) );
+      for( size_t i = 0; i < ids.size(); ++i )
+         BOOST_REQUIRE( account_history_chunk::applyOperand( &appended, make_operand( i, ids, i, i + 1 ) ) );
+      BOOST_REQUIRE( whole == appended );
+
+      BOOST_TEST_MESSAGE( "--- Operation ids have to grow" );
+      std::string value;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 0, { 10, 20 } ) ) );
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 2, { 20 } ) ) == false );
+      value.clear();
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 0, { 10, 9 } ) ) == false );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( chunk_overlapping_operands )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: account_history_chunk operands overlapping present entries" );
+
+      auto ids = make_ids( 50, 30, 3 );
+      std::string value;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 0, ids, 0, 10 ) ) );
+
+      BOOST_TEST_MESSAGE( "--- Only entries past the overlap are appended" );
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 5, ids, 5, 15 ) ) );
+      BOOST_REQUIRE( decode_chunk( value ) == std::vector< int64_t >( ids.begin(), ids.begin() + 15 ) );
+
+      BOOST_TEST_MESSAGE( "--- Applying the same operand again does not change the chunk" );
+      std::string before = value;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 5, ids, 5, 15 ) ) );
+      BOOST_REQUIRE( value == before );
+
+      BOOST_TEST_MESSAGE( "--- Operand covered by present entries does not change the chunk" );
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 2, ids, 2, 4 ) ) );
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 0, ids, 0, 15 ) ) );
+      BOOST_REQUIRE( value == before );
+
+      BOOST_TEST_MESSAGE( "--- Operand ending exactly at the last entry does not change the chunk" );
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 14, ids, 14, 15 ) ) );
+      BOOST_REQUIRE( value == before );
+
+      BOOST_TEST_MESSAGE( "--- Operand starting at the chunk end continues it" );
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 15, ids, 15, 30 ) ) );
+      BOOST_REQUIRE( decode_chunk( value ) == ids );
+
+      BOOST_TEST_MESSAGE( "--- Entries past AH_CHUNK_SIZE are not stored" );
+      auto many = make_ids( 1, AH_CHUNK_SIZE + 10 );
+      value.clear();
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 0, many, 0, AH_CHUNK_SIZE - 5 ) ) );
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( AH_CHUNK_SIZE - 10, many, AH_CHUNK_SIZE - 10 ) ) );
+      BOOST_REQUIRE( decode_chunk( value ) == std::vector< int64_t >( many.begin(), many.begin() + AH_CHUNK_SIZE ) );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( chunk_gaps )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: account_history_chunk operands leaving a gap" );
+
+      auto ids = make_ids( 10, 10 );
+      std::string value;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 0, ids, 0, 5 ) ) );
+      std::string before = value;
+
+      BOOST_TEST_MESSAGE( "--- Operand past the chunk end is dropped" );
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, make_operand( 6, ids, 6 ) ) );
+      BOOST_REQUIRE( value == before );
+
+      BOOST_TEST_MESSAGE( "--- Operand continuing a pruned chunk leaves it empty" );
+      std::string pruned;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &pruned, make_operand( 3, ids, 3 ) ) );
+      BOOST_REQUIRE( decode_chunk( pruned ).empty() );
+
+      BOOST_TEST_MESSAGE( "--- Operands are combined only when contiguous or overlapping" );
+      std::string operand = make_operand( 0, ids, 0, 4 );
+      BOOST_REQUIRE( account_history_chunk::combineOperands( &operand, make_operand( 4, ids, 4, 6 ) ) );
+      BOOST_REQUIRE( account_history_chunk::combineOperands( &operand, make_operand( 3, ids, 3, 8 ) ) );
+      BOOST_REQUIRE( account_history_chunk::combineOperands( &operand, make_operand( 1, ids, 1, 2 ) ) );
+      BOOST_REQUIRE( operand == make_operand( 0, ids, 0, 8 ) );
+      BOOST_REQUIRE( account_history_chunk::combineOperands( &operand, make_operand( 9, ids, 9 ) ) == false );
+
+      BOOST_TEST_MESSAGE( "--- Malformed values and operands are rejected" );
+      std::string bad_operand = make_operand( 0, ids ) + 'x';
+      value = before;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, bad_operand ) == false );
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &value, std::string( 1, '\0' ) ) == false );
+      operand = make_operand( 0, ids );
+      BOOST_REQUIRE( account_history_chunk::combineOperands( &operand, bad_operand ) == false );
+
+      std::vector< int64_t > decoded;
+      BOOST_REQUIRE( account_history_chunk::decode( before.substr( 0, account_history_chunk::HEADER_SIZE - 1 ), &decoded ) == false );
+      BOOST_REQUIRE( account_history_chunk::decode( before.substr( 0, before.size() - 1 ), &decoded ) == false );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( chunk_merge_operator )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: account_history_chunk_merge_operator" );
+
+      account_history_chunk_merge_operator merge_op;
+      auto ids = make_ids( 100, 40, 2 );
+
+      /// Operand sequences as written by the import path and by reindexing the same blocks again
+      std::vector< std::vector< std::string > > sequences =
+      {
+         { make_operand( 0, ids, 0, 10 ) },
+         { make_operand( 0, ids, 0, 10 ), make_operand( 10, ids, 10, 20 ), make_operand( 20, ids, 20, 40 ) },
+         { make_operand( 0, ids, 0, 10 ), make_operand( 5, ids, 5, 25 ), make_operand( 0, ids, 0, 10 ), make_operand( 25, ids, 25 ) },
+         { make_operand( 10, ids, 10, 20 ), make_operand( 20, ids, 20, 30 ) },
+         { make_operand( 0, ids, 0, 40 ), make_operand( 0, ids, 0, 40 ) }
+      };
+
+      std::string existing;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &existing, make_operand( 0, ids, 0, 10 ) ) );
+
+      for( const auto& operands : sequences )
+      {
+         for( const std::string* base : std::vector< const std::string* >{ nullptr, &existing } )
+         {
+            std::string expected = base != nullptr ? *base : std::string();
+            for( const auto& operand : operands )
+               BOOST_REQUIRE( account_history_chunk::applyOperand( &expected, operand ) );
+
+            std::string merged;
+            BOOST_REQUIRE( full_merge( base, operands, &merged ) );
+            BOOST_REQUIRE( merged == expected );
+
+            BOOST_TEST_MESSAGE( "--- PartialMergeMulti followed by FullMergeV2 gives the same value" );
+            std::deque< Slice > operand_list( operands.begin(), operands.end() );
+            std::string combined;
+            BOOST_REQUIRE( merge_op.PartialMergeMulti( Slice(), operand_list, &combined, nullptr ) );
+
+            std::string partially_merged;
+            BOOST_REQUIRE( full_merge( base, { combined }, &partially_merged ) );
+            BOOST_REQUIRE( partially_merged == expected );
+         }
+      }
+
+      BOOST_TEST_MESSAGE( "--- PartialMergeMulti refuses operands leaving a gap" );
+      std::vector< std::string > gapped = { make_operand( 0, ids, 0, 10 ), make_operand( 11, ids, 11, 20 ) };
+      std::deque< Slice > operand_list( gapped.begin(), gapped.end() );
+      std::string combined;
+      BOOST_REQUIRE( merge_op.PartialMergeMulti( Slice(), operand_list, &combined, nullptr ) == false );
+
+      BOOST_TEST_MESSAGE( "--- FullMergeV2 fails on a malformed operand" );
+      std::string merged;
+      BOOST_REQUIRE( full_merge( &existing, { make_operand( 10, ids, 10, 20 ), "x" }, &merged ) == false );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( chunk_merge_in_storage )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: account_history_chunk_merge_operator applied by RocksDB" );
+
+      ah_storage_fixture f;
+      auto ids = make_ids( 7, 100, 5 );
+      ah_chunk_slice_t key( std::make_pair( int64_t( 3 ), uint32_t( 0 ) ) );
+
+      /// Overlapping and repeated operands, with flushes in between so RocksDB gets to merge them partially
+      std::vector< std::pair< size_t, size_t > > ranges = { { 0, 20 }, { 20, 30 }, { 10, 50 }, { 50, 60 }, { 0, 60 }, { 60, 100 } };
+      for( size_t i = 0; i < ranges.size(); ++i )
+      {
+         BOOST_REQUIRE( f.storage->Merge( ::rocksdb::WriteOptions(), key, make_operand( ranges[i].first, ids, ranges[i].first, ranges[i].second ) ).ok() );
+         if( i % 2 )
+            BOOST_REQUIRE( f.storage->Flush( ::rocksdb::FlushOptions() ).ok() );
+      }
+
+      /// Operand leaving a gap is dropped by the merge instead of failing the read
+      BOOST_REQUIRE( f.storage->Merge( ::rocksdb::WriteOptions(), key, make_operand( 120, ids, 0, 1 ) ).ok() );
+
+      std::string value;
+      BOOST_REQUIRE( f.storage->Get( ReadOptions(), key, &value ).ok() );
+      BOOST_REQUIRE( decode_chunk( value ) == ids );
+
+      BOOST_REQUIRE( f.storage->CompactRange( ::rocksdb::CompactRangeOptions(), nullptr, nullptr ).ok() );
+      BOOST_REQUIRE( f.storage->Get( ReadOptions(), key, &value ).ok() );
+      BOOST_REQUIRE( decode_chunk( value ) == ids );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( entry_bitmap_merge )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: entry_bitmap_merge_operator" );
+
+      auto bitmap = make_bitmap( { 0, 7, 8, AH_CHUNK_SIZE - 1 } );
+      BOOST_REQUIRE_EQUAL( bitmap.size(), size_t( AH_CHUNK_BITMAP_SIZE ) );
+      for( uint32_t p = 0; p < AH_CHUNK_SIZE; ++p )
+         BOOST_REQUIRE_EQUAL( entry_bitmap_merge_operator::isSet( bitmap, p ), p == 0 || p == 7 || p == 8 || p == AH_CHUNK_SIZE - 1 );
+
+      entry_bitmap_merge_operator merge_op;
+      std::string merged;
+
+      BOOST_REQUIRE( merge_op.Merge( Slice(), nullptr, bitmap, &merged, nullptr ) );
+      BOOST_REQUIRE( merged == bitmap );
+
+      Slice existing( bitmap );
+      auto other = make_bitmap( { 1, 8, 100 } );
+      BOOST_REQUIRE( merge_op.Merge( Slice(), &existing, other, &merged, nullptr ) );
+      BOOST_REQUIRE( merged == make_bitmap( { 0, 1, 7, 8, 100, AH_CHUNK_SIZE - 1 } ) );
+
+      BOOST_TEST_MESSAGE( "--- Bitmaps of a wrong size are rejected" );
+      Slice short_existing( bitmap.data(), bitmap.size() - 1 );
+      BOOST_REQUIRE( merge_op.Merge( Slice(), &short_existing, other, &merged, nullptr ) == false );
+      BOOST_REQUIRE( merge_op.Merge( Slice(), &existing, other + 'x', &merged, nullptr ) == false );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( ah_prune_filter_boundaries )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: ah_prune_filter boundaries" );
+
+      ah_storage_fixture f;
+      const int64_t ah_id = 2;
+      auto full = make_ids( 1000, AH_CHUNK_SIZE );
+      const uint32_t last_entry = AH_CHUNK_SIZE - 1;
+      std::string chunk;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &chunk, make_operand( 0, full ) ) );
+
+      f.put_op( full.back(), NEWEST_TIME - fc::days( ACCOUNT_HISTORY_TIME_LIMIT ) - fc::seconds( 1 ) );
+      f.state.setNewestEntry( ah_id, last_entry + ACCOUNT_HISTORY_LENGTH_LIMIT );
+
+      BOOST_TEST_MESSAGE( "--- Nothing is pruned before the newest operation time is known" );
+      BOOST_REQUIRE( f.is_pruned( ah_id, 0, chunk ) == false );
+
+      f.state.setNewestTimestamp( NEWEST_TIME );
+      BOOST_REQUIRE( f.is_pruned( ah_id, 0, chunk ) );
+
+      BOOST_TEST_MESSAGE( "--- Chunk still within ACCOUNT_HISTORY_LENGTH_LIMIT entries is kept" );
+      f.state.setNewestEntry( ah_id, last_entry + ACCOUNT_HISTORY_LENGTH_LIMIT - 1 );
+      BOOST_REQUIRE( f.is_pruned( ah_id, 0, chunk ) == false );
+      f.state.setNewestEntry( ah_id, last_entry + ACCOUNT_HISTORY_LENGTH_LIMIT );
+
+      BOOST_TEST_MESSAGE( "--- Chunk of an unknown account history is kept" );
+      BOOST_REQUIRE( f.is_pruned( ah_id + 1, 0, chunk ) == false );
+      BOOST_REQUIRE( f.is_pruned( -1, 0, chunk ) == false );
+
+      BOOST_TEST_MESSAGE( "--- Chunk whose last operation is exactly ACCOUNT_HISTORY_TIME_LIMIT old is kept" );
+      f.put_op( full.back(), NEWEST_TIME - fc::days( ACCOUNT_HISTORY_TIME_LIMIT ) );
+      BOOST_REQUIRE( f.is_pruned( ah_id, 0, chunk ) == false );
+      f.put_op( full.back(), NEWEST_TIME - fc::days( ACCOUNT_HISTORY_TIME_LIMIT ) - fc::seconds( 1 ) );
+
+      BOOST_TEST_MESSAGE( "--- Chunk pointing to an unknown operation is kept" );
+      std::string unknown_op_chunk;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &unknown_op_chunk, make_operand( 0, make_ids( 5000, AH_CHUNK_SIZE ) ) ) );
+      BOOST_REQUIRE( f.is_pruned( ah_id, 0, unknown_op_chunk ) == false );
+
+      BOOST_TEST_MESSAGE( "--- Partial chunk is kept even if old and out of the window" );
+      std::string partial;
+      BOOST_REQUIRE( account_history_chunk::applyOperand( &partial, make_operand( 0, full, 0, AH_CHUNK_SIZE - 1 ) ) );
+      f.put_op( full[ AH_CHUNK_SIZE - 2 ], NEWEST_TIME - fc::days( 2 * ACCOUNT_HISTORY_TIME_LIMIT ) );
+      f.state.setNewestEntry( ah_id, 10 * AH_CHUNK_SIZE );
+      BOOST_REQUIRE( f.is_pruned( ah_id, 0, partial ) == false );
+
+      BOOST_TEST_MESSAGE( "--- Window is measured from the last entry of the chunk" );
+      f.state.setNewestEntry( ah_id, 2 * AH_CHUNK_SIZE + last_entry + ACCOUNT_HISTORY_LENGTH_LIMIT - 1 );
+      BOOST_REQUIRE( f.is_pruned( ah_id, 1, chunk ) );
+      BOOST_REQUIRE( f.is_pruned( ah_id, 2, chunk ) == false );
+
+      BOOST_TEST_MESSAGE( "--- Values which are not chunks are kept" );
+      BOOST_REQUIRE( f.is_pruned( ah_id, 0, chunk.substr( 0, account_history_chunk::HEADER_SIZE - 1 ) ) == false );
+      ah_prune_filter filter( f.state );
+      std::string new_value;
+      bool value_changed = false;
+      BOOST_REQUIRE( filter.Filter( 0, id_slice_t( ah_id ), chunk, &new_value, &value_changed ) == false );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( ah_prune_filter_compaction )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: ah_prune_filter during compaction" );
+
+      ah_storage_fixture f;
+      const int64_t ah_id = 0;
+
+      /// Chunks 0 and 1 are old, chunks 2 and 3 are recent, chunk 4 is partial
+      std::vector< std::vector< int64_t > > chunks;
+      for( uint32_t c = 0; c < 5; ++c )
+         chunks.push_back( make_ids( 1 + c * AH_CHUNK_SIZE, c < 4 ? AH_CHUNK_SIZE : 10 ) );
+
+      f.put_op( chunks[0].back(), NEWEST_TIME - fc::days( 40 ) );
+      f.put_op( chunks[1].back(), NEWEST_TIME - fc::days( 31 ) );
+      f.put_op( chunks[2].back(), NEWEST_TIME - fc::days( 29 ) );
+      f.put_op( chunks[3].back(), NEWEST_TIME - fc::days( 1 ) );
+      f.put_op( chunks[4].back(), NEWEST_TIME );
+
+      for( uint32_t c = 0; c < chunks.size(); ++c )
+         f.put_chunk( ah_id, c, chunks[c] );
+
+      /// Old chunk of another account history, which has no newer entries
+      f.put_chunk( ah_id + 1, 0, chunks[0] );
+
+      f.state.setNewestEntry( ah_id, 4 * AH_CHUNK_SIZE + 9 );
+      f.state.setNewestEntry( ah_id + 1, AH_CHUNK_SIZE - 1 );
+      f.state.setNewestTimestamp( NEWEST_TIME );
+
+      BOOST_REQUIRE( f.storage->CompactRange( ::rocksdb::CompactRangeOptions(), nullptr, nullptr ).ok() );
+
+      BOOST_REQUIRE( f.has_chunk( ah_id, 0 ) == false );
+      BOOST_REQUIRE( f.has_chunk( ah_id, 1 ) == false );
+      BOOST_REQUIRE( f.has_chunk( ah_id, 2 ) );
+      BOOST_REQUIRE( f.has_chunk( ah_id, 3 ) );
+      BOOST_REQUIRE( f.has_chunk( ah_id, 4 ) );
+      BOOST_REQUIRE( f.has_chunk( ah_id + 1, 0 ) );
+
+      BOOST_TEST_MESSAGE( "--- Age of pruned chunks is bounded by the first operation of the oldest kept one" );
+      BOOST_REQUIRE( f.state.isChunkTooOld( ah_id, 0 ) == false );
+      f.put_op( chunks[2].front(), NEWEST_TIME - fc::days( ACCOUNT_HISTORY_TIME_LIMIT ) - fc::seconds( 1 ) );
+      BOOST_REQUIRE( f.state.isChunkTooOld( ah_id, 0 ) );
+      BOOST_REQUIRE( f.state.isChunkTooOld( ah_id, 1 ) );
+      BOOST_REQUIRE( f.state.isChunkTooOld( ah_id, 2 ) == false );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( ah_op_type_prune_filter_rule )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: ah_op_type_prune_filter follows the rule of ah_prune_filter" );
+
+      ah_storage_fixture f;
+      const int64_t ah_id = 0;
+
+      /// Chunk 0 is old, chunk 1 is old apart from its last entry, chunk 2 is recent and chunk 3 is partial
+      std::vector< std::vector< int64_t > > chunks;
+      for( uint32_t c = 0; c < 4; ++c )
+         chunks.push_back( make_ids( 1 + c * AH_CHUNK_SIZE, c < 3 ? AH_CHUNK_SIZE : 10 ) );
+
+      const auto old_time = NEWEST_TIME - fc::days( ACCOUNT_HISTORY_TIME_LIMIT ) - fc::seconds( 1 );
+      f.put_op( chunks[0].back(), old_time );
+      f.put_op( chunks[1].front(), old_time );
+      f.put_op( chunks[1].back(), NEWEST_TIME - fc::days( 1 ) );
+      f.put_op( chunks[2].front(), NEWEST_TIME - fc::days( 1 ) );
+      f.put_op( chunks[2].back(), NEWEST_TIME );
+      f.put_op( chunks[3].back(), old_time );
+
+      f.state.setNewestEntry( ah_id, 10 * AH_CHUNK_SIZE );
+      f.state.setNewestTimestamp( NEWEST_TIME );
+
+      BOOST_TEST_MESSAGE( "--- Bitmaps ingested ahead of their chunks are kept" );
+      for( uint32_t c = 0; c < 4; ++c )
+         BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, c ) == false );
+
+      for( uint32_t c = 0; c < chunks.size(); ++c )
+         f.put_chunk( ah_id, c, chunks[c] );
+
+      BOOST_TEST_MESSAGE( "--- Bitmaps are judged by the last entry of their full chunk" );
+      BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, 0 ) );
+      BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, 1 ) == false );
+      BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, 2 ) == false );
+      BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, 3 ) == false );
+      BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, 4 ) == false );
+
+      BOOST_TEST_MESSAGE( "--- Bitmap within ACCOUNT_HISTORY_LENGTH_LIMIT entries is kept" );
+      f.state.setNewestEntry( ah_id, AH_CHUNK_SIZE - 1 + ACCOUNT_HISTORY_LENGTH_LIMIT - 1 );
+      BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, 0 ) == false );
+      f.state.setNewestEntry( ah_id, 10 * AH_CHUNK_SIZE );
+
+      BOOST_TEST_MESSAGE( "--- Bitmaps of pruned chunks are judged by the next chunk kept" );
+      BOOST_REQUIRE( f.storage->Delete( ::rocksdb::WriteOptions(), ah_chunk_slice_t( std::make_pair( ah_id, 0u ) ) ).ok() );
+      BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, 0 ) );
+      BOOST_REQUIRE( f.storage->Delete( ::rocksdb::WriteOptions(), ah_chunk_slice_t( std::make_pair( ah_id, 1u ) ) ).ok() );
+      BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, 0 ) == false );
+      BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, 1 ) == false );
+
+      BOOST_TEST_MESSAGE( "--- Chunks of another account history do not count" );
+      BOOST_REQUIRE( f.storage->Delete( ::rocksdb::WriteOptions(), ah_chunk_slice_t( std::make_pair( ah_id, 2u ) ) ).ok() );
+      BOOST_REQUIRE( f.storage->Delete( ::rocksdb::WriteOptions(), ah_chunk_slice_t( std::make_pair( ah_id, 3u ) ) ).ok() );
+      f.put_chunk( ah_id + 1, 0, chunks[0] );
+      BOOST_REQUIRE( f.is_bitmap_pruned( ah_id, 0 ) == false );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_FIXTURE_TEST_SUITE( account_history_rocksdb_plugin, ah_rocksdb_fixture )
+
+BOOST_AUTO_TEST_CASE( filtered_history )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: account history walk filtered by operation types" );
+
+      ACTORS( (alice)(bob) );
+      fund( "alice", ASSET( "1000.000 TESTS" ) );
+      fund( "bob", ASSET( "1000.000 TESTS" ) );
+      generate_block();
+
+      make_history( 800 );
+      make_irreversible();
+
+      auto all = find_history( std::numeric_limits< uint64_t >::max(), std::numeric_limits< uint32_t >::max() );
+      BOOST_REQUIRE_EQUAL( all.size(), all.front().sequence + 1 );
+      BOOST_REQUIRE_GT( all.size(), 3 * AH_CHUNK_SIZE );
+
+      check_filtered_history();
+
+      BOOST_TEST_MESSAGE( "--- Pruned chunks are skipped" );
+      generate_blocks( db->head_block_time() + fc::days( ACCOUNT_HISTORY_TIME_LIMIT + 1 ) );
+      make_history( 2 * ACCOUNT_HISTORY_LENGTH_LIMIT );
+      make_irreversible();
+
+      ah_plugin->compact_account_history();
+
+      /// Whole chunks older than the time limit are gone, the unfiltered walk skips them as well
+      auto kept = find_history( std::numeric_limits< uint64_t >::max(), std::numeric_limits< uint32_t >::max() );
+      BOOST_REQUIRE_GT( kept.front().sequence, all.front().sequence );
+      BOOST_REQUIRE_EQUAL( kept.back().sequence % AH_CHUNK_SIZE, 0u );
+      BOOST_REQUIRE_GE( kept.back().sequence, 2 * AH_CHUNK_SIZE );
+      BOOST_REQUIRE_EQUAL( kept.size(), kept.front().sequence - kept.back().sequence + 1 );
+
+      check_filtered_history();
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( imported_history_pruning, ah_rocksdb_import_fixture )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: account history imported in parallel with pruning enabled" );
+
+      ACTORS( (alice)(bob) );
+      fund( "alice", ASSET( "1000.000 TESTS" ) );
+      fund( "bob", ASSET( "1000.000 TESTS" ) );
+      generate_block();
+
+      /// More blocks than a single import chunk holds on both sides of the time limit
+      make_history( 1200 );
+      generate_blocks( db->head_block_time() + fc::days( ACCOUNT_HISTORY_TIME_LIMIT + 1 ) );
+      make_history( 1200 );
+      make_irreversible();
+
+      import_history();
+      ah_plugin->compact_account_history();
+
+      auto kept = find_history( std::numeric_limits< uint64_t >::max(), std::numeric_limits< uint32_t >::max() );
+      BOOST_REQUIRE( kept.empty() == false );
+      BOOST_REQUIRE_GT( kept.back().sequence, 0u );
+      BOOST_REQUIRE_EQUAL( kept.back().sequence % AH_CHUNK_SIZE, 0u );
+      BOOST_REQUIRE_EQUAL( kept.size(), kept.front().sequence - kept.back().sequence + 1 );
+
+      check_filtered_history();
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( enum_virtual_ops_paging )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: paging over the virtual_operation_by_block index" );
+
+      ACTORS( (alice)(bob) );
+      fund( "alice", ASSET( "1000.000 TESTS" ) );
+      fund( "bob", ASSET( "1000.000 TBD" ) );
+      generate_block();
+
+      uint32_t begin = db->head_block_num() + 1;
+      for( uint32_t i = 0; i < 20; ++i )
+         make_fills( 1 + i % 4 );
+      uint32_t end = db->head_block_num() + 1;
+      make_irreversible();
+
+      uint32_t fill = operation::tag< fill_order_operation >::value;
+      uint32_t transfer = operation::tag< transfer_operation >::value;
+
+      BOOST_TEST_MESSAGE( "--- The index lists the virtual operations of the block index" );
+      auto all = walk_virtual_ops( begin, end, {} );
+      auto fills = walk_virtual_ops( begin, end, { fill } );
+      BOOST_REQUIRE_GE( fills.size(), 50u );
+      BOOST_REQUIRE_GT( all.size(), fills.size() );
+      BOOST_REQUIRE( enum_virtual_ops( begin, end, {}, 0 ) == all );
+      BOOST_REQUIRE( enum_virtual_ops( begin, end, { fill }, 0 ) == fills );
+      BOOST_REQUIRE( enum_virtual_ops( begin + 3, begin + 7, {}, 0 ) == walk_virtual_ops( begin + 3, begin + 7, {} ) );
+
+      BOOST_TEST_MESSAGE( "--- Pages resume at their cursor, also in the middle of a block" );
+      bool ended_mid_block = false;
+      for( uint32_t limit : { 1u, 2u, 3u, 7u, uint32_t( all.size() - 1 ), uint32_t( all.size() ), uint32_t( all.size() + 1 ) } )
+      {
+         BOOST_REQUIRE( enum_virtual_ops( begin, end, {}, limit, &ended_mid_block ) == all );
+         BOOST_REQUIRE( enum_virtual_ops( begin, end, { fill }, limit, &ended_mid_block ) == fills );
+      }
+      BOOST_REQUIRE( ended_mid_block );
+
+      BOOST_TEST_MESSAGE( "--- Cursor outside of the block range is rejected" );
+      uint64_t cursor = 0;
+      auto ignore = []( const rocksdb_operation_object& ) {};
+      STEEM_REQUIRE_THROW( ah_plugin->enum_virtual_operations( begin + 1, end, uint64_t( begin ) << 32, 0, {}, ignore, &cursor ),
+         fc::exception );
+
+      BOOST_TEST_MESSAGE( "--- Filter matching nothing" );
+      for( uint32_t limit : { 0u, 1u, 10u } )
+      {
+         vop_ids_type page;
+         ah_plugin->enum_virtual_operations( begin, end, 0, limit, { transfer },
+            [&]( const rocksdb_operation_object& op ) { page.push_back( op.id ); }, &cursor );
+         BOOST_REQUIRE( page.empty() );
+         BOOST_REQUIRE_EQUAL( cursor, 0u );
+      }
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
@@ -0,0 +1,207 @@
+#ifdef IS_TEST_NET
+#include <boost/test/unit_test.hpp>
+
+#include <steem/chain/account_object.hpp>
+#include <steem/protocol/steem_operations.hpp>
+
+#include <steem/plugins/block_data_export/block_data_export_plugin.hpp>
+#include <steem/plugins/block_data_export/binary_export_format.hpp>
+#include <steem/plugins/rc/rc_export_objects.hpp>
+#include <steem/plugins/rc/rc_plugin.hpp>
+
+#include <steem/utilities/tempdir.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <fstream>
+
+#include "../db_fixture/database_fixture.hpp"
+
+using namespace steem::chain;
+using namespace steem::protocol;
+using namespace steem::plugins::block_data_export;
+using steem::plugins::rc::exp_rc_data;
+
+namespace {
+
+/// Directory of the export file, a base of block_data_export_fixture so that it outlives the plugin.
+struct block_data_export_dir
+{
+   fc::temp_directory export_dir{ steem::utilities::temp_directory_path() };
+};
+
+/// Chain exporting the RC data of every block in the binary format, keeping the JSON of each exported object aside.
+struct block_data_export_fixture : public block_data_export_dir, public database_fixture
+{
+   /// Without `generate_blocks' the chain stays at genesis, so that nothing gets exported.
+   explicit block_data_export_fixture( bool generate_blocks = true )
+   {
+      try
+      {
+         export_plugin = &appbase::app().register_plugin< block_data_export_plugin >();
+         appbase::app().register_plugin< steem::plugins::rc::rc_plugin >();
+         db_plugin = &appbase::app().register_plugin< steem::plugins::debug_node::debug_node_plugin >();
+         init_account_pub_key = init_account_priv_key.get_public_key();
+
+         export_file = ( export_dir.path() / "export.bin" ).string();
+         std::string file_arg = "--block-data-export-file=" + export_file;
+         int test_argc = 3;
+         const char* test_argv[] = { boost::unit_test::framework::master_test_suite().argv[0], file_arg.c_str(),
+                                     "--block-data-export-format=binary" };
+
+         db_plugin->logging = false;
+         // The RC plugin registers its export data only with an initialized export plugin
+         appbase::app().initialize< block_data_export_plugin, steem::plugins::rc::rc_plugin,
+            steem::plugins::debug_node::debug_node_plugin >( test_argc, (char**)test_argv );
+
+         steem::plugins::rc::rc_plugin_skip_flags rc_skip;
+         rc_skip.skip_reject_not_enough_rc = 1;
+         rc_skip.skip_deduct_rc = 0;
+         rc_skip.skip_negative_rc_balance = 1;
+         rc_skip.skip_reject_unknown_delta_vests = 0;
+         appbase::app().get_plugin< steem::plugins::rc::rc_plugin >().set_rc_plugin_skip_flags( rc_skip );
+
+         db = &appbase::app().get_plugin< steem::plugins::chain::chain_plugin >().db();
+         BOOST_REQUIRE( db );
+
+         // Between the RC plugin filling its export data (group 0) and the export plugin queuing it (9300)
+         exported_conn = db->add_post_apply_block_handler( [&]( const block_notification& note )
+         {
+            auto data = find_export_data< exp_rc_data >( STEEM_RC_PLUGIN_NAME );
+            BOOST_REQUIRE( data );
+
+            fc::variant v;
+            data->to_variant( v );
+            exported.emplace_back( note.block_id, fc::json::to_string( v ) );
+         }, *db_plugin, 9000 );
+
+         open_database();
+         if( !generate_blocks )
+            return;
+
+         generate_block();
+         db->set_hardfork( STEEM_NUM_HARDFORKS );
+         generate_block();
+
+         vest( STEEM_INIT_MINER_NAME, 10000 );
+         generate_block();
+         validate_database();
+      }
+      catch( const fc::exception& e )
+      {
+         edump( (e.to_detail_string()) );
+         throw;
+      }
+   }
+
+   ~block_data_export_fixture()
+   {
+      finish_export();
+   }
+
+   /// Stops the export threads, after which the file is complete.
+   void finish_export()
+   {
+      if( export_finished )
+         return;
+
+      steem::chain::util::disconnect_signal( exported_conn );
+      export_plugin->plugin_shutdown();
+      export_finished = true;
+   }
+
+   block_data_export_plugin*                                   export_plugin = nullptr;
+   std::string                                                 export_file;
+   boost::signals2::connection                                 exported_conn;
+   std::vector< std::pair< block_id_type, std::string > >     exported;
+   bool                                                        export_finished = false;
+};
+
+struct block_data_export_empty_fixture : public block_data_export_fixture
+{
+   block_data_export_empty_fixture() : block_data_export_fixture( false ) {}
+};
+
+}
+
+BOOST_FIXTURE_TEST_SUITE( block_data_export, block_data_export_fixture )
+
+BOOST_AUTO_TEST_CASE( binary_round_trip )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: binary export read back against the exported objects" );
+
+      ACTORS( (alice)(bob) );
+      vest( STEEM_INIT_MINER_NAME, "alice", ASSET( "1000.000 TESTS" ) );
+      fund( "alice", ASSET( "100.000 TESTS" ) );
+      generate_block();
+
+      // Blocks with several transactions, with one and with none
+      for( int i = 0; i < 5; ++i )
+      {
+         for( int j = 0; j < i % 3; ++j )
+            transfer( "alice", "bob", asset( 1 + 10 * i + j, STEEM_SYMBOL ) );
+         generate_block();
+      }
+
+      finish_export();
+      BOOST_REQUIRE( !exported.empty() );
+
+      std::ifstream input( export_file, std::ios::binary );
+      BOOST_REQUIRE( input );
+
+      binary_export_reader reader( input );
+      reader.add_raw_decoder< exp_rc_data >();
+
+      const auto& types = reader.get_header().types;
+      BOOST_REQUIRE_EQUAL( types.size(), 1u );
+      BOOST_REQUIRE_EQUAL( types[0].name, STEEM_RC_PLUGIN_NAME );
+      BOOST_REQUIRE_EQUAL( types[0].type_name, fc::get_typename< exp_rc_data >::name() );
+      BOOST_REQUIRE( types[0].encoding == raw_encoding );
+
+      size_t tx_count = 0;
+      fc::variant block;
+      for( const auto& e : exported )
+      {
+         BOOST_REQUIRE( reader.read_block( block ) );
+         BOOST_REQUIRE( block[ "block_id" ].as< block_id_type >() == e.first );
+
+         const auto& rc = block[ "export_data" ][ STEEM_RC_PLUGIN_NAME ];
+         BOOST_REQUIRE_EQUAL( fc::json::to_string( rc ), e.second );
+         tx_count += rc[ "tx_info" ].get_array().size();
+      }
+      BOOST_REQUIRE( !reader.read_block( block ) );
+
+      // The test is only worth something if transactions made it into the export
+      BOOST_REQUIRE_GE( tx_count, 4u );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( binary_empty_export, block_data_export_empty_fixture )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: binary export of no blocks still has its header" );
+
+      finish_export();
+      BOOST_REQUIRE( exported.empty() );
+
+      std::ifstream input( export_file, std::ios::binary );
+      BOOST_REQUIRE( input );
+
+      binary_export_reader reader( input );
+
+      const auto& types = reader.get_header().types;
+      BOOST_REQUIRE_EQUAL( types.size(), 1u );
+      BOOST_REQUIRE_EQUAL( types[0].type_name, fc::get_typename< exp_rc_data >::name() );
+
+      fc::variant block;
+      BOOST_REQUIRE( !reader.read_block( block ) );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
@@ -0,0 +1,385 @@
+#ifdef IS_TEST_NET
+#include <boost/test/unit_test.hpp>
+
+#include <steem/chain/account_object.hpp>
+#include <steem/protocol/steem_operations.hpp>
+
+#include <steem/plugins/chain/change_stream.hpp>
+
+#include "../db_fixture/database_fixture.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace steem::chain;
+using namespace steem::protocol;
+using steem::plugins::chain::applied_block;
+using steem::plugins::chain::change_stream;
+
+namespace {
+
+/// Holds consumers on the change stream thread until the test opens it.
+class gate
+{
+   public:
+      void pass()
+      {
+         std::unique_lock< std::mutex > lock( _mutex );
+         ++_waiting;
+         _cv.notify_all();
+         _cv.wait( lock, [this]() { return _open; } );
+      }
+
+      /// Returns once a consumer is held
+      void wait_for_consumer()
+      {
+         std::unique_lock< std::mutex > lock( _mutex );
+         _cv.wait( lock, [this]() { return _waiting > 0; } );
+      }
+
+      void open()
+      {
+         std::lock_guard< std::mutex > lock( _mutex );
+         _open = true;
+         _cv.notify_all();
+      }
+
+   private:
+      std::mutex              _mutex;
+      std::condition_variable _cv;
+      uint32_t                _waiting = 0;
+      bool                    _open = false;
+};
+
+/// What a consumer has been called with, written on the change stream thread.
+struct consumer_record
+{
+   void add_block( const std::shared_ptr< const applied_block >& b )
+   {
+      std::lock_guard< std::mutex > lock( mutex );
+      blocks.push_back( b );
+   }
+
+   void add_irreversible( uint32_t block_num )
+   {
+      std::lock_guard< std::mutex > lock( mutex );
+      irreversible.push_back( block_num );
+   }
+
+   size_t irreversible_count()
+   {
+      std::lock_guard< std::mutex > lock( mutex );
+      return irreversible.size();
+   }
+
+   std::vector< uint32_t > block_nums()
+   {
+      std::lock_guard< std::mutex > lock( mutex );
+      std::vector< uint32_t > result;
+      for( const auto& b : blocks )
+         result.push_back( b->block_num );
+      return result;
+   }
+
+   std::mutex                                               mutex;
+   std::vector< std::shared_ptr< const applied_block > >    blocks;
+   std::vector< uint32_t >                                  irreversible;
+};
+
+/// Chain feeding change streams the tests create on top of it, so that they can also be stopped and bounded.
+struct change_stream_fixture : public database_fixture
+{
+   change_stream_fixture()
+   {
+      try
+      {
+         db_plugin = &appbase::app().register_plugin< steem::plugins::debug_node::debug_node_plugin >();
+         init_account_pub_key = init_account_priv_key.get_public_key();
+
+         int test_argc = 1;
+         const char* test_argv[] = { boost::unit_test::framework::master_test_suite().argv[0] };
+
+         db_plugin->logging = false;
+         appbase::app().initialize< steem::plugins::debug_node::debug_node_plugin >( test_argc, (char**)test_argv );
+
+         db = &appbase::app().get_plugin< steem::plugins::chain::chain_plugin >().db();
+         BOOST_REQUIRE( db );
+
+         open_database();
+
+         generate_block();
+         db->set_hardfork( STEEM_NUM_HARDFORKS );
+         generate_block();
+
+         vest( STEEM_INIT_MINER_NAME, 10000 );
+
+         // From here on every block makes the one STEEM_MAX_WITNESSES before it irreversible
+         generate_blocks( STEEM_MAX_WITNESSES );
+         validate_database();
+      }
+      catch( const fc::exception& e )
+      {
+         edump( (e.to_detail_string()) );
+         throw;
+      }
+   }
+
+   change_stream::consumer_id add_recorder( change_stream& stream, consumer_record& record,
+      const steem::plugins::chain::async_block_filter_t& filter = steem::plugins::chain::async_block_filter_t(), gate* g = nullptr )
+   {
+      return stream.add_consumer( *db_plugin,
+         [&record, g]( const std::shared_ptr< const applied_block >& b )
+         {
+            if( g != nullptr )
+               g->pass();
+            record.add_block( b );
+         },
+         [&record]( uint32_t block_num ) { record.add_irreversible( block_num ); },
+         filter );
+   }
+
+   void wait_for_delivery( const change_stream& stream )
+   {
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+      while( stream.backlog() > 0 )
+      {
+         BOOST_REQUIRE( std::chrono::steady_clock::now() < deadline );
+         std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+      }
+   }
+
+   /// Blocks are delivered as applied, in order and each with the operations it produced.
+   void check_blocks( consumer_record& record, uint32_t first_block_num, uint32_t last_block_num )
+   {
+      std::lock_guard< std::mutex > lock( record.mutex );
+      BOOST_REQUIRE_EQUAL( record.blocks.size(), last_block_num - first_block_num + 1 );
+
+      for( uint32_t i = 0; i < record.blocks.size(); ++i )
+      {
+         const auto& b = *record.blocks[i];
+         BOOST_REQUIRE_EQUAL( b.block_num, first_block_num + i );
+         BOOST_REQUIRE( b.block_id == db->get_block_id_for_num( b.block_num ) );
+         BOOST_REQUIRE( b.block.id() == b.block_id );
+
+         size_t transfers = 0, rewards = 0;
+         for( const auto& o : b.ops )
+         {
+            if( o.op.which() == operation::tag< transfer_operation >::value )
+               ++transfers;
+            else if( o.op.which() == operation::tag< producer_reward_operation >::value )
+               ++rewards;
+         }
+
+         size_t block_transfers = 0;
+         for( const auto& tx : b.block.transactions )
+            for( const auto& op : tx.operations )
+               block_transfers += op.which() == operation::tag< transfer_operation >::value;
+
+         BOOST_REQUIRE_EQUAL( transfers, block_transfers );
+         BOOST_REQUIRE_EQUAL( rewards, 1u );
+      }
+   }
+
+   void check_irreversible( consumer_record& record )
+   {
+      std::lock_guard< std::mutex > lock( record.mutex );
+      BOOST_REQUIRE( !record.irreversible.empty() );
+      for( size_t i = 1; i < record.irreversible.size(); ++i )
+         BOOST_REQUIRE_EQUAL( record.irreversible[i], record.irreversible[i - 1] + 1 );
+      BOOST_REQUIRE_EQUAL( record.irreversible.back(), db->get_dynamic_global_properties().last_irreversible_block_num );
+   }
+};
+
+}
+
+BOOST_FIXTURE_TEST_SUITE( change_stream_tests, change_stream_fixture )
+
+BOOST_AUTO_TEST_CASE( ordering_and_filter )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: change stream delivers blocks in order, only those its filter asks for" );
+
+      ACTORS( (alice)(bob) );
+      fund( "alice", ASSET( "100.000 TESTS" ) );
+      generate_block();
+
+      consumer_record record;
+      std::atomic< bool > wanted( true );
+      std::atomic< uint32_t > filter_calls( 0 );
+
+      change_stream stream( *db, *db_plugin );
+      add_recorder( stream, record, [&]() { ++filter_calls; return wanted.load(); } );
+
+      uint32_t first = db->head_block_num() + 1;
+      for( int i = 0; i < 6; ++i )
+      {
+         for( int j = 0; j < i % 3; ++j )
+            transfer( "alice", "bob", asset( 1 + 10 * i + j, STEEM_SYMBOL ) );
+         generate_block();
+      }
+      uint32_t last = db->head_block_num();
+
+      wait_for_delivery( stream );
+      check_blocks( record, first, last );
+      BOOST_REQUIRE_EQUAL( filter_calls.load(), last - first + 1 );
+
+      BOOST_TEST_MESSAGE( "--- Blocks no consumer wants are not collected" );
+      wanted = false;
+      size_t delivered = last - first + 1;
+      size_t irreversible_before = record.irreversible_count();
+      transfer( "alice", "bob", ASSET( "1.000 TESTS" ) );
+      generate_blocks( 3 );
+      wait_for_delivery( stream );
+      BOOST_REQUIRE_EQUAL( record.block_nums().size(), delivered );
+      BOOST_REQUIRE_EQUAL( filter_calls.load(), delivered + 3 );
+
+      // Irreversible blocks are not subject to the filter
+      BOOST_REQUIRE_EQUAL( record.irreversible_count(), irreversible_before + 3 );
+
+      wanted = true;
+      first = db->head_block_num() + 1;
+      transfer( "alice", "bob", ASSET( "2.000 TESTS" ) );
+      generate_blocks( 2 );
+      wait_for_delivery( stream );
+
+      {
+         std::lock_guard< std::mutex > lock( record.mutex );
+         record.blocks.erase( record.blocks.begin(), record.blocks.begin() + delivered );
+      }
+      check_blocks( record, first, db->head_block_num() );
+      check_irreversible( record );
+
+      stream.stop();
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( remove_consumer_waits_for_dispatch )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: removing a consumer waits until it is no longer being called" );
+
+      consumer_record held, other;
+      gate g;
+
+      change_stream stream( *db, *db_plugin );
+      auto held_id = add_recorder( stream, held, steem::plugins::chain::async_block_filter_t(), &g );
+      add_recorder( stream, other );
+
+      generate_block();
+      g.wait_for_consumer();
+
+      std::atomic< bool > removed( false );
+      std::thread remover( [&]()
+      {
+         stream.remove_consumer( held_id );
+         removed = true;
+      });
+
+      std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+      BOOST_REQUIRE( !removed );
+
+      g.open();
+      remover.join();
+      BOOST_REQUIRE( removed );
+      BOOST_REQUIRE_EQUAL( held.block_nums().size(), 1u );
+
+      // The removed consumer is never called again, the other one keeps going
+      uint32_t first = db->head_block_num();
+      generate_blocks( 3 );
+      wait_for_delivery( stream );
+
+      BOOST_REQUIRE_EQUAL( held.block_nums().size(), 1u );
+      check_blocks( other, first, db->head_block_num() );
+
+      stream.stop();
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( stop_delivers_queued_events )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: stopping the change stream delivers the events still queued" );
+
+      consumer_record record;
+      gate g;
+
+      change_stream stream( *db, *db_plugin );
+      add_recorder( stream, record, steem::plugins::chain::async_block_filter_t(), &g );
+
+      uint32_t first = db->head_block_num() + 1;
+      generate_blocks( 5 );
+      g.wait_for_consumer();
+      BOOST_REQUIRE_GE( stream.backlog(), 5u );
+
+      std::thread opener( [&]()
+      {
+         std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+         g.open();
+      });
+
+      stream.stop();
+      opener.join();
+
+      BOOST_REQUIRE_EQUAL( stream.backlog(), 0u );
+      check_blocks( record, first, db->head_block_num() );
+      check_irreversible( record );
+
+      // Nothing is collected anymore
+      generate_block();
+      BOOST_REQUIRE_EQUAL( stream.backlog(), 0u );
+      BOOST_REQUIRE_EQUAL( record.block_nums().size(), 5u );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( bounded_queue )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: a full change stream queue holds the write thread back" );
+
+      consumer_record record;
+      gate g;
+
+      change_stream stream( *db, *db_plugin );
+      stream.set_max_queue_size( 2 );
+      add_recorder( stream, record, steem::plugins::chain::async_block_filter_t(), &g );
+
+      uint32_t first = db->head_block_num() + 1;
+      std::atomic< bool > written( false );
+      std::thread writer( [&]()
+      {
+         db_plugin->debug_generate_blocks( debug_key, 5, default_skip, 0 );
+         written = true;
+      });
+
+      g.wait_for_consumer();
+      std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+
+      // One event in the consumer and two queued
+      BOOST_REQUIRE( !written );
+      BOOST_REQUIRE_LE( stream.backlog(), 3u );
+
+      g.open();
+      writer.join();
+      BOOST_REQUIRE( written );
+
+      wait_for_delivery( stream );
+      check_blocks( record, first, first + 4 );
+      check_irreversible( record );
+
+      stream.stop();
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
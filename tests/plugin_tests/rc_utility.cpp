@@ -0,0 +1,114 @@
+#ifdef IS_TEST_NET
+#include <boost/test/unit_test.hpp>
+
+#include <steem/plugins/rc/rc_utility.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <random>
+
+using namespace steem::plugins::rc;
+
+BOOST_AUTO_TEST_SUITE( rc_utility )
+
+BOOST_AUTO_TEST_CASE( rc_cost_calculator_matches_single_resource )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: rc_cost_calculator::compute_costs against compute_rc_cost_of_resource" );
+
+      std::mt19937_64 rng( 20181019 );
+      auto random_in = [&rng]( int64_t lo, int64_t hi ) { return std::uniform_int_distribution< int64_t >( lo, hi )( rng ); };
+
+      auto random_curve = [&]( rc_price_curve_params& curve )
+      {
+         curve.coeff_a = random_in( 1, int64_t( 1 ) << 40 );
+         curve.coeff_b = random_in( int64_t( 1 ) << 45, int64_t( 1 ) << 50 );
+         curve.shift = random_in( 0, 63 );
+      };
+
+      /// Bounds keep every cost below 2^59, so neither the 128 bit products nor the total overflow.
+      rc_resource_param_array_type params;
+      for( size_t i = 0; i < STEEM_NUM_RESOURCE_TYPES; ++i )
+         random_curve( params[i].price_curve_params );
+
+      int64_t rc_regen = random_in( 1, int64_t( 1 ) << 30 );
+      rc_cost_calculator calculator;
+
+      for( uint32_t round = 0; round < 20000; ++round )
+      {
+         /// Change one of the inputs the price numerators depend on every few rounds, or nothing at all.
+         size_t changed = random_in( 0, STEEM_NUM_RESOURCE_TYPES - 1 );
+         switch( random_in( 0, 7 ) )
+         {
+            case 0:
+               rc_regen = random_in( 1, int64_t( 1 ) << 30 );
+               break;
+            case 1:
+               params[ changed ].price_curve_params.coeff_a = random_in( 1, int64_t( 1 ) << 40 );
+               break;
+            case 2:
+               params[ changed ].price_curve_params.coeff_b = random_in( int64_t( 1 ) << 45, int64_t( 1 ) << 50 );
+               break;
+            case 3:
+               params[ changed ].price_curve_params.shift = random_in( 0, 63 );
+               break;
+            case 4:
+               rc_regen = random_in( 1, 3 );
+               random_curve( params[ changed ].price_curve_params );
+               break;
+            default:
+               break;
+         }
+
+         resource_count_type pools;
+         resource_count_type counts;
+         resource_count_type scaled;
+
+         for( size_t i = 0; i < STEEM_NUM_RESOURCE_TYPES; ++i )
+         {
+            params[i].resource_dynamics_params.resource_unit = random_in( 0, 2 ) == 0 ? 1 : random_in( 1, 10000 );
+
+            switch( random_in( 0, 3 ) )
+            {
+               case 0:  pools[i] = 0; break;
+               case 1:  pools[i] = random_in( -( int64_t( 1 ) << 50 ), -1 ); break;
+               default: pools[i] = random_in( 1, int64_t( 1 ) << 50 ); break;
+            }
+
+            switch( random_in( 0, 3 ) )
+            {
+               case 0:  counts[i] = 0; break;
+               case 1:  counts[i] = random_in( -1000000, -1 ); break;
+               default: counts[i] = random_in( 1, 1000000 ); break;
+            }
+
+            scaled[i] = counts[i] * int64_t( params[i].resource_dynamics_params.resource_unit );
+         }
+
+         resource_count_type resource_count = counts;
+         resource_count_type cost;
+         int64_t total = calculator.compute_costs( params, pools, resource_count, rc_regen, cost );
+
+         int64_t expected_total = 0;
+         for( size_t i = 0; i < STEEM_NUM_RESOURCE_TYPES; ++i )
+         {
+            int64_t expected = compute_rc_cost_of_resource( params[i].price_curve_params, pools[i], scaled[i], rc_regen );
+
+            BOOST_REQUIRE_EQUAL( resource_count[i], scaled[i] );
+            BOOST_REQUIRE_EQUAL( cost[i], expected );
+            expected_total += expected;
+         }
+
+         BOOST_REQUIRE_EQUAL( total, expected_total );
+      }
+
+      BOOST_TEST_MESSAGE( "--- Non-positive rc_regen is rejected" );
+      resource_count_type pools, resource_count, cost;
+      BOOST_REQUIRE_THROW( calculator.compute_costs( params, pools, resource_count, 0, cost ), fc::assert_exception );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
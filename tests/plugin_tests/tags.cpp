@@ -0,0 +1,328 @@
+#ifdef IS_TEST_NET
+#include <boost/test/unit_test.hpp>
+
+#include <steem/chain/account_object.hpp>
+#include <steem/chain/comment_object.hpp>
+#include <steem/protocol/steem_operations.hpp>
+
+#include <steem/plugins/tags/tags_plugin.hpp>
+#include <steem/plugins/tags_api/tags_api_plugin.hpp>
+#include <steem/plugins/tags_api/tags_api.hpp>
+
+#include <fc/io/json.hpp>
+
+#include "../db_fixture/database_fixture.hpp"
+
+using namespace steem::chain;
+using namespace steem::protocol;
+using namespace steem::plugins::tags;
+
+namespace {
+
+/// Small enough for the posts of the test to spill past the end of every feed.
+const uint32_t FEED_SIZE = 5;
+
+typedef discussion_query_result ( tags_api::*discussion_method )( const discussion_query&, bool );
+
+struct feed_query
+{
+   tag_feed_type        type;
+   discussion_method    method;
+   const char*          name;
+};
+
+const std::vector< feed_query > feed_queries =
+{
+   { trending_feed, &tags_api::get_discussions_by_trending, "trending" },
+   { hot_feed,      &tags_api::get_discussions_by_hot,      "hot" },
+   { created_feed,  &tags_api::get_discussions_by_created,  "created" },
+   { promoted_feed, &tags_api::get_discussions_by_promoted, "promoted" }
+};
+
+/// Chain with tags_plugin keeping feeds of FEED_SIZE posts and tags_api serving from them.
+struct tags_fixture : public database_fixture
+{
+   tags_fixture()
+   {
+      try
+      {
+         appbase::app().register_plugin< tags_plugin >();
+         appbase::app().register_plugin< steem::plugins::json_rpc::json_rpc_plugin >();
+         appbase::app().register_plugin< tags_api_plugin >();
+         db_plugin = &appbase::app().register_plugin< steem::plugins::debug_node::debug_node_plugin >();
+         init_account_pub_key = init_account_priv_key.get_public_key();
+
+         std::string feed_size_arg = "--tags-feed-size=" + std::to_string( FEED_SIZE );
+         int test_argc = 2;
+         const char* test_argv[] = { boost::unit_test::framework::master_test_suite().argv[0], feed_size_arg.c_str() };
+
+         db_plugin->logging = false;
+         appbase::app().initialize< tags_plugin, tags_api_plugin,
+            steem::plugins::debug_node::debug_node_plugin >( test_argc, (char**)test_argv );
+
+         // Comments and votes only reach the tags once the plugin is started
+         appbase::app().get_plugin< tags_plugin >().plugin_startup();
+
+         db = &appbase::app().get_plugin< steem::plugins::chain::chain_plugin >().db();
+         BOOST_REQUIRE( db );
+
+         api = appbase::app().get_plugin< tags_api_plugin >().api.get();
+         BOOST_REQUIRE( api );
+
+         open_database();
+
+         generate_block();
+         db->set_hardfork( STEEM_NUM_HARDFORKS );
+         generate_block();
+
+         vest( STEEM_INIT_MINER_NAME, 10000 );
+         generate_block();
+         validate_database();
+      }
+      catch( const fc::exception& e )
+      {
+         edump( (e.to_detail_string()) );
+         throw;
+      }
+   }
+
+   void push_op( const operation& op )
+   {
+      trx.operations.push_back( op );
+      trx.set_expiration( db->head_block_time() + STEEM_MAX_TIME_UNTIL_EXPIRATION );
+      db->push_transaction( trx, ~0 );
+      trx.clear();
+   }
+
+   void post( const string& author, const string& permlink, const string& json_metadata,
+      const string& parent_author = string(), const string& parent_permlink = "feedtest" )
+   {
+      comment_operation c;
+      c.author = author;
+      c.permlink = permlink;
+      c.parent_author = parent_author;
+      c.parent_permlink = parent_permlink;
+      c.title = permlink;
+      c.body = "body of " + permlink;
+      c.json_metadata = json_metadata;
+      push_op( c );
+   }
+
+   void vote( const string& voter, const string& author, const string& permlink, int16_t weight )
+   {
+      vote_operation v;
+      v.voter = voter;
+      v.author = author;
+      v.permlink = permlink;
+      v.weight = weight;
+      push_op( v );
+      generate_block();
+   }
+
+   void promote( const string& author, const string& permlink, const asset& amount )
+   {
+      transfer_operation t;
+      t.from = author;
+      t.to = STEEM_NULL_ACCOUNT;
+      t.amount = amount;
+      t.memo = "@" + author + "/" + permlink;
+      push_op( t );
+   }
+
+   discussion_query make_query( const string& tag, uint32_t limit, const discussion* start = nullptr )const
+   {
+      discussion_query q;
+      q.tag = tag;
+      q.limit = limit;
+      if( start != nullptr )
+      {
+         q.start_author = string( start->author );
+         q.start_permlink = start->permlink;
+      }
+      return q;
+   }
+
+   /// What the query returned before tag feeds existed, i.e. the tag_index walk.
+   discussion_query_result walk_index( discussion_method method, const discussion_query& q )
+   {
+      auto session = db->start_undo_session();
+
+      const auto& feed_idx = db->get_index< tag_feed_index, by_id >();
+      while( feed_idx.begin() != feed_idx.end() )
+         db->remove( *feed_idx.begin() );
+
+      return ( api->*method )( q, false );
+      // The session going out of scope brings the feeds back
+   }
+
+   void check_query( const feed_query& f, const discussion_query& q )
+   {
+      auto served = ( api->*f.method )( q, false );
+      auto walked = walk_index( f.method, q );
+
+      BOOST_TEST_MESSAGE( "--- " << f.name << " tag '" << q.tag << "' limit " << q.limit
+         << ( q.start_permlink ? " start " + *q.start_permlink : string() ) << ": " << walked.discussions.size() << " posts" );
+      BOOST_REQUIRE_EQUAL( fc::json::to_string( served.discussions ), fc::json::to_string( walked.discussions ) );
+   }
+
+   /// The feed must be a prefix of the posts the index walk finds, and all of them when it is complete.
+   void check_feed_object( const string& tag, const feed_query& f, const discussion_query_result& walked )
+   {
+      const auto* feed = db->find< tag_feed_object, by_tag_type >( boost::make_tuple( tag_name_type( tag ), f.type ) );
+
+      if( feed == nullptr )
+      {
+         BOOST_REQUIRE( walked.discussions.empty() );
+         return;
+      }
+
+      BOOST_REQUIRE_LE( feed->comments.size(), FEED_SIZE );
+      BOOST_REQUIRE_LE( feed->comments.size(), walked.discussions.size() );
+
+      for( size_t i = 0; i < feed->comments.size(); ++i )
+         BOOST_REQUIRE( feed->comments[i] == walked.discussions[i].id );
+
+      if( feed->complete )
+         BOOST_REQUIRE_EQUAL( feed->comments.size(), walked.discussions.size() );
+   }
+
+   /// Compares every feed backed query of the tags with the index walk, at limits and starts around the feed size.
+   void check_feeds()
+   {
+      for( const string& tag : { string(), string( "feedtest" ), string( "other" ) } )
+      {
+         for( const auto& f : feed_queries )
+         {
+            auto all = walk_index( f.method, make_query( tag, 100 ) );
+            check_feed_object( tag, f, all );
+
+            std::vector< const discussion* > starts = { nullptr };
+            for( size_t i : { size_t( 0 ), size_t( 1 ), size_t( FEED_SIZE - 2 ), size_t( FEED_SIZE - 1 ), size_t( FEED_SIZE ), all.discussions.size() - 1 } )
+            {
+               if( i < all.discussions.size() )
+                  starts.push_back( &all.discussions[i] );
+            }
+
+            for( const auto* start : starts )
+               for( uint32_t limit : { 1u, FEED_SIZE - 1, FEED_SIZE, FEED_SIZE + 1, 100u } )
+                  check_query( f, make_query( tag, limit, start ) );
+         }
+      }
+   }
+
+   tags_api* api = nullptr;
+};
+
+}
+
+BOOST_FIXTURE_TEST_SUITE( tags_plugin, tags_fixture )
+
+BOOST_AUTO_TEST_CASE( feeds_match_index_walk )
+{
+   try
+   {
+      BOOST_TEST_MESSAGE( "Testing: tag feeds against the tag_index walk they replace" );
+
+      ACTORS( (alice)(bob)(sam)(dave)(eve)(fred) );
+      const std::vector< string > authors = { "alice", "bob", "sam", "dave", "eve", "fred" };
+
+      for( const auto& a : authors )
+      {
+         vest( STEEM_INIT_MINER_NAME, a, ASSET( "1000.000 TESTS" ) );
+         fund( a, ASSET( "100.000 TBD" ) );
+      }
+      generate_block();
+
+      BOOST_TEST_MESSAGE( "--- Posts, more than the feed size in each tag" );
+      std::vector< std::pair< string, string > > posts;
+      for( int round = 0; round < 3; ++round )
+      {
+         for( const auto& a : authors )
+         {
+            string permlink = "post-" + std::to_string( round ) + "-" + a;
+            post( a, permlink, posts.size() % 4 == 3 ? "{\"tags\":[\"other\"]}" : "{\"tags\":[\"feedtest\",\"other\"]}" );
+            posts.emplace_back( a, permlink );
+            generate_block();
+         }
+
+         check_feeds();
+         generate_blocks( db->head_block_time() + STEEM_MIN_ROOT_COMMENT_INTERVAL + fc::seconds( STEEM_BLOCK_INTERVAL ) );
+      }
+
+      BOOST_TEST_MESSAGE( "--- Votes moving posts into, within and out of the feeds" );
+      for( size_t i = 0; i < posts.size(); i += 2 )
+      {
+         vote( authors[ i % authors.size() ], posts[i].first, posts[i].second, STEEM_100_PERCENT / int16_t( 1 + i % 5 ) );
+         if( i % 3 == 0 )
+            check_feeds();
+      }
+      check_feeds();
+
+      // Downvotes take posts out of trending and hot, and a reversed upvote takes one back out
+      vote( "fred", posts[2].first, posts[2].second, -STEEM_100_PERCENT );
+      vote( "eve", posts[5].first, posts[5].second, -STEEM_100_PERCENT );
+      vote( "alice", posts[0].first, posts[0].second, 0 );
+      check_feeds();
+
+      BOOST_TEST_MESSAGE( "--- Promotions, past the feed size and twice for one post" );
+      for( size_t i = 1; i < posts.size(); i += 2 )
+      {
+         promote( posts[i].first, posts[i].second, asset( 1000 + 100 * ( i % 7 ), SBD_SYMBOL ) );
+         generate_block();
+         if( i % 4 == 1 )
+            check_feeds();
+      }
+      promote( posts[3].first, posts[3].second, ASSET( "5.000 TBD" ) );
+      generate_block();
+      check_feeds();
+
+      BOOST_TEST_MESSAGE( "--- Edits taking posts out of a tag and back" );
+      post( posts[4].first, posts[4].second, "{\"tags\":[\"other\"]}" );
+      post( posts[6].first, posts[6].second, "{\"tags\":[\"other\"]}" );
+      generate_block();
+      check_feeds();
+
+      post( posts[4].first, posts[4].second, "{\"tags\":[\"feedtest\"]}" );
+      generate_block();
+      check_feeds();
+
+      BOOST_TEST_MESSAGE( "--- Replies, which feeds do not list" );
+      post( "bob", "reply-1", "{\"tags\":[\"feedtest\"]}", posts[1].first, posts[1].second );
+      generate_block();
+      check_feeds();
+
+      BOOST_TEST_MESSAGE( "--- Deleting unvoted posts" );
+      for( size_t i : { size_t( 9 ), size_t( 15 ) } )
+      {
+         delete_comment_operation d;
+         d.author = posts[i].first;
+         d.permlink = posts[i].second;
+         push_op( d );
+         generate_block();
+         check_feeds();
+      }
+
+      BOOST_TEST_MESSAGE( "--- Payouts of the first round, then of all posts" );
+      const auto& first = db->get_comment( posts.front().first, posts.front().second );
+      generate_blocks( first.cashout_time + fc::seconds( STEEM_BLOCK_INTERVAL ) );
+      generate_block();
+      check_feeds();
+
+      generate_blocks( db->head_block_time() + fc::seconds( STEEM_CASHOUT_WINDOW_SECONDS ) );
+      generate_block();
+      check_feeds();
+
+      // Feeds left empty are dropped
+      for( const auto& f : feed_queries )
+      {
+         const auto* feed = db->find< tag_feed_object, by_tag_type >( boost::make_tuple( tag_name_type( "feedtest" ), f.type ) );
+         BOOST_REQUIRE( feed == nullptr );
+      }
+
+      validate_database();
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
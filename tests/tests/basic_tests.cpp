@@ -33,6 +33,7 @@
 #include <steem/chain/account_object.hpp>
 
 #include <steem/chain/util/reward.hpp>
+#include <steem/chain/util/latency_histogram.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/hex.hpp>
@@ -430,4 +431,39 @@ BOOST_AUTO_TEST_CASE( curation_weight_test )
 
 }
 
+BOOST_AUTO_TEST_CASE( latency_histogram_test )
+{
+   util::latency_histogram histogram;
+
+   for( uint64_t i = 1; i <= 1000; ++i )
+      histogram.record( i );
+
+   auto summary = histogram.summarize();
+   BOOST_REQUIRE( summary.count == 1000 );
+   BOOST_REQUIRE( summary.sum == 500500 );
+   BOOST_REQUIRE( summary.max == 1000 );
+
+   // Percentiles are reported with the precision of their bucket (1/16th of a power of two)
+   BOOST_REQUIRE( summary.p50 <= 500 && summary.p50 * 17 / 16 >= 500 );
+   BOOST_REQUIRE( summary.p99 <= 990 && summary.p99 * 17 / 16 >= 990 );
+
+   util::latency_snapshot snapshot;
+   BOOST_REQUIRE( histogram.summarize_since( snapshot ).count == 1000 );
+
+   histogram.record( 7 );
+   summary = histogram.summarize_since( snapshot );
+   BOOST_REQUIRE( summary.count == 1 );
+   BOOST_REQUIRE( summary.p50 == 7 && summary.max == 7 );
+
+   histogram.summarize( true );
+   BOOST_REQUIRE( histogram.summarize().count == 0 );
+
+   for( uint64_t value = 1; value < ( uint64_t( 1 ) << 50 ); value = value * 3 / 2 + 1 )
+   {
+      uint32_t index = util::latency_histogram::bucket_index( value );
+      BOOST_REQUIRE( index < util::latency_histogram::BUCKET_COUNT );
+      BOOST_REQUIRE( util::latency_histogram::bucket_value( index ) <= value );
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -889,5 +889,60 @@ BOOST_FIXTURE_TEST_CASE( generate_block_size, clean_database_fixture )
    FC_LOG_AND_RETHROW()
 }
 
+BOOST_FIXTURE_TEST_CASE( push_transactions_batch, clean_database_fixture )
+{
+   try
+   {
+      generate_block();
+
+      auto initial_balance = db->get_balance( STEEM_TEMP_ACCOUNT, STEEM_SYMBOL );
+
+      transfer_operation op;
+      op.from = STEEM_INIT_MINER_NAME;
+      op.to = STEEM_TEMP_ACCOUNT;
+      op.amount = asset( 1000, STEEM_SYMBOL );
+
+      signed_transaction good_tx;
+      good_tx.set_expiration( db->head_block_time() + STEEM_MAX_TIME_UNTIL_EXPIRATION );
+      good_tx.operations.push_back( op );
+      sign( good_tx, init_account_priv_key );
+
+      signed_transaction bad_sig_tx;
+      bad_sig_tx.set_expiration( db->head_block_time() + STEEM_MAX_TIME_UNTIL_EXPIRATION - 1 );
+      bad_sig_tx.operations.push_back( op );
+      sign( bad_sig_tx, generate_private_key( "bad" ) );
+
+      prepared_transaction good( good_tx ), bad_sig( bad_sig_tx ), duplicate( good_tx );
+      db->prepare_transaction( good );
+      db->prepare_transaction( bad_sig );
+      db->prepare_transaction( duplicate );
+
+      BOOST_TEST_MESSAGE( "--- Test a failure in a batch only discards that transaction" );
+      vector< optional< fc::exception > > results;
+      db->push_transactions( { &good, &bad_sig, &duplicate }, results );
+
+      BOOST_REQUIRE( results.size() == 3 );
+      BOOST_REQUIRE( !results[0].valid() );
+      BOOST_REQUIRE( results[1].valid() );
+      BOOST_REQUIRE( results[2].valid() );
+      BOOST_REQUIRE( db->get_balance( STEEM_TEMP_ACCOUNT, STEEM_SYMBOL ) == initial_balance + op.amount );
+      BOOST_REQUIRE( db->_pending_tx.size() == 1 );
+      BOOST_REQUIRE( db->_pending_tx_signature_keys.count( good_tx.id() ) == 1 );
+
+      generate_block();
+
+      auto head_block = db->fetch_block_by_number( db->head_block_num() );
+      BOOST_REQUIRE( head_block->transactions.size() == 1 );
+      BOOST_REQUIRE( head_block->transactions[0].id() == good_tx.id() );
+
+      BOOST_TEST_MESSAGE( "--- Test included transactions are dropped from the pending state and key cache" );
+      BOOST_REQUIRE( db->_last_pending_reapply_stats.known == 1 );
+      BOOST_REQUIRE( db->_last_pending_reapply_stats.applied == 0 );
+      BOOST_REQUIRE( db->_pending_tx.empty() );
+      BOOST_REQUIRE( db->_pending_tx_signature_keys.empty() );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif
@@ -31,6 +31,8 @@
 
 #include <steem/plugins/condenser_api/condenser_api_legacy_asset.hpp>
 #include <steem/plugins/condenser_api/condenser_api_legacy_objects.hpp>
+#include <steem/plugins/database_api/database_api_args.hpp>
+#include <steem/plugins/json_rpc/json_rpc_plugin.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/elliptic.hpp>
@@ -730,5 +732,29 @@ BOOST_AUTO_TEST_CASE( unpack_recursion_test )
    FC_LOG_AND_RETHROW();
 }
 
+BOOST_AUTO_TEST_CASE( streamed_result_test )
+{
+   try
+   {
+      ACTORS( (alice)(bob) )
+      generate_block();
+
+      steem::plugins::database_api::list_accounts_return accounts;
+      for( const auto& a : db->get_index< account_index, by_id >() )
+         accounts.accounts.emplace_back( a, *db );
+
+      BOOST_REQUIRE( steem::plugins::json_rpc::is_streamed_result< steem::plugins::database_api::list_accounts_return >::value );
+
+      std::string streamed;
+      steem::plugins::json_rpc::detail::write_result( accounts, streamed, std::true_type() );
+      BOOST_REQUIRE_EQUAL( streamed, fc::json::to_string( accounts ) );
+
+      accounts.accounts.clear();
+      steem::plugins::json_rpc::detail::write_result( accounts, streamed, std::true_type() );
+      BOOST_REQUIRE_EQUAL( streamed, fc::json::to_string( accounts ) );
+   }
+   FC_LOG_AND_RETHROW();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif